@@ -0,0 +1,167 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <api/types.h>
+#include <api/compiler.h>
+
+//- ACPI Tables ----------------------------------------------------------------
+
+/** @see ACPI Specification 4.0a, Section 5.2.5.3 */
+typedef struct acpi_rsdp_t {
+    int8_t signature[8];
+    uint8_t checksum;
+    int8_t oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_addr;
+
+    // Revision 2+
+    uint32_t length;
+    uint64_t xsdt_addr;
+    uint8_t ext_checksum;
+    uint8_t reserved[3];
+} PACKED acpi_rsdp_t;
+
+/** @see ACPI Specification 4.0a, Section 5.2.6 */
+typedef struct acpi_sdt_header_t {
+    int8_t signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    int8_t oem_id[6];
+    int8_t oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} PACKED acpi_sdt_header_t;
+
+/**
+ * Searches the RSDP and maps the root system description table.
+ *
+ * Requires the low 2MB of physical memory to be identity mapped.
+ *
+ * @return Whether ACPI tables could be found.
+ */
+bool acpi_init(void);
+
+/**
+ * Finds the table with the given signature and maps it into the ACPI window.
+ *
+ * The mapping stays valid until the next call to acpi_table_find.
+ *
+ * @param signature The four character signature of the table.
+ * @return Pointer to the mapped table or a null pointer, if there is none.
+ */
+acpi_sdt_header_t *acpi_table_find(const int8_t *signature);
+
+//- Multiple APIC Description Table --------------------------------------------
+
+#define ACPI_MADT_SIGNATURE "APIC"
+
+#define ACPI_MADT_FLAG_PCAT_COMPAT (1 << 0)
+
+#define ACPI_MADT_TYPE_LAPIC          0
+#define ACPI_MADT_TYPE_IOAPIC         1
+#define ACPI_MADT_TYPE_ISO            2
+#define ACPI_MADT_TYPE_LAPIC_OVERRIDE 5
+
+#define ACPI_MADT_LAPIC_ENABLED (1 << 0)
+
+#define ACPI_MADT_ISO_POLARITY_MASK 0x3
+#define ACPI_MADT_ISO_POLARITY_LOW  0x3
+#define ACPI_MADT_ISO_TRIGGER_MASK  0xC
+#define ACPI_MADT_ISO_TRIGGER_LEVEL 0xC
+
+// Maximum number of processors and I/O APICs that are kept track of
+#define ACPI_CPU_MAX    64
+#define ACPI_IOAPIC_MAX 4
+
+// Number of legacy ISA IRQs
+#define ACPI_ISA_IRQ_COUNT 16
+
+typedef struct acpi_madt_t {
+    acpi_sdt_header_t header;
+    uint32_t lapic_addr;
+    uint32_t flags;
+} PACKED acpi_madt_t;
+
+typedef struct acpi_madt_entry_t {
+    uint8_t type;
+    uint8_t length;
+} PACKED acpi_madt_entry_t;
+
+typedef struct acpi_madt_lapic_t {
+    acpi_madt_entry_t entry;
+    uint8_t acpi_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} PACKED acpi_madt_lapic_t;
+
+typedef struct acpi_madt_ioapic_t {
+    acpi_madt_entry_t entry;
+    uint8_t id;
+    uint8_t reserved;
+    uint32_t addr;
+    uint32_t gsi_base;
+} PACKED acpi_madt_ioapic_t;
+
+typedef struct acpi_madt_iso_t {
+    acpi_madt_entry_t entry;
+    uint8_t bus;
+    uint8_t source;
+    uint32_t gsi;
+    uint16_t flags;
+} PACKED acpi_madt_iso_t;
+
+typedef struct acpi_madt_lapic_override_t {
+    acpi_madt_entry_t entry;
+    uint16_t reserved;
+    uint64_t addr;
+} PACKED acpi_madt_lapic_override_t;
+
+// An I/O APIC as described by the MADT.
+typedef struct acpi_ioapic_t {
+    uint8_t id;
+    uint32_t gsi_base;
+    uintptr_t paddr;
+} acpi_ioapic_t;
+
+// Routing of a legacy ISA IRQ to a global system interrupt.
+typedef struct acpi_isa_irq_t {
+    uint32_t gsi;
+    uint16_t flags;
+} acpi_isa_irq_t;
+
+extern uintptr_t acpi_lapic_paddr;
+extern bool acpi_pic_present;
+
+extern size_t acpi_cpu_count;
+extern uint8_t acpi_cpu_apic_ids[ACPI_CPU_MAX];
+
+extern size_t acpi_ioapic_count;
+extern acpi_ioapic_t acpi_ioapics[ACPI_IOAPIC_MAX];
+
+extern acpi_isa_irq_t acpi_isa_irqs[ACPI_ISA_IRQ_COUNT];
+
+/**
+ * Parses the MADT and fills in the processor and interrupt controller
+ * information above.
+ *
+ * @return Whether the MADT has been found.
+ */
+bool acpi_madt_parse(void);
@@ -24,3 +24,7 @@
 #define UNLIKELY(exp) __builtin_expect(!!(exp), 0)
 
 #define PACKED __attribute__((packed))
+
+#define OFFSETOF(type, member) __builtin_offsetof(type, member)
+
+#define STATIC_ASSERT(exp, message) _Static_assert(exp, message)
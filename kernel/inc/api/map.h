@@ -25,11 +25,18 @@
 #define MEMORY_GDT64_VADDR        (MEMORY_SPACE_RECURSIVE_VADDR - 0x003000)
 #define MEMORY_LAPIC_VADDR        (MEMORY_SPACE_RECURSIVE_VADDR - 0x004000)
 #define MEMORY_SPACE_HELPER_VADDR (MEMORY_SPACE_RECURSIVE_VADDR - 0x005000)
-#define MEMORY_PROCESS_MAP_VADDR  (MEMORY_SPACE_RECURSIVE_VADDR - 0x007000) // 8kB
-#define MEMORY_THREAD_MAP_VADDR   (MEMORY_SPACE_RECURSIVE_VADDR - 0x207000) // 2MB
+#define MEMORY_KDATA_TIME_VADDR   (MEMORY_SPACE_RECURSIVE_VADDR - 0x006000)
+#define MEMORY_IOAPIC_VADDR       (MEMORY_SPACE_RECURSIVE_VADDR - 0x20B000) // 16kB
+#define MEMORY_ACPI_VADDR         (MEMORY_SPACE_RECURSIVE_VADDR - 0x22B000) // 128kB
+#define MEMORY_CPU_STACKS_VADDR   (MEMORY_SPACE_RECURSIVE_VADDR - 0x42B000) // 2MB
 
 #define MEMORY_VIDEO_PADDR           0xB8000
 
+// End of the lower half, which is left to the processes
+#define MEMORY_USER_END              0x0000800000000000
+
+#define MEMORY_KERNEL_VADDR          0xFFFFFF0000000000
+#define MEMORY_KERNEL_STACKS_VADDR   0xFFFFFF1000000000
 #define MEMORY_MODULES_VADDR         0xFFFFFF2000000000
 #define MEMORY_FRAMES_VADDR          0xFFFFFF4000000000
 #define MEMORY_HEAP_VADDR            0xFFFFFF6000000000
@@ -40,3 +47,5 @@
 #define MEMORY_USER_STACK_VADDR      0xFFFFFE8000000000
 #define MEMORY_IPC_SEND_BUFFER_VADDR 0xFFFFFE0000000000
 #define MEMORY_IPC_RECV_BUFFER_VADDR 0xFFFFFD8000000000
+#define MEMORY_KDATA_VADDR           0xFFFFFD0000000000
+#define MEMORY_RING_VADDR            0xFFFFFC8000000000
@@ -18,7 +18,29 @@
 
 #pragma once
 #include <api/types.h>
+#include <api/bootinfo.h>
 
 //- ELF64 Loading --------------------------------------------------------------
 
 uint64_t binary_load_elf64(void *binary, uint16_t pflags);
+
+/**
+ * Checks whether the given image is an ELF64 binary binary_load_elf64 can
+ * load, i.e. its headers and loadable segments lie within the image and the
+ * segments are page aligned and within the lower half.
+ *
+ * @param binary The image to check.
+ * @param size The size of the image.
+ * @return Whether the image can be loaded.
+ */
+bool binary_check_elf64(void *binary, size_t size);
+
+//- Boot Modules ---------------------------------------------------------------
+
+/**
+ * Returns the boot module with the given index.
+ *
+ * @param index The index of the module in the order of the boot info.
+ * @return The module or a null pointer, if there is no such module.
+ */
+boot_info_mod_t *binary_module(size_t index);
@@ -96,12 +96,20 @@ void cpu_int_disable(void);
 
 void cpu_int_register(uint8_t vector, cpu_int_handler_t callback);
 
+/**
+ * Loads the IDT on the current processor (for application processors).
+ */
+void cpu_int_load(void);
+
 //------------------------------------------------------------------------------
 // Task State Segment (TSS)
 //------------------------------------------------------------------------------
 
 #define TSS_GDT_OFFSET 0x28
 
+// Length of the GDT (including the TSS descriptor)
+#define GDT_LENGTH 0x38
+
 // The structre of the Task Segment Selector.
 //
 // Normally used for hardware multitasking, on X86 and AMD64 at least one TSS
@@ -155,4 +163,73 @@ typedef struct cpu_tss_ptr_t
     
 } PACKED cpu_tss_ptr_t;
 
-void cpu_tss_create(void);
+/**
+ * Creates a GDT and a TSS for the current processor and loads them.
+ *
+ * @param stack_top The stack to switch to when entering the kernel.
+ * @return The created TSS.
+ */
+cpu_tss_t *cpu_tss_create(uintptr_t stack_top);
+
+//------------------------------------------------------------------------------
+// Model Specific Registers
+//------------------------------------------------------------------------------
+
+#define CPU_MSR_APIC_BASE       0x1B
+#define CPU_MSR_EFER            0xC0000080
+#define CPU_MSR_STAR            0xC0000081
+#define CPU_MSR_LSTAR           0xC0000082
+#define CPU_MSR_FMASK           0xC0000084
+#define CPU_MSR_GS_BASE         0xC0000101
+#define CPU_MSR_KERNEL_GS_BASE  0xC0000102
+
+// System call extensions (SYSCALL/SYSRET) enable bit in EFER
+#define CPU_MSR_EFER_SCE        (1 << 0)
+
+/**
+ * Reads the model specific register with the given index.
+ *
+ * @param msr The index of the MSR.
+ * @return The value of the MSR.
+ */
+uint64_t cpu_msr_read(uint32_t msr);
+
+/**
+ * Writes the given value to the model specific register with the given index.
+ *
+ * @param msr The index of the MSR.
+ * @param value The value to write.
+ */
+void cpu_msr_write(uint32_t msr, uint64_t value);
+
+//------------------------------------------------------------------------------
+// CPU Identification
+//------------------------------------------------------------------------------
+
+#define CPU_CPUID_FEATURES 0x1
+
+#define CPU_CPUID_FEATURES_EDX_APIC (1 << 9)
+
+#define CPU_CPUID_EXT_MAX 0x80000000
+#define CPU_CPUID_EXT_POWER 0x80000007
+
+#define CPU_CPUID_EXT_POWER_EDX_INVARIANT_TSC (1 << 8)
+
+/**
+ * Executes CPUID for the given leaf.
+ *
+ * @param leaf The leaf to query (in eax).
+ * @param regs Array of four values to store eax, ebx, ecx and edx to.
+ */
+void cpu_cpuid(uint32_t leaf, uint32_t *regs);
+
+//------------------------------------------------------------------------------
+// Time Stamp Counter
+//------------------------------------------------------------------------------
+
+/**
+ * Reads the time stamp counter of the current processor.
+ *
+ * @return The value of the TSC.
+ */
+uint64_t cpu_tsc_read(void);
@@ -20,11 +20,12 @@
 #include <api/types.h>
 #include <cpu.h>
 
+#define FAULT_NM_VECTOR 7
 #define FAULT_GP_VECTOR 13
 #define FAULT_PF_VECTOR 14
 #define FAULT_XF_VECTOR 19
 
-void fault_install(void);
+void fault_nm(cpu_int_state_t *state);
 void fault_gp(cpu_int_state_t *state);
 void fault_pf(cpu_int_state_t *state);
 void fault_xf(cpu_int_state_t *state);
@@ -20,27 +20,52 @@
 
 //- Floating Point Units -------------------------------------------------------
 
+/**
+ * Size of the region the FPU state is saved to.
+ *
+ * 512 bytes for FXSAVE, or the size of the XSAVE area for the enabled state
+ * components, if XSAVE is supported.
+ */
+extern size_t fpu_state_size;
+
 /**
  * Initializes the CPU's SSE, x87 FPU and MMX units.
+ *
+ * Enables XSAVE and the AVX and AVX-512 state components, if supported. The
+ * units are left disabled (see fpu_disable).
  */
 void fpu_init(void);
 
 /**
- * Prepares the current FPU state.
+ * Initializes the given region with the state a thread starts with.
+ *
+ * @param region The region to initialize (fpu_state_size bytes).
+ */
+void fpu_state_init(void *region);
+
+/**
+ * Enables the FPU by clearing CR0.TS.
+ */
+void fpu_enable(void);
+
+/**
+ * Disables the FPU by setting CR0.TS, so its next use raises a
+ * Device Not Available exception.
  */
-void fpu_prepare(void);
+void fpu_disable(void);
 
 /**
- * Saves the SSE, x87 FPU and MMX states to the given region.
+ * Saves the SSE, x87 FPU, MMX and AVX states to the given region.
  *
- * The region must be 512 bytes in size and aligned on a 16 byte boundary.
+ * The region must be fpu_state_size bytes in size and aligned on a 64 byte
+ * boundary.
  *
  * @param region Region in memory to store the fpu state to.
  */
 void fpu_save(void *region);
 
 /**
- * Loads the SSE, x87 FPU and MMX states from the given region.
+ * Loads the SSE, x87 FPU, MMX and AVX states from the given region.
  *
  * @param region Region in memory to load the fpu state from.
  */
@@ -0,0 +1,113 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <api/types.h>
+
+//- Id Maps --------------------------------------------------------------------
+
+// Maximum number of ids an id map can manage
+#define IDMAP_MAX           0x10000
+
+// Ids per chunk (chunks are allocated on first use)
+#define IDMAP_CHUNK_BITS    8
+#define IDMAP_CHUNK_SIZE    (1 << IDMAP_CHUNK_BITS)
+#define IDMAP_CHUNKS        (IDMAP_MAX / IDMAP_CHUNK_SIZE)
+
+// Returned by idmap_alloc if all ids are in use
+#define IDMAP_NONE          ((uint32_t) -1)
+
+typedef struct idmap_chunk_t {
+    /**
+     * Bitmap of the ids in use.
+     */
+    uint64_t used[IDMAP_CHUNK_SIZE / 64];
+
+    /**
+     * The number of ids in use.
+     */
+    uint32_t count;
+
+    /**
+     * The objects the ids are mapped to.
+     */
+    void *entries[IDMAP_CHUNK_SIZE];
+} idmap_chunk_t;
+
+/**
+ * Maps ids to objects and allocates the lowest free id in constant time.
+ *
+ * Memory is only allocated for chunks of ids that are actually in use.
+ */
+typedef struct idmap_t {
+    /**
+     * The number of ids that may be allocated.
+     */
+    uint32_t limit;
+
+    /**
+     * Bitmap of the chunks that have no free ids left.
+     */
+    uint64_t full[IDMAP_CHUNKS / 64];
+
+    /**
+     * The chunks (null pointer if no id of the chunk is in use).
+     */
+    idmap_chunk_t *chunks[IDMAP_CHUNKS];
+} idmap_t;
+
+/**
+ * Initializes an empty id map.
+ *
+ * @param map The map to initialize.
+ * @param limit The number of ids that may be allocated (at most IDMAP_MAX).
+ */
+void idmap_init(idmap_t *map, uint32_t limit);
+
+/**
+ * Frees all memory of the given map (but not the mapped objects).
+ *
+ * @param map The map to dispose.
+ */
+void idmap_dispose(idmap_t *map);
+
+/**
+ * Allocates the lowest free id and maps it to the given object.
+ *
+ * @param map The map to allocate the id from.
+ * @param entry The object to map the id to.
+ * @return The id or IDMAP_NONE, if the limit has been reached.
+ */
+uint32_t idmap_alloc(idmap_t *map, void *entry);
+
+/**
+ * Frees the given id.
+ *
+ * @param map The map to free the id in.
+ * @param id The id to free.
+ */
+void idmap_free(idmap_t *map, uint32_t id);
+
+/**
+ * Returns the object the given id is mapped to.
+ *
+ * @param map The map to look the id up in.
+ * @param id The id to look up.
+ * @return The object or a null pointer, if the id is not in use.
+ */
+void *idmap_get(idmap_t *map, uint32_t id);
@@ -18,12 +18,18 @@
 
 #pragma once
 #include <api/types.h>
+#include <api/compiler.h>
 #include <multitasking.h>
 
 //- IPC - Structures -----------------------------------------------------------
 
 #define IPC_FLAG_RESPONSE (1 << 0)
 #define IPC_FLAG_IGNORE_RESPONSE (1 << 1)
+#define IPC_FLAG_PAGE_FAULT (1 << 2)
+#define IPC_FLAG_SHORT (1 << 3)
+
+// Maximum payload of a short message (in R8, R9 and R12 to R15)
+#define IPC_SHORT_SIZE (6 * sizeof(uint64_t))
 
 /**
  * Role context structure for message handlers to track the
@@ -45,6 +51,13 @@ typedef struct ipc_role_ctx_t {
      */
     uint16_t flags;
 
+    /**
+     * The faulting address and the error code, for page faults forwarded to
+     * a pager (see IPC_FLAG_PAGE_FAULT).
+     */
+    uintptr_t fault_address;
+    uint64_t fault_code;
+
 } ipc_role_ctx_t;
 
 //- IPC - Buffer ----------------------------------------------------------------
@@ -59,21 +72,44 @@ typedef struct ipc_role_ctx_t {
 
 #define IPC_BUFFER_SIZE 0x200000
 
+// Address of a slot of a process's pool of parked buffer page tables (behind
+// the receive buffers of all possible threads)
+#define IPC_POOL_VADDR(slot) \
+		(MEMORY_IPC_RECV_BUFFER_VADDR + IPC_BUFFER_SIZE * (THREAD_MAX + (slot)))
+
 /**
  * Resizes a thread's IPC buffer.
  *
+ * Pages are kept mapped when the buffer shrinks. An empty buffer takes a page
+ * table (with its pages) from the process's pool, if any is parked, so the
+ * frame allocator is only used for pages beyond the high-water mark.
+ *
  * Requires to be in the thread's address space.
  *
  * @param size The new size of the IPC buffer.
  * @param buffer The number of the buffer.
  * @param thread The thread whose IPC buffer to resize.
+ * @param process The process hosting the thread.
+ */
+void ipc_buffer_resize(uint32_t size, uint8_t buffer, thread_t *thread, process_t *process);
+
+/**
+ * Empties a thread's IPC buffer, parking its page table in the process's
+ * pool (or freeing its pages, if the pool is full).
+ *
+ * Requires to be in the thread's address space.
+ *
+ * @param buffer The number of the buffer.
+ * @param thread The thread whose IPC buffer to release.
+ * @param process The process hosting the thread.
  */
-void ipc_buffer_resize(uint32_t size, uint8_t buffer, thread_t *thread);
+void ipc_buffer_release(uint8_t buffer, thread_t *thread, process_t *process);
 
 /**
  * Moves an IPC buffer from the source thread to the target thread.
  *
- * Will return in the target thread's address space.
+ * The target buffer is released before (see ipc_buffer_release). Will return
+ * in the target thread's address space.
  *
  * @param source The source thread whose IPC buffer to move.
  * @param soruce_buf The number of the buffer to move.
@@ -86,6 +122,175 @@ void ipc_buffer_move(
 		thread_t *target, uint8_t target_buf,
 		process_t *target_proc);
 
+//- IPC - Receivers ------------------------------------------------------------
+
+/**
+ * Adds the given thread to the waiting receivers of the given process, which
+ * messages are delivered to before spawning handler threads.
+ *
+ * @param process The process hosting the thread.
+ * @param thread The thread, which must have been frozen.
+ */
+void ipc_receiver_wait(process_t *process, thread_t *thread);
+
+/**
+ * Removes the receiver that started waiting last from the given process's
+ * waiting receivers.
+ *
+ * @param process The process.
+ * @return The receiver or a null pointer, if none is waiting.
+ */
+thread_t *ipc_receiver_take(process_t *process);
+
+/**
+ * Removes the given thread from the waiting receivers of the given process.
+ *
+ * @param process The process hosting the thread.
+ * @param thread The waiting thread.
+ */
+void ipc_receiver_remove(process_t *process, thread_t *thread);
+
+//- IPC - Queues ---------------------------------------------------------------
+
+// Maximum number of queues
+#define IPC_QUEUE_MAX 0x1000
+
+// Maximum number of slots per queue (the number is rounded up to a power of
+// two; a queue and its slots are allocated from the heap)
+#define IPC_QUEUE_SLOTS_MAX 64
+
+/**
+ * A message in a queue, in the format passed to and from user space.
+ */
+typedef struct ipc_queue_msg_t {
+	/**
+	 * The id of the sender process (set by the kernel).
+	 */
+	uint32_t sender;
+
+	/**
+	 * The length of the payload (at most IPC_SHORT_SIZE).
+	 */
+	uint32_t length;
+
+	uint8_t payload[IPC_SHORT_SIZE];
+} PACKED ipc_queue_msg_t;
+
+/**
+ * A bounded queue of messages, which any process may send to and the owning
+ * process receives from without blocking the senders.
+ */
+typedef struct ipc_queue_t {
+	/**
+	 * The id of the queue and of the process owning it.
+	 */
+	uint32_t id;
+	uint32_t owner;
+
+	/**
+	 * The number of slots (a power of two) and the free running positions of
+	 * the oldest message and of the next free slot.
+	 */
+	uint32_t capacity;
+	uint32_t head;
+	uint32_t tail;
+
+	/**
+	 * Threads of the owner waiting for the queue to become non-empty.
+	 */
+	thread_t *waiters;
+
+	/**
+	 * The next queue of the owner.
+	 */
+	struct ipc_queue_t *next;
+
+	ipc_queue_msg_t slots[];
+} ipc_queue_t;
+
+/**
+ * Initializes the map of queue ids.
+ */
+void ipc_queue_init(void);
+
+/**
+ * Creates a queue owned by the given process.
+ *
+ * @param process The owner.
+ * @param slots The minimum number of slots (at most IPC_QUEUE_SLOTS_MAX).
+ * @return The queue or a null pointer, if there are too many queues.
+ */
+ipc_queue_t *ipc_queue_create(process_t *process, uint32_t slots);
+
+/**
+ * Returns the queue with the given id.
+ *
+ * @param id The id of the queue.
+ * @return The queue or a null pointer, if there is no such queue.
+ */
+ipc_queue_t *ipc_queue_get(uint32_t id);
+
+/**
+ * Appends as many of the given messages to the queue as fit and notifies a
+ * waiting receiver, if the queue has been empty before.
+ *
+ * @param queue The queue.
+ * @param sender The id of the sender process.
+ * @param messages The messages (lengths are clamped to IPC_SHORT_SIZE).
+ * @param count The number of messages.
+ * @return The number of messages appended.
+ */
+uint32_t ipc_queue_push(
+		ipc_queue_t *queue,
+		uint32_t sender,
+		ipc_queue_msg_t *messages,
+		uint32_t count);
+
+/**
+ * Removes up to the given number of the oldest messages from the queue.
+ *
+ * Notifies the next waiting receiver, if messages are left.
+ *
+ * @param queue The queue.
+ * @param messages The array to copy the messages to.
+ * @param count The maximum number of messages.
+ * @return The number of messages removed.
+ */
+uint32_t ipc_queue_pop(ipc_queue_t *queue, ipc_queue_msg_t *messages, uint32_t count);
+
+/**
+ * Freezes the given thread until the queue becomes non-empty.
+ *
+ * Its system call returns zero messages when notified, so it has to retry.
+ *
+ * @param queue The empty queue.
+ * @param thread The thread, which must be owned by the queue's owner.
+ */
+void ipc_queue_wait(ipc_queue_t *queue, thread_t *thread);
+
+/**
+ * Removes the given thread from the waiters of the queue it sleeps on.
+ *
+ * @param thread The thread (sleeping with THREAD_SLEEP_QUEUE).
+ */
+void ipc_queue_waiter_remove(thread_t *thread);
+
+/**
+ * Destroys the given queue, waking up all waiters (their system calls return
+ * zero messages) and discarding queued messages.
+ *
+ * @param process The owner of the queue.
+ * @param queue The queue.
+ */
+void ipc_queue_destroy(process_t *process, ipc_queue_t *queue);
+
+/**
+ * Destroys all queues owned by the given process.
+ *
+ * @param process The process.
+ */
+void ipc_queue_dispose(process_t *process);
+
 //- IPC ------------------------------------------------------------------------
 
 /**
@@ -105,3 +310,12 @@ void ipc_message_header(
 		uint32_t sender_pid,
 		uint32_t thread_id,
 		cpu_int_state_t *state);
+
+/**
+ * Copies the payload of a short message (see IPC_FLAG_SHORT) between the given
+ * states.
+ *
+ * @param source The state of the sender.
+ * @param target The state of the receiver.
+ */
+void ipc_message_short(cpu_int_state_t *source, cpu_int_state_t *target);
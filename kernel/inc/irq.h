@@ -52,6 +52,159 @@ void irq_pic_eoi(uint8_t index);
 void irq_pic_mask(uint8_t index);
 void irq_pic_unmask(uint8_t index);
 
+//- IRQ Routing ----------------------------------------------------------------
+
+/**
+ * Initializes the interrupt controllers.
+ *
+ * Uses the local APIC and I/O APICs described by the ACPI MADT, if present,
+ * and disables the PIC afterwards. Falls back to the PIC otherwise.
+ */
+void irq_init(void);
+
+/**
+ * Signals an EOI for the ISA IRQ with the given index to the controller it is
+ * routed through.
+ *
+ * @param index The index of the IRQ.
+ */
+void irq_eoi(uint8_t index);
+
+/**
+ * Masks the ISA IRQ with the given index.
+ *
+ * @param index The index of the IRQ.
+ */
+void irq_mask(uint8_t index);
+
+/**
+ * Unmasks the ISA IRQ with the given index.
+ *
+ * @param index The index of the IRQ.
+ */
+void irq_unmask(uint8_t index);
+
+//- Local APIC -----------------------------------------------------------------
+
+/** @see Intel SDM Vol. 3A, Chapter 10 */
+#define IRQ_LAPIC_REG_ID            0x020
+#define IRQ_LAPIC_REG_VERSION       0x030
+#define IRQ_LAPIC_REG_TPR           0x080
+#define IRQ_LAPIC_REG_EOI           0x0B0
+#define IRQ_LAPIC_REG_SVR           0x0F0
+#define IRQ_LAPIC_REG_ESR           0x280
+#define IRQ_LAPIC_REG_ICR_LOW       0x300
+#define IRQ_LAPIC_REG_ICR_HIGH      0x310
+#define IRQ_LAPIC_REG_LVT_TIMER     0x320
+#define IRQ_LAPIC_REG_LVT_LINT0     0x350
+#define IRQ_LAPIC_REG_LVT_LINT1     0x360
+#define IRQ_LAPIC_REG_LVT_ERROR     0x370
+#define IRQ_LAPIC_REG_TIMER_INITIAL 0x380
+#define IRQ_LAPIC_REG_TIMER_CURRENT 0x390
+#define IRQ_LAPIC_REG_TIMER_DIVIDE  0x3E0
+
+#define IRQ_LAPIC_BASE_ENABLE       (1 << 11)
+#define IRQ_LAPIC_SVR_ENABLE        (1 << 8)
+#define IRQ_LAPIC_LVT_MASKED        (1 << 16)
+#define IRQ_LAPIC_TIMER_DIVIDE_16   0x3
+
+#define IRQ_LAPIC_ICR_INIT          (5 << 8)
+#define IRQ_LAPIC_ICR_STARTUP       (6 << 8)
+#define IRQ_LAPIC_ICR_PENDING       (1 << 12)
+#define IRQ_LAPIC_ICR_LEVEL_ASSERT  (1 << 14)
+
+// Interrupt vector for the LAPIC timer
+#define IRQ_LAPIC_TIMER_VECTOR 0x40
+
+// Interrupt vector for spurious interrupts
+#define IRQ_LAPIC_SPURIOUS_VECTOR 0xFF
+
+// Whether the local APIC is used
+extern bool irq_lapic_enabled;
+
+/**
+ * Maps and enables the local APIC of the current processor.
+ *
+ * @return Whether the processor has a local APIC.
+ */
+bool irq_lapic_init(void);
+
+/**
+ * Signals an EOI to the local APIC.
+ */
+void irq_lapic_eoi(void);
+
+/**
+ * Returns the APIC id of the current processor.
+ *
+ * @return The APIC id.
+ */
+uint8_t irq_lapic_id(void);
+
+/**
+ * Sends an inter-processor interrupt to the processor with the given APIC id.
+ *
+ * @param apic_id The APIC id of the target processor.
+ * @param command The low dword of the ICR (vector and delivery mode).
+ */
+void irq_lapic_ipi(uint8_t apic_id, uint32_t command);
+
+/**
+ * Measures the number of LAPIC timer counts that elapse while the PIT counts
+ * down the given number of counts.
+ *
+ * @param pit_counts The number of PIT counts to measure for.
+ * @return The number of elapsed LAPIC timer counts.
+ */
+uint32_t irq_lapic_timer_calibrate(uint32_t pit_counts);
+
+/**
+ * Programs the LAPIC timer to fire once after the given number of counts.
+ *
+ * @param counts The number of LAPIC timer counts until the interrupt.
+ */
+void irq_lapic_timer_oneshot(uint32_t counts);
+
+/**
+ * Returns the number of LAPIC timer counts since it has been programmed last.
+ *
+ * @return The number of elapsed counts.
+ */
+uint32_t irq_lapic_timer_elapsed(void);
+
+//- I/O APIC -------------------------------------------------------------------
+
+#define IRQ_IOAPIC_REG_ID       0x00
+#define IRQ_IOAPIC_REG_VERSION  0x01
+#define IRQ_IOAPIC_REG_REDIR    0x10
+
+#define IRQ_IOAPIC_REDIR_POLARITY_LOW (1 << 13)
+#define IRQ_IOAPIC_REDIR_TRIGGER_LEVEL (1 << 15)
+#define IRQ_IOAPIC_REDIR_MASKED (1 << 16)
+
+// Whether the I/O APICs are used
+extern bool irq_ioapic_enabled;
+
+/**
+ * Maps the I/O APICs, masks all of their inputs and routes the ISA IRQs to
+ * the vectors starting at IRQ_OFFSET (masked).
+ */
+void irq_ioapic_init(void);
+
+/**
+ * Masks the given global system interrupt.
+ *
+ * @param gsi The global system interrupt.
+ */
+void irq_ioapic_mask(uint32_t gsi);
+
+/**
+ * Unmasks the given global system interrupt.
+ *
+ * @param gsi The global system interrupt.
+ */
+void irq_ioapic_unmask(uint32_t gsi);
+
 //- Programmable Interrupt Timer (IRQ 0) ---------------------------------------
 
 // IRQ index of the PIT
@@ -60,14 +213,102 @@ void irq_pic_unmask(uint8_t index);
 // Interrupt vector for PIT
 #define IRQ_PIT_VECTOR (IRQ_OFFSET + IRQ_PIT_INDEX)
 
-// Frequency of the PIT in Hertz
-#define IRQ_PIT_FREQ 256
+// Frequency of the PIT's oscillator in Hertz
+#define IRQ_PIT_BASE_FREQ 1193182
+
+// Shortest one-shot the PIT is programmed with (in PIT counts)
+#define IRQ_PIT_ONESHOT_MIN 0x10
+
+// Longest one-shot the PIT is programmed with (in PIT counts)
+// Kept below 0x10000 to detect the counter wrapping after it expired.
+#define IRQ_PIT_ONESHOT_MAX 0xF000
+
+/**
+ * Programs the PIT to fire once after the given number of counts.
+ *
+ * @param counts The number of PIT counts until the interrupt.
+ */
+void irq_pit_oneshot(uint32_t counts);
+
+/**
+ * Returns the number of PIT counts since it has been programmed last.
+ *
+ * @return The number of elapsed counts.
+ */
+uint32_t irq_pit_elapsed(void);
+
+/**
+ * Busy waits for the given number of PIT counts.
+ *
+ * Only for use while the PIT does not drive the timer.
+ *
+ * @param counts The number of PIT counts to wait.
+ */
+void irq_pit_delay(uint32_t counts);
+
+//- Timer ----------------------------------------------------------------------
+
+// Tick frequency in Hertz
+#define IRQ_TIMER_FREQ 256
+
+// Number of PIT counts per tick
+#define IRQ_PIT_TICK_COUNTS (IRQ_PIT_BASE_FREQ / IRQ_TIMER_FREQ)
+
+// Number of ticks to calibrate the LAPIC timer for
+#define IRQ_TIMER_CALIBRATE_TICKS 2
+
+// Shortest one-shot the LAPIC timer is programmed with (in LAPIC counts)
+#define IRQ_LAPIC_ONESHOT_MIN 0x100
+
+// Longest one-shot the LAPIC timer is programmed with (in LAPIC counts)
+#define IRQ_LAPIC_ONESHOT_MAX 0xFFFFFFF0
 
 // Type for timer ticks
 typedef uint64_t time_t;
 
 // Current timer ticks
-time_t irq_pit_ticks;
+extern time_t irq_timer_ticks;
 
-void irq_pit_init(void);
-void irq_pit_handler(cpu_int_state_t *state);
+/**
+ * Selects the timer that drives scheduling.
+ *
+ * Uses the LAPIC timer, calibrated against the PIT, if the local APIC is
+ * enabled and the PIT otherwise.
+ */
+void irq_timer_calibrate(void);
+
+/**
+ * Starts the timer on the current processor.
+ */
+void irq_timer_init(void);
+
+/**
+ * Handles a timer event without building a full frame (see idt.s).
+ *
+ * Only accounts the elapsed time and the current thread's time slice,
+ * reprograms the timer and signals the EOI. Leaves the rest to
+ * irq_timer_handler: expiring due timeouts, which takes the locks of
+ * processes and wakes threads, polling the submission ring and switching
+ * threads, if the time slice elapsed or the processor is idle.
+ *
+ * @return Whether irq_timer_handler has to run.
+ */
+bool irq_timer_fast(void);
+
+/**
+ * Handles a timer event that irq_timer_fast could not handle: Expires due
+ * timeouts, polls the current process's submission ring when the time slice
+ * of a thread in user mode elapsed and switches threads, if required.
+ *
+ * @param state The interrupt state.
+ */
+void irq_timer_handler(cpu_int_state_t *state);
+
+/**
+ * Reprograms the next timer event after the scheduler's state has changed.
+ *
+ * The timer runs in one-shot mode and is only programmed to fire when the
+ * current thread's time slice elapses. While the CPU is idle or only a single
+ * thread is runnable, the tick is deferred as long as the timer permits.
+ */
+void irq_timer_update(void);
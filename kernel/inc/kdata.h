@@ -0,0 +1,129 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/map.h>
+#include <irq.h>
+#include <multitasking.h>
+
+//- Kernel Data Pages ----------------------------------------------------------
+
+// Layout of the read-only region mapped into every process
+#define KDATA_TIME_VADDR     (MEMORY_KDATA_VADDR + 0x0000)
+#define KDATA_PROCESS_VADDR  (MEMORY_KDATA_VADDR + 0x1000)
+#define KDATA_THREADS_VADDR  (MEMORY_KDATA_VADDR + 0x2000)
+
+// Number of PIT counts the TSC is calibrated for
+#define KDATA_TSC_CALIBRATE_COUNTS IRQ_PIT_ONESHOT_MAX
+
+/**
+ * The time page, shared by all processes.
+ *
+ * Only ticks changes after kdata_init, with a single aligned store, so it can
+ * be read without a lock.
+ */
+typedef struct kdata_time_t {
+    /**
+     * The number of timer ticks since the system was started (irq_timer_ticks).
+     */
+    volatile uint64_t ticks;
+
+    /**
+     * The length of a tick in nanoseconds.
+     */
+    uint64_t tick_ns;
+
+    /**
+     * The TSC at the time the system time started counting.
+     */
+    uint64_t tsc_base;
+
+    /**
+     * Nanoseconds per TSC count as 32.32 fixed point number or zero, if the
+     * TSC does not run at a constant rate and must not be used for timing.
+     */
+    uint64_t tsc_mult;
+} PACKED kdata_time_t;
+
+/**
+ * The process page, private to each process.
+ */
+typedef struct kdata_process_t {
+    /**
+     * The id of the process.
+     */
+    uint32_t pid;
+
+    /**
+     * The id of the parent process or -1, if the process has no parent.
+     */
+    uint32_t parent_pid;
+} PACKED kdata_process_t;
+
+/**
+ * A thread's slot, indexed by its id and pointed to by the user GS base
+ * while it runs.
+ */
+typedef struct kdata_thread_t {
+    /**
+     * The id of the thread.
+     */
+    uint32_t tid;
+
+    /**
+     * The id of the process hosting the thread.
+     */
+    uint32_t pid;
+} PACKED kdata_thread_t;
+
+/**
+ * Allocates the time page and calibrates the TSC against the PIT.
+ *
+ * Must be called while the PIT is not used as timer yet.
+ */
+void kdata_init(void);
+
+/**
+ * Maps the kernel data pages into the given process's address space and fills
+ * the slot of the given thread, on the first call for the process also the
+ * time and process pages.
+ *
+ * Sets the thread's kdata to the address of its slot.
+ *
+ * @param process The process to map the pages for.
+ * @param thread The new thread of the process.
+ */
+void kdata_map(process_t *process, thread_t *thread);
+
+/**
+ * Publishes the current ticks on the time page (bootstrap processor only).
+ *
+ * @param ticks The current ticks.
+ */
+void kdata_time_update(time_t ticks);
+
+/**
+ * Returns the nanoseconds since the system was started, using the TSC if it
+ * is usable and the timer ticks otherwise.
+ *
+ * @return The time in nanoseconds.
+ */
+uint64_t kdata_time_ns(void);
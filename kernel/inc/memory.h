@@ -20,6 +20,18 @@
 #include <api/types.h>
 #include <api/bootinfo.h>
 #include <api/map.h>
+#include <spinlock.h>
+
+//- Locking --------------------------------------------------------------------
+
+/**
+ * Recursive lock protecting the frame allocator, the heap and the page
+ * structures.
+ *
+ * Acquired by the functions below, so it only has to be held explicitly to
+ * make a sequence of operations atomic.
+ */
+extern spinlock_t memory_lock;
 
 //- Physical Memory Management -------------------------------------------------
 
@@ -33,8 +45,14 @@ uint64_t frame_first_available(uint64_t from, boot_info_mmap_t *mmap);
 #define PAGE_FLAG_PRESENT (1 << 0)
 #define PAGE_FLAG_WRITEABLE (1 << 1)
 #define PAGE_FLAG_USER (1 << 2)
+#define PAGE_FLAG_WRITE_THROUGH (1 << 3)
+#define PAGE_FLAG_CACHE_DISABLE (1 << 4)
 #define PAGE_FLAG_GLOBAL (1 << 8)
 
+// Available to software: The frame is shared and not owned by the address
+// space, so it is not freed with it
+#define PAGE_FLAG_SHARED (1 << 9)
+
 #define PAGE_STRUCT_PML4 4
 #define PAGE_STRUCT_PDP  3
 #define PAGE_STRUCT_PD   2
@@ -47,6 +65,16 @@ void memory_unmap(uint64_t virtual_addr);
 uint64_t memory_physical(uint64_t virtual_addr);
 bool memory_user_accessible(uint64_t virtual_addr);
 
+/**
+ * Checks whether the page of the given address is mapped writeable for user
+ * mode in the current address space (the kernel does not enforce
+ * write protection on its own accesses).
+ *
+ * @param virtual_addr The address.
+ * @return Whether user mode may write to the address.
+ */
+bool memory_user_writeable(uint64_t virtual_addr);
+
 bool memory_region_accessible(uint64_t virtual_addr, uint64_t length);
 
 uint64_t memory_struct_remove(uint64_t virtual_addr, uint8_t struct_idx);
@@ -59,12 +87,32 @@ uintptr_t memory_space_initial;
 uintptr_t memory_space_get(void);
 uintptr_t memory_space_switch(uintptr_t new_space);
 uintptr_t memory_space_create(void);
-void memory_space_dispose(void);
+
+/**
+ * Queues the given address space for disposal by an idle processor.
+ *
+ * The space must not be switched to anymore. Its page structures are freed
+ * together with all frames mapped in it, except for shared ones.
+ *
+ * @param space The address space to release.
+ */
+void memory_space_release(uintptr_t space);
+
+/**
+ * Disposes all released address spaces that are not in use anymore.
+ *
+ * Called by the idle loop with interrupts disabled. Enables interrupts
+ * between page tables, so threads can preempt the disposal.
+ */
+void memory_space_reap(void);
 
 //- Heap -----------------------------------------------------------------------
 
 #define HEAP_MAX_LENGTH (0x2000000000 - 0x8000)
 
+// Largest size heap_alloc can allocate (slots are at most a page)
+#define HEAP_ALLOC_MAX (PAGE_SIZE - 1)
+
 void *heap_alloc(size_t size);
 void heap_free(void *ptr);
 uintptr_t heap_sbrk(intptr_t delta);
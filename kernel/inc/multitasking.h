@@ -19,24 +19,47 @@
 #pragma once
 #include <api/types.h>
 #include <cpu.h>
+#include <smp.h>
+#include <spinlock.h>
+#include <timeout.h>
+#include <idmap.h>
 
 //- Constants ------------------------------------------------------------------
 
 #define THREAD_ROLE_NORMAL          0
-#define THREAD_ROLE_IPC_RECEIVER    1
+#define THREAD_ROLE_IPC_RECEIVER    1   // Handles a message
+#define THREAD_ROLE_IPC_WAITING     2   // Waits for a message (see ipc_reply_and_wait)
 
 #define THREAD_FLAG_TERMINATED      (1 << 0)
 #define THREAD_FLAG_DETACHED        (1 << 1)
-#define THREAD_FLAG_FX_PREPARED     (1 << 2)
 
 #define THREAD_SLEEP_JOIN           1
 #define THREAD_SLEEP_MUTEX		    2
 #define THREAD_SLEEP_FUTEX          3
+#define THREAD_SLEEP_TIMER          4
+#define THREAD_SLEEP_IPC            5
+#define THREAD_SLEEP_FUTEX_PI       6
+#define THREAD_SLEEP_FUTEX_VEC      7
+#define THREAD_SLEEP_QUEUE          8
+
+// Passed to thread_timeout_set for sleeping without a timeout
+#define THREAD_TIMEOUT_NONE         ((uint64_t) -1)
 
 #define THREAD_TTL_GAIN             2
 
 #define PROCESS_TERM_THREADS        (1 << 0)
 
+// Number of IPC buffer page tables a process keeps for reuse (see ipc.h)
+#define PROCESS_IPC_POOL            8
+
+// Bits of thread_t.on_cpu
+#define THREAD_ON_CPU_MASK          0xFFFF
+#define THREAD_ON_CPU_FREE          (1 << 16)
+
+// Number of futex wait queues per process (hashed by the futex's address)
+#define FUTEX_QUEUE_BITS            6
+#define FUTEX_QUEUES                (1 << FUTEX_QUEUE_BITS)
+
 //- Multitasking Structures ----------------------------------------------------
 
 typedef struct stack_t {
@@ -49,8 +72,53 @@ typedef struct stack_t {
      * The current length of the stack.
      */
     uintptr_t length;
+
+    /**
+     * The length the stack may grow to.
+     */
+    uintptr_t limit;
 } stack_t;
 
+/**
+ * A stack slot in the process's stack space, released by a stopped thread.
+ */
+typedef struct stack_slot_t {
+    /**
+     * The upper bound of the slot's stack.
+     */
+    uintptr_t address;
+
+    /**
+     * The length of the stack that is still mapped.
+     */
+    uintptr_t length;
+
+    struct stack_slot_t *next;
+} stack_slot_t;
+
+/**
+ * Entry of a thread in the wait queue of a futex.
+ */
+typedef struct futex_waiter_t {
+    /**
+     * The address of the futex in the process's address space.
+     */
+    uintptr_t futex;
+
+    /**
+     * The waiting thread.
+     */
+    struct thread_t *thread;
+
+    /**
+     * The index of the futex in the vector the thread waits on.
+     */
+    uint32_t index;
+
+    struct futex_waiter_t *next;
+    struct futex_waiter_t *prev;
+} futex_waiter_t;
+
 typedef struct thread_t {
     /**
      * The thread's id that is unique among the all the threads of the
@@ -85,6 +153,12 @@ typedef struct thread_t {
      */
     void *role_ctx;
 
+    /**
+     * The next thread in the process's list of waiting receivers or in the
+     * waiters of an IPC queue.
+     */
+    struct thread_t *ipc_next;
+
     /**
      * The reason why the thread sleeps.
      */
@@ -95,6 +169,23 @@ typedef struct thread_t {
      */
     void *sleep_ctx;
 
+    /**
+     * Timeout waking the thread from sleeping.
+     */
+    timeout_t timeout;
+
+    /**
+     * The entries linked into futex wait queues while the thread sleeps on
+     * futexes and their number (zero if not waiting).
+     */
+    futex_waiter_t *futex_waiters;
+    uint32_t futex_waiter_count;
+
+    /**
+     * Entry used for waiting on a single futex.
+     */
+    futex_waiter_t futex_waiter;
+
     /**
      * Pointer to the thread's result.
      */
@@ -105,6 +196,12 @@ typedef struct thread_t {
      */
     uint32_t ipc_buffer_sz[3];
 
+    /**
+     * The number of bytes mapped for the thread's IPC buffers, which are kept
+     * when they shrink (the high-water mark).
+     */
+    uint32_t ipc_buffer_mapped[2];
+
     /**
      * Flags describing the thread.
      */
@@ -116,19 +213,68 @@ typedef struct thread_t {
     uintptr_t entry_point;
 
     /**
-     * Pointer to 512-byte data for SSE.
+     * Pointer to the save area for the FPU, SSE and AVX state
+     * (fpu_state_size bytes).
+     *
+     * Only up to date while the thread is not running, if it has used the FPU
+     * since it has been switched to.
      */
     void *fx_data;
 
     /**
-     * Backup of the thread's state since the last preemption.
+     * Index of the processor that loaded the thread's FPU state last plus one
+     * (zero if never loaded).
+     */
+    uint32_t fpu_cpu;
+
+    /**
+     * The thread's interrupt frame at the top of its kernel stack.
+     *
+     * Holds the thread's user mode state while it is not running.
+     */
+    cpu_int_state_t *state;
+
+    /**
+     * Top of the thread's kernel stack (loaded into the TSS while running).
      */
-    cpu_int_state_t state;
+    uintptr_t kernel_stack;
+
+    /**
+     * The address space of the hosting process.
+     *
+     * Kept with the thread, so switching to it does not depend on the process
+     * structure, which might be disposed concurrently.
+     */
+    uintptr_t addr_space;
+
+    /**
+     * Index of the processor running the thread plus one (or zero if not
+     * running), ORed with THREAD_ON_CPU_FREE once the thread is to be freed
+     * as soon as it is not running anymore.
+     */
+    volatile uint32_t on_cpu;
+
+    /**
+     * Index of the processor whose run queue the thread is (or was last) in.
+     */
+    uint32_t cpu;
 
     /**
      * The thread's stack.
      */
     stack_t stack;
+
+    /**
+     * The address of the thread's slot in the kernel data pages, loaded as
+     * user GS base while the thread runs (see kdata.h).
+     */
+    uintptr_t kdata;
+
+    /**
+     * The number of times the thread has been passed over in favor of a
+     * thread in the current address space since it last ran.
+     */
+    uint8_t sched_skipped;
     
     struct thread_t *next_sched;
     struct thread_t *next;
@@ -167,16 +313,89 @@ typedef struct process_t {
      */
     thread_t *threads;
 
+    /**
+     * Maps the ids of the process's threads to the threads.
+     */
+    idmap_t thread_map;
+
     /**
      * The physical address of the process's address space structure.
      */
     uintptr_t addr_space;
 
+    /**
+     * Wait queues of the process's futexes, hashed by the futexes' addresses.
+     */
+    futex_waiter_t *futex_queues[FUTEX_QUEUES];
+
     /**
      * The offset in the process's stack space.
      */
     uint64_t stack_offset;
 
+    /**
+     * Released stack slots that still have pages mapped and their number.
+     */
+    stack_slot_t *stack_warm;
+    uint32_t stack_warm_count;
+
+    /**
+     * Released stack slots without pages.
+     */
+    stack_slot_t *stack_cold;
+
+    /**
+     * Threads waiting for messages (see ipc_reply_and_wait).
+     */
+    struct thread_t *ipc_receivers;
+
+    /**
+     * The IPC queues owned by the process.
+     */
+    struct ipc_queue_t *ipc_queues;
+
+    /**
+     * The number of bytes mapped by each parked IPC buffer page table (zero
+     * for free slots, see IPC_POOL_VADDR).
+     */
+    uint32_t ipc_pool[PROCESS_IPC_POOL];
+
+    /**
+     * The regions whose page faults are forwarded to pagers (see pager.h).
+     */
+    struct pager_region_t *pager_regions;
+
+    /**
+     * The shared memory regions mapped by the process (see shm.h).
+     */
+    struct shm_mapping_t *shm_mappings;
+
+    /**
+     * The address of the process's submission ring or zero, if not set up.
+     *
+     * Set once, after the ring has been initialized.
+     */
+    volatile uintptr_t ring;
+
+    /**
+     * Held while the ring's submissions are processed, by ring_enter or the
+     * timer (see syscall_ring_poll).
+     */
+    spinlock_t ring_lock;
+
+    /**
+     * Set while the process is terminated, so its threads' memory is left to
+     * the disposal of the address space.
+     */
+    bool terminating;
+
+    /**
+     * Lock protecting the process's state and its threads.
+     *
+     * Must only be acquired while holding process_table_lock for reading.
+     */
+    spinlock_t lock;
+
     struct process_t *next;
 } process_t;
 
@@ -185,31 +404,142 @@ typedef struct process_t {
 #define STACK_LENGTH_MAX (0x200000 - 0x1000) // -1 page as guard to prevent overflows
 #define STACK_PROCESS_MAX 0x8000000000
 
-void stack_create(stack_t *stack, process_t *process);
+// Length mapped when creating a stack, so new threads do not fault right away
+#define STACK_PREFAULT_LENGTH 0x4000
+
+// Granularity in which stacks grow on page faults
+#define STACK_GROW_LENGTH 0x4000
+
+// Length of a released stack that stays mapped for the next thread
+#define STACK_WARM_LENGTH 0x4000
+
+// Number of released stacks per process that stay mapped
+#define STACK_WARM_MAX 8
+
+/**
+ * Creates a stack for a new thread of the given process, reusing a released
+ * stack slot if possible.
+ *
+ * @param stack The stack to create.
+ * @param process The process hosting the thread.
+ * @param limit The length the stack may grow to (zero for STACK_LENGTH_MAX).
+ */
+void stack_create(stack_t *stack, process_t *process, uintptr_t limit);
+
+/**
+ * Releases the stack of a stopped thread, trimming it and keeping its slot for
+ * reuse.
+ *
+ * Must be called while in the process's address space.
+ *
+ * @param stack The stack to release.
+ * @param process The process hosting the thread.
+ */
 void stack_dispose(stack_t *stack, process_t *process);
+
 void stack_resize(stack_t *stack, uintptr_t new_len, process_t *process);
 
+/**
+ * Frees the lists of released stack slots of a terminated process (the pages
+ * go with the address space).
+ *
+ * @param process The terminated process.
+ */
+void stack_slots_dispose(process_t *process);
+
+//- Kernel Stacks --------------------------------------------------------------
+
+// Size of a thread's kernel stack
+#define KERNEL_STACK_SIZE 0x4000
+
+// Virtual address space reserved per kernel stack (includes guard pages)
+#define KERNEL_STACK_SLOT 0x8000
+
+// Number of released kernel stacks that are kept mapped for reuse
+#define KERNEL_STACK_CACHE 64
+
+/**
+ * Allocates a kernel stack in the shared kernel region.
+ *
+ * @return The top of the stack.
+ */
+uintptr_t kernel_stack_create(void);
+
+/**
+ * Releases the given kernel stack.
+ *
+ * Must not be called while the stack is in use.
+ *
+ * @param top The top of the stack, as returned by kernel_stack_create.
+ */
+void kernel_stack_dispose(uintptr_t top);
+
 //- Processes ------------------------------------------------------------------
 
-#define PROCESS_MAX         1024
-#define PROCESS_MAP_SIZE    (PROCESS_MAX * sizeof(uintptr_t))
+#define PROCESS_MAX         IDMAP_MAX
 
 process_t *process_list;
-process_t *process_current;
+
+/**
+ * The process of the thread running on the current processor.
+ */
+#define process_current (smp_cpu()->process)
+
+/**
+ * Lock protecting the process table and the existence of processes and
+ * threads.
+ *
+ * Held for reading (together with the process's lock) while operating on the
+ * current process only, for writing while creating or terminating processes,
+ * terminating threads or accessing other processes.
+ */
+extern rwlock_t process_table_lock;
 
 void process_init(void);
 process_t *process_spawn(uintptr_t addr_space, process_t *parent);
 process_t *process_get(uint32_t pid);
 void process_terminate(uint32_t pid);
 
+/**
+ * Locks the process table and the current process before operating on the
+ * current process (e.g. in a system call or fault handler).
+ *
+ * @param exclusive Whether to lock the process table for writing, so other
+ *  processes may be accessed, created or terminated.
+ * @return The current process or a null pointer, if the current thread has
+ *  been terminated by another processor meanwhile (nothing is locked then and
+ *  the caller should switch to another thread).
+ */
+process_t *process_lock_current(bool exclusive);
+
+/**
+ * Releases the locks acquired using process_lock_current.
+ *
+ * @param process The process returned by process_lock_current (may have been
+ *  terminated meanwhile if exclusive).
+ * @param exclusive The value passed to process_lock_current.
+ */
+void process_unlock_current(process_t *process, bool exclusive);
+
 //- Thread ---------------------------------------------------------------------
 
-#define THREAD_MAX          1024
-#define THREAD_MAP_SIZE     (THREAD_MAX * sizeof(uintptr_t))
+#define THREAD_MAX          IDMAP_MAX
 
-thread_t *thread_current;
+/**
+ * The thread running on the current processor.
+ */
+#define thread_current (smp_cpu()->thread)
 
-thread_t *thread_spawn(process_t *process, uintptr_t entry_point);
+/**
+ * Creates a frozen thread in the given process.
+ *
+ * @param process The process to create the thread in.
+ * @param entry_point The thread's entry point.
+ * @param stack_limit The length the thread's stack may grow to (zero for the
+ *  maximum).
+ * @return The thread or a null pointer, if the process has too many threads.
+ */
+thread_t *thread_spawn(process_t *process, uintptr_t entry_point, uintptr_t stack_limit);
 thread_t *thread_get(process_t *process, uint32_t tid);
 
 void thread_stop(process_t *process, thread_t *thread);
@@ -223,15 +553,173 @@ void thread_thaw(thread_t *thread, uint8_t flags);
 bool thread_join_sleep(thread_t *thread, thread_t *wait_for);
 void thread_join_awake(thread_t *thread, thread_t *wait_for);
 
+/**
+ * Arms the timeout of the given sleeping (frozen) thread.
+ *
+ * When the timeout expires before the thread is woken, the sleep is aborted
+ * and the thread's result registers are set depending on its sleep mode.
+ * The timeout is canceled when the thread is thawed or stopped.
+ *
+ * @param thread The thread to arm the timeout for.
+ * @param ns The timeout in nanoseconds (THREAD_TIMEOUT_NONE for none).
+ */
+void thread_timeout_set(thread_t *thread, uint64_t ns);
+
+/**
+ * Aborts the sleep of all threads whose timeout expired.
+ *
+ * Called by the bootstrap processor's timer handler after advancing the
+ * timeout wheel.
+ */
+void thread_timeouts_run(void);
+
+/**
+ * Marks the given thread as running on the current processor.
+ *
+ * @param thread The thread to claim.
+ * @return Whether the thread has been claimed, i.e. is not running on
+ *  another processor and is not about to be freed.
+ */
+bool thread_claim(thread_t *thread);
+
+/**
+ * Switches the current processor to the given thread (or to idling).
+ *
+ * Does not copy any registers: The interrupt returns to the frame on the
+ * kernel stack of the thread switched to (see cpu_int_handle).
+ *
+ * @param thread The thread to switch to or a null pointer to idle.
+ * @param state The frame of the current interrupt.
+ */
 void thread_switch(thread_t *thread, cpu_int_state_t *state);
 
+/**
+ * Enables the FPU for the current thread on its first use since it has been
+ * switched to, loading its state unless still loaded.
+ */
+void thread_fpu_activate(void);
+
+/**
+ * Releases the thread switched away from during the current interrupt.
+ *
+ * Called by the interrupt handler after leaving the thread's kernel stack.
+ */
+void thread_switch_finish(void);
+
+//- Futex Wait Queues ----------------------------------------------------------
+
+/**
+ * Links the given entries into the wait queues of their futexes, after their
+ * futex and index fields have been set.
+ *
+ * @param process The process hosting the thread.
+ * @param thread The thread that is about to sleep.
+ * @param waiters The entries (the thread's futex_waiter or a heap allocated
+ *  array, that is freed once the thread stops waiting).
+ * @param count The number of entries.
+ */
+void futex_enqueue(process_t *process, thread_t *thread, futex_waiter_t *waiters, uint32_t count);
+
+/**
+ * Unlinks all entries of the given thread from the futex wait queues.
+ *
+ * @param process The process hosting the thread.
+ * @param thread The thread that stops waiting.
+ */
+void futex_dequeue(process_t *process, thread_t *thread);
+
+/**
+ * Wakes threads waiting on the given futex.
+ *
+ * Threads waiting on a vector of futexes return the index of the futex they
+ * have been woken by.
+ *
+ * @param process The process hosting the futex.
+ * @param futex The address of the futex.
+ * @param count The maximum number of threads to wake.
+ * @return The number of threads woken.
+ */
+uint32_t futex_wake(process_t *process, uintptr_t futex, uint32_t count);
+
+/**
+ * Wakes a single thread waiting on the given futex, that the caller is going
+ * to switch to directly.
+ *
+ * The thread is claimed for the current processor if possible, so others do
+ * not pick it from their run queues meanwhile.
+ *
+ * @param process The process hosting the futex.
+ * @param futex The address of the futex.
+ * @return The thread woken or a null pointer, if none is waiting.
+ */
+thread_t *futex_wake_one(process_t *process, uintptr_t futex);
+
+/**
+ * Moves threads waiting on the given futex to the queue of another futex.
+ *
+ * @param process The process hosting the futexes.
+ * @param futex The address of the futex.
+ * @param target The address of the futex to move the threads to.
+ * @param count The maximum number of threads to move.
+ * @return The number of threads moved.
+ */
+uint32_t futex_requeue(process_t *process, uintptr_t futex, uintptr_t target, uint32_t count);
+
+/**
+ * Removes the thread that has waited the longest on the given priority
+ * inheritance futex from its wait queue, without thawing it.
+ *
+ * The caller hands the futex over to the thread and thaws it then.
+ *
+ * @param process The process hosting the futex.
+ * @param futex The address of the futex.
+ * @param others Set to whether other threads keep waiting on the futex.
+ * @return The thread or a null pointer, if none is waiting.
+ */
+thread_t *futex_wake_pi(process_t *process, uintptr_t futex, bool *others);
+
 //- Scheduler ------------------------------------------------------------------
 
 #define SCHED_FLAG_THAWED (1 << 0)
 #define SCHED_FLAG_INSTANT (1 << 1)
 
+// Number of threads at the front of a run queue searched for one in the
+// current address space
+#define SCHED_SPACE_SCAN 4
+
+// Number of times a thread may be passed over for one in the current address
+// space, before it runs regardless
+#define SCHED_SKIP_MAX 2
+
 void scheduler_add(thread_t *thread, uint8_t flags);
 void scheduler_remove(thread_t *thread);
 
+/**
+ * Moves the given thread to the current processor's run queue, if it is
+ * queued on another processor.
+ *
+ * @param thread The thread to move (claimed by the current processor).
+ */
+void scheduler_migrate(thread_t *thread);
+
+/**
+ * Returns the number of runnable threads on the current processor.
+ *
+ * @return Number of threads in the current processor's run queue.
+ */
+size_t scheduler_count(void);
+
+/**
+ * Picks and claims the next thread to run on the current processor.
+ *
+ * Prefers threads in the current address space among the first threads in
+ * the run queue, to avoid flushing the TLB, but runs the first thread once it
+ * has been passed over SCHED_SKIP_MAX times.
+ *
+ * Steals a thread from another processor, if there is nothing to run
+ * locally.
+ *
+ * @return The next thread or a null pointer for idling.
+ */
 thread_t *scheduler_next(void);
 thread_t *scheduler_current(void);
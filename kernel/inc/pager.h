@@ -0,0 +1,153 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/map.h>
+#include <cpu.h>
+#include <ipc.h>
+#include <multitasking.h>
+
+//- External Pager -------------------------------------------------------------
+
+// Maximum number of regions per process
+#define PAGER_REGIONS_MAX 64
+
+// Maximum number of mappings considered per response
+#define PAGER_MAP_MAX 512
+
+// Number of mappings of a response translated per switch of address spaces
+// (copied to the kernel stack)
+#define PAGER_MAP_BATCH 32
+
+// Flags of a mapping in a pager's response
+#define PAGER_MAP_WRITEABLE (1 << 0)
+
+// Bits of the page fault's error code (the access type)
+#define PAGER_FAULT_PRESENT (1 << 0)    // Protection violation (not missing)
+#define PAGER_FAULT_WRITE   (1 << 1)
+#define PAGER_FAULT_FETCH   (1 << 4)
+
+/**
+ * A region of a process's address space whose page faults are forwarded to
+ * a pager process.
+ */
+typedef struct pager_region_t {
+    /**
+     * The page aligned bounds of the region (end exclusive).
+     */
+    uintptr_t start;
+    uintptr_t end;
+
+    /**
+     * The id of the pager process.
+     */
+    uint32_t pager;
+
+    struct pager_region_t *next;
+} pager_region_t;
+
+/**
+ * The payload of the message a pager receives for a page fault (with
+ * IPC_FLAG_PAGE_FAULT set).
+ */
+typedef struct pager_fault_t {
+    /**
+     * The faulting address and the page fault's error code.
+     */
+    uint64_t address;
+    uint64_t error_code;
+
+    /**
+     * The faulting process and thread.
+     */
+    uint32_t pid;
+    uint32_t tid;
+} PACKED pager_fault_t;
+
+/**
+ * A mapping in the response of a pager; the response's payload is an array
+ * of mappings.
+ */
+typedef struct pager_map_t {
+    /**
+     * The page in the pager's address space whose frame to map, which must be
+     * in a shared memory region mapped by the pager (see shm_map_paged).
+     */
+    uint64_t source;
+
+    /**
+     * The page in the faulting process's address space to map the frame to
+     * (must be in a region served by the pager and not mapped yet).
+     */
+    uint64_t target;
+
+    /**
+     * See PAGER_MAP_*.
+     */
+    uint64_t flags;
+} PACKED pager_map_t;
+
+/**
+ * Registers a region of the given process to be served by a pager.
+ *
+ * @param process The process whose region to register.
+ * @param start The start of the region.
+ * @param length The length of the region.
+ * @param pager The id of the pager process.
+ * @return Whether the region is valid and does not overlap another one.
+ */
+bool pager_register(process_t *process, uintptr_t start, size_t length, uint32_t pager);
+
+/**
+ * Forwards a page fault of the current thread to the pager of the region
+ * containing the faulting address, if any, and freezes the thread until the
+ * pager responds.
+ *
+ * Requires the process table to be locked for writing.
+ *
+ * @param process The current process.
+ * @param address The faulting address.
+ * @param error_code The page fault's error code.
+ * @param state The state of the faulting thread.
+ * @return Whether the fault has been forwarded (switched threads then).
+ */
+bool pager_fault(process_t *process, uintptr_t address, uint64_t error_code, cpu_int_state_t *state);
+
+/**
+ * Maps the pages of the current thread's response to a forwarded page fault
+ * into the faulting process.
+ *
+ * Requires the process table to be locked for writing.
+ *
+ * @param role_ctx The role context of the current (receiver) thread.
+ * @param length The length of the response, an array of pager_map_t.
+ * @param process The faulting process.
+ * @return Whether the fault has been resolved, so the faulting thread can
+ *  retry its access.
+ */
+bool pager_resolve(ipc_role_ctx_t *role_ctx, uint32_t length, process_t *process);
+
+/**
+ * Frees the pager regions of the given process.
+ *
+ * @param process The process.
+ */
+void pager_dispose(process_t *process);
@@ -0,0 +1,212 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <api/types.h>
+#include <multitasking.h>
+
+//- Shared Memory --------------------------------------------------------------
+
+// Maximum number of pages per region
+#define SHM_PAGES_MAX 0x4000
+
+// Maximum number of regions a process maps
+#define SHM_MAPPINGS_MAX 64
+
+// Returned by shm_create if the region could not be created
+#define SHM_NONE ((uint32_t) -1)
+
+// Number of frames per chunk of a region's frame list (a chunk fills a heap
+// slot of a page)
+#define SHM_CHUNK_FRAMES 510
+
+/**
+ * A chunk of the frames of a region.
+ */
+typedef struct shm_chunk_t {
+    uintptr_t frames[SHM_CHUNK_FRAMES];
+    struct shm_chunk_t *next;
+} shm_chunk_t;
+
+/**
+ * A process's right to map a region.
+ */
+typedef struct shm_grant_t {
+    /**
+     * The id of the process.
+     */
+    uint32_t pid;
+
+    /**
+     * Whether the process may map the region writeable.
+     */
+    bool writeable;
+
+    struct shm_grant_t *next;
+} shm_grant_t;
+
+/**
+ * A region of memory shared between processes.
+ *
+ * Exists (and keeps its id) as long as it is mapped by any process, its
+ * frames are freed with the last mapping.
+ */
+typedef struct shm_t {
+    /**
+     * The id of the region.
+     */
+    uint32_t id;
+
+    /**
+     * The number of mappings of the region.
+     */
+    uint32_t refs;
+
+    /**
+     * The processes allowed to map the region (besides those mapping it).
+     */
+    shm_grant_t *grants;
+
+    /**
+     * The next region (in the list of all regions).
+     */
+    struct shm_t *next;
+
+    /**
+     * The number of pages and their frames, in chunks of SHM_CHUNK_FRAMES.
+     */
+    size_t pages;
+    shm_chunk_t *chunks;
+} shm_t;
+
+/**
+ * A region (or a range of its pages) mapped into a process's address space.
+ */
+typedef struct shm_mapping_t {
+    /**
+     * The region and the page aligned address it is mapped at.
+     */
+    shm_t *shm;
+    uintptr_t start;
+
+    /**
+     * The index of the region's first mapped page and the number of pages.
+     */
+    size_t first;
+    size_t pages;
+
+    /**
+     * Whether the region is mapped writeable.
+     */
+    bool writeable;
+
+    /**
+     * Whether the page has been mapped by a pager (see shm_map_paged). Such
+     * mappings neither grant rights to the region nor count against
+     * SHM_MAPPINGS_MAX.
+     */
+    bool paged;
+
+    struct shm_mapping_t *next;
+} shm_mapping_t;
+
+/**
+ * Initializes the map of region ids.
+ */
+void shm_init(void);
+
+/**
+ * Creates a region of zeroed frames and maps it writeable into the current
+ * process at the given address.
+ *
+ * The pages of the range must not be mapped yet. Like all functions below,
+ * requires the process table to be locked for writing.
+ *
+ * @param process The current process.
+ * @param address The page aligned address to map the region at.
+ * @param pages The number of pages of the region.
+ * @return The id of the region or SHM_NONE.
+ */
+uint32_t shm_create(process_t *process, uintptr_t address, size_t pages);
+
+/**
+ * Allows another process to map a region the current process maps.
+ *
+ * @param process The current process.
+ * @param id The id of the region.
+ * @param pid The id of the process to grant the right to.
+ * @param writeable Whether to allow writeable mappings (requires a writeable
+ *  mapping of the current process).
+ * @return Whether the right has been granted.
+ */
+bool shm_grant(process_t *process, uint32_t id, uint32_t pid, bool writeable);
+
+/**
+ * Maps a region the current process has been granted (or maps already) at
+ * the given address.
+ *
+ * @param process The current process.
+ * @param id The id of the region.
+ * @param address The page aligned address to map the region at.
+ * @param writeable Whether to map the region writeable.
+ * @return Whether the region has been mapped.
+ */
+bool shm_map(process_t *process, uint32_t id, uintptr_t address, bool writeable);
+
+/**
+ * Maps a page of a region mapped by a pager into the current process, in
+ * response to a page fault (see pager_resolve).
+ *
+ * The mapping holds a reference to the region, so the page's frame is kept
+ * when the pager unmaps the region or terminates.
+ *
+ * @param pager The pager process.
+ * @param source The page in the pager's address space.
+ * @param process The current process.
+ * @param target The page aligned address to map the page at (not mapped yet).
+ * @param writeable Whether to map the page writeable (requires a writeable
+ *  mapping of the pager).
+ * @return Whether the source is in a region mapped by the pager with the
+ *  required rights.
+ */
+bool shm_map_paged(
+        process_t *pager,
+        uintptr_t source,
+        process_t *process,
+        uintptr_t target,
+        bool writeable);
+
+/**
+ * Unmaps the region mapped at the given address from the current process,
+ * freeing it if this has been its last mapping.
+ *
+ * @param process The current process.
+ * @param address The address the region is mapped at.
+ * @return Whether a region has been mapped at the address.
+ */
+bool shm_unmap(process_t *process, uintptr_t address);
+
+/**
+ * Releases the mappings and the rights of a process that is terminated.
+ *
+ * The pages are left to the disposal of the address space.
+ *
+ * @param process The process.
+ */
+void shm_dispose(process_t *process);
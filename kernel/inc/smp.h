@@ -0,0 +1,303 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <api/types.h>
+#include <cpu.h>
+#include <spinlock.h>
+
+//- Per-CPU Data ---------------------------------------------------------------
+
+#define SMP_CPU_MAX 64
+
+// Size of the kernel stack of each application processor
+#define SMP_STACK_SIZE 0x4000
+
+// Virtual address space reserved per stack (includes guard pages)
+#define SMP_STACK_SLOT 0x8000
+
+struct thread_t;
+struct process_t;
+
+/**
+ * Data that is private to a processor.
+ *
+ * The GS base of each processor points to its structure while in the kernel.
+ */
+typedef struct smp_cpu_t {
+    /**
+     * Pointer to the structure itself (read using gs:0).
+     */
+    struct smp_cpu_t *self;
+
+    /**
+     * The thread currently running on the processor.
+     */
+    struct thread_t *thread;
+
+    /**
+     * The process of the thread currently running on the processor.
+     */
+    struct process_t *process;
+
+    /**
+     * The processor's index in smp_cpus.
+     */
+    uint32_t index;
+
+    /**
+     * The id of the processor's local APIC.
+     */
+    uint8_t apic_id;
+
+    /**
+     * Whether the processor has completed its initialization.
+     */
+    volatile bool online;
+
+    /**
+     * Whether the processor has no thread to run.
+     */
+    volatile bool idle;
+
+    /**
+     * The address space the processor has switched to last.
+     *
+     * Written by memory_space_switch (boot.s relies on the offset 0x20).
+     */
+    volatile uintptr_t addr_space;
+
+    /**
+     * Top of the processor's stack (used for booting and idling, threads take
+     * interrupts on their own kernel stacks).
+     */
+    uintptr_t stack_top;
+
+    /**
+     * The processor's task state segment.
+     */
+    cpu_tss_t *tss;
+
+    /**
+     * Top of the current thread's kernel stack, like the TSS's rsp0
+     * (syscall_entry relies on the offset 0x38).
+     */
+    uintptr_t kernel_stack;
+
+    /**
+     * The user stack pointer while entering a system call (syscall_entry
+     * relies on the offset 0x40).
+     */
+    uintptr_t syscall_rsp;
+
+    /**
+     * The frame the current interrupt returns to.
+     *
+     * Set to the interrupted frame on entry and replaced by thread_switch.
+     */
+    cpu_int_state_t *resume;
+
+    /**
+     * The thread switched away from during the current interrupt, released
+     * once its kernel stack has been left (see thread_switch_finish).
+     */
+    struct thread_t *switch_prev;
+
+    /**
+     * The interrupted idle loop (or boot code) to resume when idle again.
+     */
+    cpu_int_state_t *idle_context;
+
+    /**
+     * The address space the idle loop is disposing (see memory_space_reap).
+     */
+    uintptr_t idle_space;
+
+    /**
+     * Whether to leave the current address space when idle, as it is about to
+     * be disposed.
+     */
+    volatile bool space_leave;
+
+    /**
+     * The thread whose FPU state has been loaded into the processor last.
+     */
+    struct thread_t *fpu_owner;
+
+    /**
+     * Whether the FPU is enabled for the current thread, i.e. it has used the
+     * FPU since it has been switched to.
+     */
+    bool fpu_active;
+
+    /**
+     * Lock for the processor's run queue.
+     */
+    spinlock_t sched_lock;
+
+    /**
+     * The processor's run queue.
+     */
+    struct thread_t *sched_first;
+    struct thread_t *sched_last;
+
+    /**
+     * The number of threads in the run queue.
+     */
+    volatile size_t sched_count;
+
+    /**
+     * The number of switches to a thread and how many of them switched the
+     * address space.
+     */
+    uint64_t switch_count;
+    uint64_t switch_space_count;
+
+    /**
+     * Whether the processor's timer has been started.
+     */
+    bool timer_enabled;
+
+    /**
+     * Elapsed timer counts that do not make up a full tick yet.
+     */
+    uint32_t timer_residual;
+
+    /**
+     * Whether a TLB shootdown request is pending for this processor.
+     */
+    volatile bool tlb_pending;
+} smp_cpu_t;
+
+/**
+ * The number of processors that have been started.
+ */
+extern volatile size_t smp_cpu_count;
+
+/**
+ * The per-CPU data of all started processors, indexed by smp_cpu_t.index.
+ */
+extern smp_cpu_t *smp_cpus[SMP_CPU_MAX];
+
+/**
+ * Returns the per-CPU data of the current processor.
+ *
+ * @return The current processor's data.
+ */
+static inline smp_cpu_t *smp_cpu(void) {
+    smp_cpu_t *cpu;
+    asm volatile ("mov %%gs:0, %0" : "=r" (cpu));
+    return cpu;
+}
+
+/**
+ * Points the GS base of the bootstrap processor to its per-CPU data.
+ *
+ * Must be called before any other kernel facility is used.
+ */
+void smp_init(void);
+
+/**
+ * Creates the GDT and TSS of the current processor.
+ *
+ * @param cpu The current processor's data.
+ */
+void smp_cpu_setup(smp_cpu_t *cpu);
+
+//- Processor Startup ----------------------------------------------------------
+
+// Physical address the AP trampoline is copied to (below 1MB, page aligned)
+#define SMP_TRAMPOLINE_PADDR 0x8000
+
+/**
+ * Starts all application processors listed in the MADT.
+ *
+ * Requires the initial address space (identity mapping of low memory) and a
+ * calibrated timer. The started processors wait for smp_release.
+ */
+void smp_boot(void);
+
+/**
+ * Lets the application processors start scheduling.
+ */
+void smp_release(void);
+
+/**
+ * Entry point of application processors (called by the trampoline).
+ *
+ * @param cpu The processor's data.
+ */
+void smp_ap_main(smp_cpu_t *cpu);
+
+//- Inter-Processor Interrupts -------------------------------------------------
+
+// Asks a processor to reschedule
+#define SMP_RESCHEDULE_VECTOR 0x41
+
+// Asks a processor to invalidate TLB entries
+#define SMP_TLB_VECTOR 0x42
+
+// Address for TLB shootdowns that flush the whole address space
+#define SMP_TLB_FLUSH_ALL ((uintptr_t) -1)
+
+/**
+ * Handles a reschedule IPI without building a full frame (see idt.s).
+ *
+ * @return Whether the full handler has to switch threads.
+ */
+bool smp_reschedule_fast(void);
+
+/**
+ * Handles a reschedule IPI that has to switch threads.
+ *
+ * @param state The interrupt state.
+ */
+void smp_reschedule_handler(cpu_int_state_t *state);
+
+/**
+ * Handles a TLB shootdown IPI without building a full frame (see idt.s).
+ *
+ * @return Always false.
+ */
+bool smp_tlb_fast(void);
+
+/**
+ * Asks the given processor to reschedule, i.e. to reevaluate its current
+ * thread and its timer.
+ *
+ * @param cpu The processor to notify.
+ */
+void smp_reschedule(smp_cpu_t *cpu);
+
+/**
+ * Invalidates the given page on all processors that may have cached it.
+ *
+ * Pages in the shared kernel region are invalidated everywhere, other pages
+ * only on processors using the current address space. Returns after all
+ * processors have acknowledged.
+ *
+ * @param vaddr The page to invalidate or SMP_TLB_FLUSH_ALL.
+ */
+void smp_tlb_shootdown(uintptr_t vaddr);
+
+/**
+ * Handles a pending TLB shootdown request for the current processor.
+ *
+ * Called while spinning with interrupts disabled to avoid deadlocks.
+ */
+void smp_tlb_poll(void);
@@ -0,0 +1,149 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <api/types.h>
+
+//- Spinlocks ------------------------------------------------------------------
+
+/**
+ * A spinlock.
+ *
+ * The kernel runs with interrupts disabled, so a spinlock may be acquired in
+ * any context. Recursive acquisition is only permitted using the recursive
+ * variants, which track the owning processor.
+ */
+typedef struct spinlock_t {
+    /**
+     * Non-zero while the lock is held.
+     */
+    volatile uint32_t locked;
+
+    /**
+     * Index of the owning processor plus one (recursive variants only).
+     */
+    volatile uint32_t owner;
+
+    /**
+     * Number of times the owner acquired the lock (recursive variants only).
+     */
+    uint32_t depth;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0, 0, 0 }
+
+/**
+ * Acquires the given lock, spinning until it becomes available.
+ *
+ * Pending TLB shootdown requests are handled while spinning.
+ *
+ * @param lock The lock to acquire.
+ */
+void spinlock_acquire(spinlock_t *lock);
+
+/**
+ * Tries to acquire the given lock without spinning.
+ *
+ * @param lock The lock to acquire.
+ * @return Whether the lock has been acquired.
+ */
+bool spinlock_try_acquire(spinlock_t *lock);
+
+/**
+ * Releases the given lock.
+ *
+ * @param lock The lock to release.
+ */
+void spinlock_release(spinlock_t *lock);
+
+/**
+ * Acquires the given lock, unless already held by the current processor, in
+ * which case only the recursion depth is increased.
+ *
+ * @param lock The lock to acquire.
+ */
+void spinlock_acquire_recursive(spinlock_t *lock);
+
+/**
+ * Releases one level of a recursively acquired lock.
+ *
+ * @param lock The lock to release.
+ */
+void spinlock_release_recursive(spinlock_t *lock);
+
+/**
+ * Checks whether the given lock is held by the current processor (recursive
+ * variants only).
+ *
+ * @param lock The lock to check.
+ * @return Whether the current processor owns the lock.
+ */
+bool spinlock_owned(spinlock_t *lock);
+
+//- Reader-Writer Locks --------------------------------------------------------
+
+// Set in rwlock_t.writer while a writer holds or waits for the lock
+#define RWLOCK_WRITER 1
+
+/**
+ * A reader-writer spinlock.
+ *
+ * Any number of readers may hold the lock at the same time, while a writer
+ * holds it exclusively. Waiting writers keep new readers from entering.
+ */
+typedef struct rwlock_t {
+    /**
+     * The number of readers holding the lock.
+     */
+    volatile uint32_t readers;
+
+    /**
+     * RWLOCK_WRITER while a writer holds or waits for the lock.
+     */
+    volatile uint32_t writer;
+} rwlock_t;
+
+#define RWLOCK_INIT { 0, 0 }
+
+/**
+ * Acquires the given lock for reading.
+ *
+ * @param lock The lock to acquire.
+ */
+void rwlock_read_acquire(rwlock_t *lock);
+
+/**
+ * Releases the given lock after reading.
+ *
+ * @param lock The lock to release.
+ */
+void rwlock_read_release(rwlock_t *lock);
+
+/**
+ * Acquires the given lock for writing, waiting for all readers to leave.
+ *
+ * @param lock The lock to acquire.
+ */
+void rwlock_write_acquire(rwlock_t *lock);
+
+/**
+ * Releases the given lock after writing.
+ *
+ * @param lock The lock to release.
+ */
+void rwlock_write_release(rwlock_t *lock);
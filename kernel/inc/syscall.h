@@ -18,7 +18,9 @@
 
 #pragma once
 #include <api/types.h>
+#include <api/compiler.h>
 #include <cpu.h>
+#include <syscall_table.h>
 
 //- System Call API ------------------------------------------------------------
 
@@ -27,11 +29,6 @@
  */
 #define SYSCALL_INT_VECTOR 0x80
 
-/**
- * The number of defined system calls.
- */
-#define SYSCALL_COUNT 55
-
 /**
  * Type for system call handlers.
  *
@@ -39,6 +36,20 @@
  */
 typedef void (* syscall_handler_t)(cpu_int_state_t *);
 
+// Locking required by a system call (see process_lock_current)
+#define SYSCALL_LOCK_NONE       0   // Only accesses the calling thread
+#define SYSCALL_LOCK_PROCESS    1   // Accesses the calling process
+#define SYSCALL_LOCK_GLOBAL     2   // Accesses other processes or terminates
+
+/**
+ * The handlers and locking of the system calls and whether they can be
+ * submitted using the submission ring, indexed by number (generated from
+ * syscalls.def, see syscall_table.h).
+ */
+extern syscall_handler_t syscall_handlers[SYSCALL_COUNT];
+extern uint8_t syscall_locks[SYSCALL_COUNT];
+extern bool syscall_batch[SYSCALL_COUNT];
+
 /**
  * Handler for system calls invoked using the syscall interrupt.
  *
@@ -47,6 +58,27 @@ typedef void (* syscall_handler_t)(cpu_int_state_t *);
  */
 void syscall_handler_int(cpu_int_state_t *state);
 
+/**
+ * Invokes the handler of the given (valid) system call, holding the locks it
+ * requires.
+ *
+ * @param number The number of the system call.
+ * @param state The state to pass to the handler.
+ * @return False, without invoking the handler, if the current process is
+ *         terminated by another processor.
+ */
+bool syscall_invoke(uint64_t number, cpu_int_state_t *state);
+
+/**
+ * Enables the SYSCALL instruction on the current processor.
+ *
+ * Its entry (syscall_entry) builds the same frame as the syscall interrupt,
+ * with the user's R10 in place of RCX (which holds the return address), so
+ * the handlers work unchanged. It returns using SYSRET, unless it switched
+ * threads.
+ */
+void syscall_init(void);
+
 //- System Call - Macros -------------------------------------------------------
 
 #define SYSCALL_RETURN_ERROR(code) { \
@@ -123,13 +155,60 @@ void syscall_thread_cancel(cpu_int_state_t *state);
  */
 void syscall_thread_join(cpu_int_state_t *state);
 
+/**
+ * System Call: Sleeps to join with another thread, giving up after a timeout.
+ *
+ * Fails when:
+ *  * The awaited thread is equal to the invoking. [1]
+ *  * The awaited thread does not exist. [2]
+ *  * The awaited thread is detached. [3]
+ *  * The awaited thread did not terminate in time. [4]
+ *
+ * Input:
+ *  * RBX The id of the thread to join with.
+ *  * RCX The timeout in nanoseconds.
+ *
+ * Output:
+ *  * RAX Error code, zero on success.
+ *  * RBX Pointer to result of thread.
+ */
+void syscall_thread_join_timeout(cpu_int_state_t *state);
+
+/**
+ * System Call: Puts the current thread to sleep for the given duration.
+ *
+ * A duration of zero only yields the processor to other threads.
+ *
+ * Input:
+ *  * RBX The duration in nanoseconds.
+ *
+ * Output:
+ *  * RAX Error code.
+ */
+void syscall_thread_sleep(cpu_int_state_t *state);
+
+/**
+ * System Call: Returns the time elapsed since the system has been started.
+ *
+ * The resolution is that of the system timer (see IRQ_TIMER_FREQ).
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The time in nanoseconds.
+ */
+void syscall_clock_get(cpu_int_state_t *state);
+
 /**
  * System Call: Spawns a thread for the current process.
  *
+ * Fails when:
+ *  * The process has reached the maximum number of threads. [3]
+ *
  * Input:
  *  * RDI Pointer to thread's entry point.
  *  * RSI Pointer to thread's arguments.
  *  * RDX Address the thread should return to.
+ *  * RCX The size the thread's stack may grow to (zero for the maximum).
  *
  * Output:
  *  * RAX Error code.
@@ -162,6 +241,11 @@ void syscall_thread_kill(cpu_int_state_t *state);
  *
  * Only Root Process.
  *
+ * Fails when:
+ *  * The caller is not the root process. [1]
+ *  * The process does not exist. [2]
+ *  * The process has reached the maximum number of threads. [3]
+ *
  * Input:
  *  * RDI Pointer to thread's entry point.
  *  * RSI Pointer to thread's arguments.
@@ -192,6 +276,11 @@ void syscall_process_kill(cpu_int_state_t *state);
  *
  * Only Root Process.
  *
+ * Fails when:
+ *  * The caller is not the root process. [1]
+ *  * The parent process does not exist. [2]
+ *  * The maximum number of processes has been reached. [3]
+ *
  * Input:
  *  * RCX The new process's parent process.
  *
@@ -201,6 +290,139 @@ void syscall_process_kill(cpu_int_state_t *state);
  */
 void syscall_process_create(cpu_int_state_t *state);
 
+// Sources of the image passed to process_spawn_image
+#define SYSCALL_IMAGE_BUFFER    0   // The caller's send IPC buffer
+#define SYSCALL_IMAGE_MODULE    1   // A boot module
+
+/**
+ * System Call: Creates a new process from an ELF64 image and starts its main
+ * thread at the image's entry point.
+ *
+ * Loads the image in the kernel, replacing a process_create, a memory_map
+ * per page and a thread_create.
+ *
+ * Only Root Process.
+ *
+ * Fails when:
+ *  * The caller is not the root process. [1]
+ *  * The parent process does not exist. [2]
+ *  * The source is invalid, the length exceeds the IPC buffer or there is no
+ *    such module. [3]
+ *  * The image is not a loadable ELF64 binary. [4]
+ *  * The maximum number of processes or threads has been reached. [5]
+ *
+ * Input:
+ *  * RBX The source of the image (see SYSCALL_IMAGE_*).
+ *  * RCX The length of the image in the IPC buffer or the module's index.
+ *  * RDX The new process's parent process.
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The new process's id.
+ */
+void syscall_process_spawn_image(cpu_int_state_t *state);
+
+//- System Calls - Submission Ring ------------------------------------------
+
+// Number of entries of the submission and completion queues
+#define SYSCALL_RING_ENTRIES 32
+
+// Result of a submission that cannot be processed using the ring
+#define SYSCALL_RING_INVALID ((uint64_t) -1)
+
+/**
+ * A system call submitted to the ring.
+ */
+typedef struct syscall_ring_sqe_t {
+    /**
+     * The system call number and the argument registers.
+     */
+    uint64_t number;
+    uint64_t rbx;
+    uint64_t rcx;
+    uint64_t rdx;
+    uint64_t rsi;
+    uint64_t rdi;
+
+    /**
+     * Copied to the completion.
+     */
+    uint64_t user_data;
+    uint64_t reserved;
+} PACKED syscall_ring_sqe_t;
+
+/**
+ * The completion of a submitted system call.
+ */
+typedef struct syscall_ring_cqe_t {
+    uint64_t user_data;
+
+    /**
+     * The error code (or SYSCALL_RING_INVALID) and the value returned in RBX.
+     */
+    uint64_t rax;
+    uint64_t rbx;
+    uint64_t reserved;
+} PACKED syscall_ring_cqe_t;
+
+/**
+ * The page shared with a process for submitting system calls in batches.
+ *
+ * The indices run freely and are taken modulo SYSCALL_RING_ENTRIES. The
+ * process produces submissions at sq_tail and consumes completions at
+ * cq_head, the kernel does the opposite on ring_enter and when polling
+ * (see syscall_ring_poll).
+ */
+typedef struct syscall_ring_t {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint8_t reserved[48];
+
+    syscall_ring_sqe_t sq[SYSCALL_RING_ENTRIES];
+    syscall_ring_cqe_t cq[SYSCALL_RING_ENTRIES];
+} PACKED syscall_ring_t;
+
+/**
+ * Processes the submissions pending in the current process's ring, if set up
+ * and not being processed on another processor.
+ *
+ * Called by the timer when the time slice of a thread interrupted in user
+ * mode has elapsed, so submissions progress without ring_enter.
+ *
+ * @return False, if the current process is terminated by another processor
+ *         meanwhile.
+ */
+bool syscall_ring_poll(void);
+
+/**
+ * System Call: Maps the submission ring of the current process, if not mapped
+ * yet, at MEMORY_RING_VADDR.
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The address of the ring (a syscall_ring_t).
+ */
+void syscall_ring_setup(cpu_int_state_t *state);
+
+/**
+ * System Call: Processes the system calls submitted to the current process's
+ * ring and posts their completions.
+ *
+ * Stops early when the completion queue is full. System calls that might
+ * block (see syscalls.def) complete with SYSCALL_RING_INVALID.
+ *
+ * Fails when:
+ *  * The ring has not been set up. [1]
+ *  * The submission queue's indices are corrupt. [2]
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The number of processed submissions.
+ */
+void syscall_ring_enter(cpu_int_state_t *state);
+
 //- System Calls - Synchronization - Futex -------------------------------------
 
 /**
@@ -225,6 +447,19 @@ void syscall_futex_wake(cpu_int_state_t *state);
  */
 void syscall_futex_wait(cpu_int_state_t *state);
 
+/**
+ * System Call: Like futex_wait, but stops waiting after a timeout.
+ *
+ * Input:
+ *  * RSI The address of the futex.
+ *  * RBX The value to compare with.
+ *  * RCX The timeout in nanoseconds.
+ *
+ * Output:
+ *  * RAX 1 if woken, 2 if timed out, 0 if the values were not equal.
+ */
+void syscall_futex_wait_timeout(cpu_int_state_t *state);
+
 /**
  * System Call: Compares the futex with a given value and, when they are equal,
  * wakes n waiting threads and transfers m waiting threads to another futex.
@@ -241,6 +476,91 @@ void syscall_futex_wait(cpu_int_state_t *state);
  */
 void syscall_futex_cmp_requeue(cpu_int_state_t *state);
 
+/**
+ * System Call: Wakes a thread waiting on a futex and waits on another futex,
+ * switching directly to the thread woken.
+ *
+ * The woken thread runs on the rest of the caller's time slice.
+ *
+ * Input:
+ *  * RSI The address of the futex to wake a thread on.
+ *  * RDI The address of the futex to wait on.
+ *  * RBX The value to compare the futex to wait on with.
+ *  * RCX The timeout in nanoseconds (THREAD_TIMEOUT_NONE for none).
+ *
+ * Output:
+ *  * RAX 1 if woken, 2 if timed out, 0 if the values were not equal (no
+ *    thread is woken then).
+ */
+void syscall_futex_swap(cpu_int_state_t *state);
+
+// Maximum number of futexes to wait on using futex_waitv (the waiters are
+// allocated from the heap)
+#define SYSCALL_FUTEX_WAITV_MAX         64
+
+// Results of futex_waitv (besides the index of the futex)
+#define SYSCALL_FUTEX_WAITV_MISMATCH    ((uint64_t) -1)
+#define SYSCALL_FUTEX_WAITV_TIMEOUT     ((uint64_t) -2)
+#define SYSCALL_FUTEX_WAITV_INVALID     ((uint64_t) -3)
+
+/**
+ * Futex and value to compare with, passed to futex_waitv.
+ */
+typedef struct syscall_futex_waitv_t {
+    uint64_t futex;
+    uint32_t value;
+    uint32_t reserved;
+} PACKED syscall_futex_waitv_t;
+
+/**
+ * System Call: Compares each futex of a vector with its value and, when all of
+ * them are equal, waits until one of them is waked.
+ *
+ * Input:
+ *  * RSI The address of the vector of syscall_futex_waitv_t.
+ *  * RCX The number of futexes (at most SYSCALL_FUTEX_WAITV_MAX).
+ *  * RDX The timeout in nanoseconds (THREAD_TIMEOUT_NONE for none).
+ *
+ * Output:
+ *  * RAX The index of the futex that has been waked or one of the
+ *    SYSCALL_FUTEX_WAITV_* results.
+ */
+void syscall_futex_waitv(cpu_int_state_t *state);
+
+// Bits of the value of a priority inheritance futex (zero if unlocked)
+#define SYSCALL_FUTEX_PI_WAITERS    (1U << 31)  // Unlocking must enter the kernel
+#define SYSCALL_FUTEX_PI_LOCKED     (1U << 30)
+#define SYSCALL_FUTEX_PI_TID_MASK   0x3FFFFFFF  // Id of the owning thread
+
+/**
+ * System Call: Locks a priority inheritance futex that could not be locked in
+ * user space, waiting for the owner to hand it over.
+ *
+ * The owner runs on the caller's time slice meanwhile, as the scheduler does
+ * not know priorities that could be inherited.
+ *
+ * Input:
+ *  * RSI The address of the futex.
+ *
+ * Output:
+ *  * RAX 0 if locked, 1 if the futex is inaccessible or already owned by the
+ *    calling thread.
+ */
+void syscall_futex_lock_pi(cpu_int_state_t *state);
+
+/**
+ * System Call: Unlocks a priority inheritance futex owned by the calling
+ * thread, handing it over to the thread that has waited the longest.
+ *
+ * Input:
+ *  * RSI The address of the futex.
+ *
+ * Output:
+ *  * RAX 0 on success, 1 if the futex is inaccessible or not owned by the
+ *    calling thread.
+ */
+void syscall_futex_unlock_pi(cpu_int_state_t *state);
+
 //- System Calls - Synchronization - Mutex -------------------------------------
 
 /**
@@ -289,7 +609,8 @@ void syscall_mutex_unlock(cpu_int_state_t *state);
  * When the IGNORE_RESPONSE flag is not set, the response is written to the
  * thread's RECV buffer.
  *
- * Will return an error code, when the target process has no message handler.
+ * Will return an error code, when the target process has no message handler
+ * or has reached the maximum number of threads.
  *
  * Input:
  *  * RDI The id of the target process.
@@ -298,10 +619,47 @@ void syscall_mutex_unlock(cpu_int_state_t *state);
  *
  * Output:
  *  * RAX Error code.
- *  * RCX The size of the response.
+ *  * RSI The size of the response.
  */
 void syscall_ipc_send(cpu_int_state_t *state);
 
+/**
+ * System Call: Like ipc_send, but stops waiting for the response after a
+ * timeout. A response arriving afterwards is discarded.
+ *
+ * Input:
+ *  * RDI The id of the target process.
+ *  * RBX The flags for sending the message.
+ *  * RCX The length of the message's payload (in bytes).
+ *  * RDX The timeout in nanoseconds.
+ *
+ * Output:
+ *  * RAX Error code (4 on timeout).
+ *  * RSI The size of the response (zero on timeout).
+ */
+void syscall_ipc_send_timeout(cpu_int_state_t *state);
+
+/**
+ * System Call: Like ipc_send, but passes a payload of up to IPC_SHORT_SIZE
+ * bytes in registers instead of the SEND buffer.
+ *
+ * The message is delivered with IPC_FLAG_SHORT, and its payload is copied to
+ * the registers of the receiving thread, without moving any buffer. The
+ * response is short as well.
+ *
+ * Input:
+ *  * RDI The id of the target process.
+ *  * RBX The flags for sending the message.
+ *  * RCX The length of the message's payload (in bytes).
+ *  * R8, R9, R12 to R15 The payload.
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RSI The size of the response.
+ *  * R8, R9, R12 to R15 The payload of the response.
+ */
+void syscall_ipc_send_short(cpu_int_state_t *state);
+
 /**
  * System Call: Sends an response back the the sender of a message.
  *
@@ -319,6 +677,31 @@ void syscall_ipc_send(cpu_int_state_t *state);
  */
 void syscall_ipc_respond(cpu_int_state_t *state);
 
+/**
+ * System Call: Responds to the message handled by the invoking thread (if
+ * any) and waits for the next message sent to its process.
+ *
+ * Messages are delivered to waiting threads before spawning handler threads,
+ * so a pool of threads invoking this in a loop handles messages without
+ * creating a thread per message. A handler thread spawned for a message may
+ * invoke this instead of ipc_respond to join the pool.
+ *
+ * Responses to short messages are short as well (see ipc_send_short).
+ *
+ * Input:
+ *  * RBX The flags for sending the response.
+ *  * RCX The length of the response's payload (ignored without a message).
+ *  * R8, R9, R12 to R15 The payload of a short response.
+ *
+ * Output:
+ *  * RAX Error code, when the thread is waiting already (1) or the
+ *    response's length exceeds the buffer (2).
+ *  * RBX, RDX, RSI, RDI The header of the next message (see
+ *    ipc_message_header).
+ *  * R8, R9, R12 to R15 The payload of the next message, if short.
+ */
+void syscall_ipc_reply_and_wait(cpu_int_state_t *state);
+
 /**
  * System Call: Resizes one of the current thread's IPC buffers.
  *
@@ -355,6 +738,86 @@ void syscall_ipc_buffer_get(cpu_int_state_t *state);
  */
 void syscall_ipc_handler(cpu_int_state_t *state);
 
+//- System Calls - IPC Queues --------------------------------------------------
+
+// Flags for ipc_queue_receive
+#define SYSCALL_IPC_QUEUE_WAIT (1 << 0)
+
+/**
+ * System Call: Creates a queue of messages, which any process may send to
+ * without blocking and the current process receives from (see ipc.h).
+ *
+ * Messages are passed in batches as arrays of ipc_queue_msg_t with up to
+ * IPC_SHORT_SIZE bytes of payload each.
+ *
+ * Fails when:
+ *  * The number of slots is zero or exceeds IPC_QUEUE_SLOTS_MAX. [1]
+ *  * The maximum number of queues has been reached. [2]
+ *
+ * Input:
+ *  * RBX The minimum number of slots (rounded up to a power of two).
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The id of the queue.
+ */
+void syscall_ipc_queue_create(cpu_int_state_t *state);
+
+/**
+ * System Call: Appends messages to a queue, as many as there are free slots.
+ *
+ * Wakes up a receiver waiting for the queue, if it has been empty.
+ *
+ * Fails when:
+ *  * There is no such queue. [1]
+ *  * The messages are not accessible. [2]
+ *
+ * Input:
+ *  * RBX The id of the queue.
+ *  * RCX The address of the array of messages.
+ *  * RDX The number of messages.
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The number of messages appended.
+ */
+void syscall_ipc_queue_send(cpu_int_state_t *state);
+
+/**
+ * System Call: Removes the oldest messages from a queue owned by the current
+ * process.
+ *
+ * With SYSCALL_IPC_QUEUE_WAIT the thread sleeps while the queue is empty and
+ * returns zero messages once notified, so it has to retry.
+ *
+ * Fails when:
+ *  * There is no such queue or it is owned by another process. [1]
+ *  * The array is not writeable. [2]
+ *
+ * Input:
+ *  * RBX The id of the queue.
+ *  * RCX The address of the array to receive the messages in.
+ *  * RDX The maximum number of messages.
+ *  * RSI Flags (see SYSCALL_IPC_QUEUE_*).
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The number of messages received.
+ */
+void syscall_ipc_queue_receive(cpu_int_state_t *state);
+
+/**
+ * System Call: Destroys a queue owned by the current process, discarding its
+ * messages and waking up waiting receivers.
+ *
+ * Input:
+ *  * RBX The id of the queue.
+ *
+ * Output:
+ *  * RAX Error code, when there is no such queue owned by the process.
+ */
+void syscall_ipc_queue_destroy(cpu_int_state_t *state);
+
 //- System Calls - Memory ------------------------------------------------------
 
 #define SYSCALL_MEMORY_FLAG_WRITEABLE (1 << 0)
@@ -415,3 +878,115 @@ void syscall_memory_map(cpu_int_state_t *state);
  *  * RAX Error code.
  */
 void syscall_memory_unmap(cpu_int_state_t *state);
+
+/**
+ * System Call: Forwards page faults in a region of the current process to a
+ * pager process.
+ *
+ * The pager receives an IPC message with IPC_FLAG_PAGE_FAULT (a pager_fault_t)
+ * per fault and responds with the pages of its shared memory regions to map
+ * (an array of pager_map_t).
+ * The faulting thread retries its access once the fault has been resolved and
+ * is terminated otherwise (see pager.h).
+ *
+ * Fails when:
+ *  * The region is invalid, overlaps a registered one or the process has too
+ *    many regions. [1]
+ *
+ * Input:
+ *  * RBX The start of the region.
+ *  * RCX The length of the region.
+ *  * RDX The pid of the pager process.
+ *
+ * Output:
+ *  * RAX Error code.
+ */
+void syscall_pager_register(cpu_int_state_t *state);
+
+//- System Calls - Shared Memory -----------------------------------------------
+
+/**
+ * System Call: Creates a region of zeroed memory that can be shared with other
+ * processes and maps it writeable at the given address (see shm.h).
+ *
+ * The region is freed when the last process mapping it unmaps it.
+ *
+ * Fails when:
+ *  * The address is not page aligned, any page of the range is mapped, the
+ *    size is invalid or too many regions are mapped. [1]
+ *
+ * Input:
+ *  * RBX The address to map the region at.
+ *  * RCX The number of pages of the region.
+ *
+ * Output:
+ *  * RAX Error code.
+ *  * RBX The id of the region.
+ */
+void syscall_shm_create(cpu_int_state_t *state);
+
+/**
+ * System Call: Allows another process to map a region the current process
+ * maps.
+ *
+ * Fails when:
+ *  * There is no such region or the current process does not map it (with
+ *    at least the granted rights). [1]
+ *
+ * Input:
+ *  * RBX The id of the region.
+ *  * RCX The pid of the process to grant the right to.
+ *  * RDX The rights (SYSCALL_MEMORY_FLAG_WRITEABLE or zero for read-only).
+ *
+ * Output:
+ *  * RAX Error code.
+ */
+void syscall_shm_grant(cpu_int_state_t *state);
+
+/**
+ * System Call: Maps a region the current process has been granted at the
+ * given address.
+ *
+ * Fails when:
+ *  * There is no such region, the right has not been granted, the address
+ *    is not page aligned, any page of the range is mapped or too many
+ *    regions are mapped. [1]
+ *
+ * Input:
+ *  * RBX The id of the region.
+ *  * RCX The address to map the region at.
+ *  * RDX Page flags (SYSCALL_MEMORY_FLAG_WRITEABLE).
+ *
+ * Output:
+ *  * RAX Error code.
+ */
+void syscall_shm_map(cpu_int_state_t *state);
+
+/**
+ * System Call: Unmaps the region mapped at the given address.
+ *
+ * Input:
+ *  * RBX The address the region is mapped at.
+ *
+ * Output:
+ *  * RAX Error code, when no region is mapped at the address.
+ */
+void syscall_shm_unmap(cpu_int_state_t *state);
+
+//- System Calls - Debugging ---------------------------------------------------
+
+/**
+ * System Call: Prints a string to the debug console.
+ *
+ * Input:
+ *  * RBX The address of the null-terminated string.
+ */
+void syscall_debug(cpu_int_state_t *state);
+
+/**
+ * System Call: Prints a number in hexadecimal notation to the debug console.
+ *
+ * Input:
+ *  * RBX The number to print.
+ */
+void syscall_debug_hex(cpu_int_state_t *state);
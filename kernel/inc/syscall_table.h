@@ -0,0 +1,79 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Generated from syscalls.def by tools/syscalls.awk, do not edit
+// (regenerate using "make syscalls").
+
+#pragma once
+
+//- System Call Numbers --------------------------------------------------------
+
+#define SYSCALL_NR_PROCESS_ID            0
+#define SYSCALL_NR_PROCESS_PARENT_ID     1
+#define SYSCALL_NR_PROCESS_EXIT          2
+#define SYSCALL_NR_THREAD_ID             3
+#define SYSCALL_NR_THREAD_SPAWN          4
+#define SYSCALL_NR_THREAD_JOIN           5
+#define SYSCALL_NR_THREAD_CANCEL         6
+#define SYSCALL_NR_THREAD_JOIN_TIMEOUT   7
+#define SYSCALL_NR_PROCESS_CREATE        8
+#define SYSCALL_NR_PROCESS_KILL          9
+#define SYSCALL_NR_THREAD_CREATE         10
+#define SYSCALL_NR_THREAD_KILL           11
+#define SYSCALL_NR_THREAD_SLEEP          12
+#define SYSCALL_NR_CLOCK_GET             13
+#define SYSCALL_NR_RING_SETUP            14
+#define SYSCALL_NR_RING_ENTER            15
+#define SYSCALL_NR_PROCESS_SPAWN_IMAGE   37
+#define SYSCALL_NR_MUTEX_LOCK            16
+#define SYSCALL_NR_MUTEX_UNLOCK          17
+#define SYSCALL_NR_MUTEX_TRYLOCK         18
+#define SYSCALL_NR_IPC_SEND              24
+#define SYSCALL_NR_IPC_RESPOND           25
+#define SYSCALL_NR_IPC_BUFFER_SIZE       26
+#define SYSCALL_NR_IPC_BUFFER_GET        27
+#define SYSCALL_NR_IPC_HANDLER           28
+#define SYSCALL_NR_IPC_SEND_TIMEOUT      29
+#define SYSCALL_NR_IPC_REPLY_AND_WAIT    30
+#define SYSCALL_NR_IPC_SEND_SHORT        31
+#define SYSCALL_NR_IPC_QUEUE_CREATE      19
+#define SYSCALL_NR_IPC_QUEUE_SEND        20
+#define SYSCALL_NR_IPC_QUEUE_RECEIVE     21
+#define SYSCALL_NR_IPC_QUEUE_DESTROY     22
+#define SYSCALL_NR_MEMORY_ALLOC          32
+#define SYSCALL_NR_MEMORY_FREE           33
+#define SYSCALL_NR_MEMORY_MAP            34
+#define SYSCALL_NR_MEMORY_UNMAP          35
+#define SYSCALL_NR_PAGER_REGISTER        36
+#define SYSCALL_NR_SHM_CREATE            38
+#define SYSCALL_NR_SHM_GRANT             39
+#define SYSCALL_NR_SHM_MAP               42
+#define SYSCALL_NR_SHM_UNMAP             43
+#define SYSCALL_NR_DEBUG                 40
+#define SYSCALL_NR_DEBUG_HEX             41
+#define SYSCALL_NR_FUTEX_WAKE            48
+#define SYSCALL_NR_FUTEX_WAIT            49
+#define SYSCALL_NR_FUTEX_CMP_REQUEUE     50
+#define SYSCALL_NR_FUTEX_WAIT_TIMEOUT    51
+#define SYSCALL_NR_FUTEX_LOCK_PI         52
+#define SYSCALL_NR_FUTEX_UNLOCK_PI       53
+#define SYSCALL_NR_FUTEX_WAITV           54
+#define SYSCALL_NR_FUTEX_SWAP            55
+
+// Size of the system call table (including unused numbers)
+#define SYSCALL_COUNT 56
@@ -0,0 +1,134 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <api/types.h>
+#include <irq.h>
+
+//- Timeouts -------------------------------------------------------------------
+
+// Number of levels of the timer wheel
+#define TIMEOUT_LEVELS 4
+
+// Slots per level (each level is 64 times coarser than the one below)
+#define TIMEOUT_SLOT_BITS 6
+#define TIMEOUT_SLOTS (1 << TIMEOUT_SLOT_BITS)
+
+// Value returned by timeout_next if no timeout is armed
+#define TIMEOUT_NONE ((time_t) -1)
+
+#define TIMEOUT_STATE_IDLE      0   // Not armed
+#define TIMEOUT_STATE_PENDING   1   // Armed on another processor, not in the wheel yet
+#define TIMEOUT_STATE_ARMED     2   // In the wheel
+#define TIMEOUT_STATE_DUE       3   // Expired, waiting to be popped
+#define TIMEOUT_STATE_FIRING    4   // Popped, waiting for timeout_fire
+
+/**
+ * A timeout in the timer wheel.
+ *
+ * The wheel is advanced by the bootstrap processor, which keeps the system
+ * time. Timeouts armed on other processors are passed to it as relative
+ * timeouts and inserted once it has accounted the elapsed time.
+ */
+typedef struct timeout_t {
+    /**
+     * The tick the timeout expires at (ticks from now while pending).
+     */
+    time_t expires;
+
+    /**
+     * The state of the timeout (see TIMEOUT_STATE_*).
+     */
+    uint8_t state;
+
+    /**
+     * Incremented every time the timeout is armed or canceled.
+     */
+    uint32_t seq;
+
+    /**
+     * The wheel slot or list the timeout is linked into.
+     */
+    struct timeout_t **list;
+
+    struct timeout_t *next;
+    struct timeout_t *prev;
+} timeout_t;
+
+/**
+ * Converts the given duration to timer ticks, rounding up.
+ *
+ * @param ns The duration in nanoseconds.
+ * @return The number of ticks.
+ */
+time_t timeout_ticks(uint64_t ns);
+
+/**
+ * Arms (or rearms) the given timeout to expire after the given number of
+ * ticks.
+ *
+ * Reprograms the timer of the bootstrap processor, if required.
+ *
+ * @param timeout The timeout to arm.
+ * @param ticks The number of ticks until the timeout expires.
+ */
+void timeout_set(timeout_t *timeout, time_t ticks);
+
+/**
+ * Cancels the given timeout, if armed.
+ *
+ * @param timeout The timeout to cancel.
+ */
+void timeout_cancel(timeout_t *timeout);
+
+/**
+ * Advances the wheel to the given tick and marks all timeouts that expired
+ * as due (bootstrap processor only).
+ *
+ * @param now The current tick.
+ */
+void timeout_advance(time_t now);
+
+/**
+ * Returns the tick of the next event of the wheel, i.e. when a timeout
+ * expires or a slot has to be cascaded (bootstrap processor only).
+ *
+ * Inserts pending timeouts relative to the given tick.
+ *
+ * @param now The current tick.
+ * @return The tick of the next event or TIMEOUT_NONE.
+ */
+time_t timeout_next(time_t now);
+
+/**
+ * Removes a due timeout from the wheel and marks it as firing.
+ *
+ * @param seq Set to the sequence number to pass to timeout_fire.
+ * @return The timeout or a null pointer, if none is due.
+ */
+timeout_t *timeout_pop(uint32_t *seq);
+
+/**
+ * Checks whether the given popped timeout has neither been canceled nor
+ * rearmed meanwhile and marks it as idle.
+ *
+ * @param timeout The timeout returned by timeout_pop.
+ * @param seq The sequence number returned by timeout_pop.
+ * @return Whether the timeout should take effect.
+ */
+bool timeout_fire(timeout_t *timeout, uint32_t seq);
@@ -0,0 +1,194 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/string.h>
+#include <acpi.h>
+#include <memory.h>
+#include <debug.h>
+
+//- ACPI Tables ----------------------------------------------------------------
+
+// Size of each of the two mapping windows
+#define ACPI_WINDOW_SIZE 0x10000
+
+// Window for the RSDT/XSDT
+#define ACPI_WINDOW_ROOT MEMORY_ACPI_VADDR
+
+// Window for the table that has been looked up last
+#define ACPI_WINDOW_TABLE (MEMORY_ACPI_VADDR + ACPI_WINDOW_SIZE)
+
+// Physical memory regions to search the RSDP in
+#define ACPI_EBDA_PTR_PADDR   0x40E
+#define ACPI_BIOS_BEGIN_PADDR 0xE0000
+#define ACPI_BIOS_END_PADDR   0x100000
+
+/**
+ * The mapped root table (RSDT or XSDT).
+ */
+static acpi_sdt_header_t *_acpi_root = 0;
+
+/**
+ * Whether the root table is an XSDT with 64 bit entries.
+ */
+static bool _acpi_root_extended = false;
+
+/**
+ * Checks whether the bytes in the given region sum up to zero.
+ *
+ * @param ptr The region to check.
+ * @param length The length of the region.
+ * @return Whether the checksum is valid.
+ */
+static bool _acpi_checksum(void *ptr, size_t length) {
+    uint8_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < length; ++i)
+        sum += ((uint8_t *) ptr)[i];
+
+    return (0 == sum);
+}
+
+/**
+ * Searches the RSDP in the given identity mapped physical memory region.
+ *
+ * @param begin The beginning of the region (16 byte aligned).
+ * @param end The end of the region.
+ * @return Pointer to the RSDP or a null pointer, if not found.
+ */
+static acpi_rsdp_t *_acpi_rsdp_scan(uintptr_t begin, uintptr_t end) {
+    uintptr_t addr;
+
+    for (addr = begin; addr + sizeof(acpi_rsdp_t) <= end; addr += 16) {
+        acpi_rsdp_t *rsdp = (acpi_rsdp_t *) addr;
+
+        if (!memcmp((void *) rsdp->signature, (void *) "RSD PTR ", 8))
+            continue;
+
+        // Revision 1 checksum only covers the first 20 bytes
+        if (_acpi_checksum((void *) rsdp, 20))
+            return rsdp;
+    }
+
+    return 0;
+}
+
+/**
+ * Maps the given range of physical memory into the given window.
+ *
+ * @param window The window to map the range to.
+ * @param paddr The physical address to map.
+ * @param length The length of the range.
+ * @return The virtual address of <tt>paddr</tt>.
+ */
+static void *_acpi_map(uintptr_t window, uintptr_t paddr, size_t length) {
+    uintptr_t offset = paddr & (PAGE_SIZE - 1);
+
+    if (UNLIKELY(offset + length > ACPI_WINDOW_SIZE))
+        length = ACPI_WINDOW_SIZE - offset;
+
+    uintptr_t page;
+    for (page = 0; page < offset + length; page += PAGE_SIZE)
+        memory_map(window + page, (paddr - offset) + page, 0);
+
+    return (void *) (window + offset);
+}
+
+/**
+ * Maps the table at the given physical address into the given window.
+ *
+ * @param window The window to map the table to.
+ * @param paddr The physical address of the table.
+ * @return The mapped table or a null pointer, if it is truncated.
+ */
+static acpi_sdt_header_t *_acpi_map_table(uintptr_t window, uintptr_t paddr) {
+    // Map header to get the length
+    acpi_sdt_header_t *table = (acpi_sdt_header_t *) _acpi_map(
+        window, paddr, sizeof(acpi_sdt_header_t));
+
+    // Map complete table
+    size_t length = table->length;
+
+    if (UNLIKELY((paddr & (PAGE_SIZE - 1)) + length > ACPI_WINDOW_SIZE))
+        return 0;
+
+    return (acpi_sdt_header_t *) _acpi_map(window, paddr, length);
+}
+
+bool acpi_init(void) {
+    // Search in the first kilobyte of the EBDA
+    uintptr_t ebda = ((uintptr_t) *((uint16_t *) ACPI_EBDA_PTR_PADDR)) << 4;
+    acpi_rsdp_t *rsdp = 0;
+
+    if (0 != ebda && ebda < ACPI_BIOS_BEGIN_PADDR)
+        rsdp = _acpi_rsdp_scan(ebda, ebda + 0x400);
+
+    // Search in the BIOS area
+    if (0 == rsdp)
+        rsdp = _acpi_rsdp_scan(ACPI_BIOS_BEGIN_PADDR, ACPI_BIOS_END_PADDR);
+
+    if (0 == rsdp)
+        return false;
+
+    // Prefer the XSDT, if present
+    if (rsdp->revision >= 2 && 0 != rsdp->xsdt_addr &&
+        _acpi_checksum((void *) rsdp, rsdp->length)) {
+        _acpi_root = _acpi_map_table(ACPI_WINDOW_ROOT, rsdp->xsdt_addr);
+        _acpi_root_extended = true;
+
+    } else {
+        _acpi_root = _acpi_map_table(ACPI_WINDOW_ROOT, rsdp->rsdt_addr);
+        _acpi_root_extended = false;
+    }
+
+    if (0 == _acpi_root || !_acpi_checksum((void *) _acpi_root, _acpi_root->length)) {
+        _acpi_root = 0;
+        return false;
+    }
+
+    return true;
+}
+
+acpi_sdt_header_t *acpi_table_find(const int8_t *signature) {
+    // No root table?
+    if (0 == _acpi_root)
+        return 0;
+
+    // Iterate entries
+    size_t entry_size = _acpi_root_extended ? 8 : 4;
+    size_t count = (_acpi_root->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    uintptr_t entries = (uintptr_t) _acpi_root + sizeof(acpi_sdt_header_t);
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        uintptr_t paddr = _acpi_root_extended
+            ? ((uint64_t *) entries)[i]
+            : ((uint32_t *) entries)[i];
+
+        acpi_sdt_header_t *table = _acpi_map_table(ACPI_WINDOW_TABLE, paddr);
+
+        if (0 == table || !memcmp((void *) table->signature, (void *) signature, 4))
+            continue;
+
+        if (_acpi_checksum((void *) table, table->length))
+            return table;
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <acpi.h>
+#include <debug.h>
+
+//- Multiple APIC Description Table --------------------------------------------
+
+uintptr_t acpi_lapic_paddr = 0;
+bool acpi_pic_present = true;
+
+size_t acpi_cpu_count = 0;
+uint8_t acpi_cpu_apic_ids[ACPI_CPU_MAX];
+
+size_t acpi_ioapic_count = 0;
+acpi_ioapic_t acpi_ioapics[ACPI_IOAPIC_MAX];
+
+acpi_isa_irq_t acpi_isa_irqs[ACPI_ISA_IRQ_COUNT];
+
+bool acpi_madt_parse(void) {
+    // Identity map ISA IRQs unless overridden
+    size_t i;
+    for (i = 0; i < ACPI_ISA_IRQ_COUNT; ++i) {
+        acpi_isa_irqs[i].gsi = i;
+        acpi_isa_irqs[i].flags = 0;
+    }
+
+    // Find MADT
+    acpi_madt_t *madt = (acpi_madt_t *) acpi_table_find(
+        (const int8_t *) ACPI_MADT_SIGNATURE);
+
+    if (0 == madt)
+        return false;
+
+    acpi_lapic_paddr = madt->lapic_addr;
+    acpi_pic_present = (0 != (madt->flags & ACPI_MADT_FLAG_PCAT_COMPAT));
+
+    // Iterate entries
+    uintptr_t entry_addr = (uintptr_t) madt + sizeof(acpi_madt_t);
+    uintptr_t end_addr = (uintptr_t) madt + madt->header.length;
+
+    while (entry_addr + sizeof(acpi_madt_entry_t) <= end_addr) {
+        acpi_madt_entry_t *entry = (acpi_madt_entry_t *) entry_addr;
+
+        // Malformed?
+        if (UNLIKELY(entry->length < sizeof(acpi_madt_entry_t)))
+            break;
+
+        switch (entry->type) {
+            case ACPI_MADT_TYPE_LAPIC: {
+                acpi_madt_lapic_t *lapic = (acpi_madt_lapic_t *) entry;
+
+                if (0 != (lapic->flags & ACPI_MADT_LAPIC_ENABLED) &&
+                    acpi_cpu_count < ACPI_CPU_MAX)
+                    acpi_cpu_apic_ids[acpi_cpu_count++] = lapic->apic_id;
+
+                break;
+            }
+
+            case ACPI_MADT_TYPE_IOAPIC: {
+                acpi_madt_ioapic_t *ioapic = (acpi_madt_ioapic_t *) entry;
+
+                if (acpi_ioapic_count < ACPI_IOAPIC_MAX) {
+                    acpi_ioapic_t *info = &acpi_ioapics[acpi_ioapic_count++];
+                    info->id = ioapic->id;
+                    info->gsi_base = ioapic->gsi_base;
+                    info->paddr = ioapic->addr;
+                }
+
+                break;
+            }
+
+            case ACPI_MADT_TYPE_ISO: {
+                acpi_madt_iso_t *iso = (acpi_madt_iso_t *) entry;
+
+                if (0 == iso->bus && iso->source < ACPI_ISA_IRQ_COUNT) {
+                    acpi_isa_irqs[iso->source].gsi = iso->gsi;
+                    acpi_isa_irqs[iso->source].flags = iso->flags;
+                }
+
+                break;
+            }
+
+            case ACPI_MADT_TYPE_LAPIC_OVERRIDE: {
+                acpi_madt_lapic_override_t *override =
+                    (acpi_madt_lapic_override_t *) entry;
+
+                acpi_lapic_paddr = override->addr;
+                break;
+            }
+        }
+
+        entry_addr += entry->length;
+    }
+
+    return true;
+}
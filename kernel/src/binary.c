@@ -18,6 +18,8 @@
 
 #include <api/types.h>
 #include <api/string.h>
+#include <api/map.h>
+#include <api/bootinfo.h>
 
 #include <lib/elf64.h>
 
@@ -39,6 +41,42 @@ static bool _binary_verify_elf64(Elf64_Ehdr *header) {
         header->e_ident[EI_VERSION] == EV_CURRENT;
 }
 
+bool binary_check_elf64(void *binary, size_t size) {
+    Elf64_Ehdr *header = (Elf64_Ehdr *) binary;
+
+    if (size < sizeof(Elf64_Ehdr) || !_binary_verify_elf64(header))
+        return false;
+
+    if (header->e_entry >= MEMORY_USER_END)
+        return false;
+
+    // Program headers within the image?
+    if (header->e_phoff > size ||
+        header->e_phnum > (size - header->e_phoff) / sizeof(Elf64_Phdr))
+        return false;
+
+    // Loadable segments within the image and the lower half?
+    Elf64_Phdr *segment = (Elf64_Phdr *) (((uintptr_t) binary) + header->e_phoff);
+    size_t i;
+
+    for (i = 0; i < header->e_phnum; ++i, ++segment) {
+        if (PT_LOAD != segment->p_type)
+            continue;
+
+        if (segment->p_filesz > segment->p_memsz ||
+            segment->p_offset > size ||
+            segment->p_filesz > size - segment->p_offset)
+            return false;
+
+        if (0 != (segment->p_vaddr & 0xFFF) ||
+            segment->p_memsz > MEMORY_USER_END ||
+            segment->p_vaddr > MEMORY_USER_END - segment->p_memsz)
+            return false;
+    }
+
+    return true;
+}
+
 /**
  * Loads an ELF64 executable binary in the current address space (without
  * shared libraries).
@@ -112,3 +150,17 @@ uint64_t binary_load_elf64(void *binary, uint16_t pflags) {
     // Return entry point
     return header->e_entry;
 }
+
+//- Boot Modules ---------------------------------------------------------------
+
+boot_info_mod_t *binary_module(size_t index) {
+    boot_info_t *info = (boot_info_t *) MEMORY_BOOT_INFO_VADDR;
+    boot_info_mod_t *mod = info->mods;
+
+    while (0 != mod && index > 0) {
+        mod = mod->next;
+        --index;
+    }
+
+    return mod;
+}
@@ -18,6 +18,7 @@ bits 64
 section .text
 
 extern kmain
+extern memory_space_reap
 global boot
 
 boot:
@@ -36,7 +37,7 @@ boot:
   mov es, ax
 
   call kmain                    ; Kernel main function
-  jmp $                         ; Endless loop
+  jmp idle                      ; Idle until there is something to run
 
 ;; see memory.h
 global memory_space_get
@@ -44,25 +45,22 @@ memory_space_get:
   mov rax, cr3
   ret
 
+;; Offset of smp_cpu_t.addr_space (see smp.h)
+%define SMP_CPU_ADDR_SPACE 0x20
+
 ;; see memory.h
 global memory_space_switch
 memory_space_switch:
   mov rax, cr3
   mov cr3, rdi
-  ret
-
-;; see cpu/tss.c
-global cpu_tss_load
-cpu_tss_load:
-  mov rax, gdtr64
-  lgdt [rax]
-
-  mov ax, 0x2B
-  ltr ax
+  mov [gs:SMP_CPU_ADDR_SPACE], rdi  ; Remember for TLB shootdowns
   ret
 
 global idle
 idle:
+  cli
+  call memory_space_reap        ; Background work (has preemption points)
+  sti                           ; Interrupts are taken after the next one
   hlt
   jmp idle
 
@@ -18,6 +18,16 @@ bits 64
 
 ;; Imports
 extern cpu_int_handle
+extern thread_switch_finish
+extern irq_timer_fast
+extern smp_reschedule_fast
+extern smp_tlb_fast
+
+;; Vectors with a fast path (see irq.h and smp.h)
+%define IRQ_PIT_VECTOR          0x30
+%define IRQ_LAPIC_TIMER_VECTOR  0x40
+%define SMP_RESCHEDULE_VECTOR   0x41
+%define SMP_TLB_VECTOR          0x42
 
 ;; 64 Bit code
 section .text
@@ -39,8 +49,11 @@ cpu_int_lidt:
   ret
 
 cpu_int_handler_common:
-  mov r15, cr2
+  test qword [rsp + 24], 3      ; Coming from user mode?
+  jz cpu_int_save
+  swapgs                        ; Load per-CPU GS base (see smp.h)
 
+cpu_int_save:                   ; Also entered by the fast stubs (GS loaded)
   push rax                      ; Push registers
   push rbx
   push rcx
@@ -61,20 +74,33 @@ cpu_int_handler_common:
   mov ax, ds                    ; Back up data segment
   push rax
 
-  mov ax, 0x10                  ; Load kernel data segment
-  mov ds, ax
+  test qword [rsp + 152], 3     ; Coming from user mode?
+  jz .dispatch
+
+  mov ax, 0x10                  ; Load kernel data segment (GS is kept, as
+  mov ds, ax                    ; loading it would reset the GS base)
   mov es, ax
   mov fs, ax
-  mov gs, ax
 
+.dispatch:
   mov rdi, rsp                  ; Stack pointer as parameter
   call cpu_int_handle
 
-  pop rax                       ; Restore data segment
+global cpu_int_return
+cpu_int_return:                 ; Also entered by syscall_entry
+  mov rsp, rax                  ; Continue with the frame to resume, which is
+  call thread_switch_finish     ; on another stack after a thread switch
+
+  test qword [rsp + 152], 3     ; Returning to user mode?
+  jz .kernel_segments
+
+  mov rax, [rsp]                ; Restore data segment
   mov ds, ax
   mov es, ax
   mov fs, ax
-  mov gs, ax
+
+.kernel_segments:
+  add rsp, 8                    ; Clean up data segment
 
   pop r15                       ; Restore registers
   pop r14
@@ -93,6 +119,12 @@ cpu_int_handler_common:
   pop rax
 
   add rsp, 16                   ; Clean up error code and interrupt vector
+
+  test qword [rsp + 8], 3       ; Returning to user mode?
+  jz .kernel_exit
+  swapgs                        ; Restore user GS base
+
+.kernel_exit:
   iretq
 
 ; Macro for non-error interrupts
@@ -113,6 +145,57 @@ cpu_int_handler_common:
         jmp cpu_int_handler_common
 %endmacro
 
+; Macro for interrupts with a fast path
+; Only saves the registers the C calling convention does not preserve and
+; calls the given function, which returns whether the full frame has to be
+; built and the vector dispatched to its handler (e.g. to switch threads).
+; Keeps the segments, as the function does not touch user memory.
+%macro INT_FAST 2
+    cpu_int_stub%1:
+        cli
+        push qword 0
+        push qword %1
+
+        test qword [rsp + 24], 3    ; Coming from user mode?
+        jz %%kernel_entry
+        swapgs
+
+    %%kernel_entry:
+        push rax                    ; Push caller-saved registers (keeps the
+        push rcx                    ; stack aligned to 16 bytes)
+        push rdx
+        push rsi
+        push rdi
+        push r8
+        push r9
+        push r10
+        push r11
+
+        call %2
+        test al, al
+
+        pop r11                     ; Restore caller-saved registers
+        pop r10
+        pop r9
+        pop r8
+        pop rdi
+        pop rsi
+        pop rdx
+        pop rcx
+        pop rax
+
+        jnz cpu_int_save            ; Full handler required?
+
+        add rsp, 16                 ; Clean up error code and interrupt vector
+
+        test qword [rsp + 8], 3     ; Returning to user mode?
+        jz %%kernel_exit
+        swapgs
+
+    %%kernel_exit:
+        iretq
+%endmacro
+
 ; Exception interrupts
 INT_NOERRCODE 0
 INT_NOERRCODE 1
@@ -150,7 +233,15 @@ INT_NOERRCODE 31
 ; Remaining
 %assign i 32
 %rep 224
-  INT_NOERRCODE i
+  %if i == IRQ_PIT_VECTOR || i == IRQ_LAPIC_TIMER_VECTOR
+    INT_FAST i, irq_timer_fast
+  %elif i == SMP_RESCHEDULE_VECTOR
+    INT_FAST i, smp_reschedule_fast
+  %elif i == SMP_TLB_VECTOR
+    INT_FAST i, smp_tlb_fast
+  %else
+    INT_NOERRCODE i
+  %endif
   %assign i i+1
 %endrep
 
@@ -175,7 +266,3 @@ section .bss
 global cpu_int_idt
 cpu_int_idt:
   resb 0x1000                   ; Reserve 4096 KB
-
-global cpu_int_handlers
-cpu_int_handlers:
-  resb 0x1000                   ; Reserve 4096 KB
@@ -19,23 +19,38 @@
 #include <api/types.h>
 #include <api/string.h>
 #include <cpu.h>
+#include <smp.h>
+#include <irq.h>
+#include <fault.h>
+#include <syscall.h>
 #include <debug.h>
 
-extern cpu_int_handler_t cpu_int_handlers;
-extern cpu_int_handler_t cpu_int_handlers;
 extern uintptr_t cpu_int_stubs;
 extern cpu_int_entry_t cpu_int_idt;
 extern void cpu_int_lidt(void);
 
+/**
+ * The handlers of the interrupt vectors.
+ *
+ * The fault, system call, timer and reschedule handlers are known at build
+ * time; the timer and IPI vectors enter through fast stubs (see idt.s) and
+ * only reach their handlers when they have to switch threads.
+ */
+static cpu_int_handler_t _cpu_int_handlers[256] = {
+    [FAULT_NM_VECTOR]           = &fault_nm,
+    [FAULT_GP_VECTOR]           = &fault_gp,
+    [FAULT_PF_VECTOR]           = &fault_pf,
+    [FAULT_XF_VECTOR]           = &fault_xf,
+    [IRQ_PIT_VECTOR]            = &irq_timer_handler,
+    [IRQ_LAPIC_TIMER_VECTOR]    = &irq_timer_handler,
+    [SMP_RESCHEDULE_VECTOR]     = &smp_reschedule_handler,
+    [SYSCALL_INT_VECTOR]        = &syscall_handler_int,
+};
+
 /**
  * Initializes interrupt handling by preparing and loading the IDT.
  */
 void cpu_int_init() {
-    // Clear handler table
-    memset(
-       (void *) &cpu_int_handlers,
-       0, sizeof(uintptr_t) * 256);
-
     // Clear IDT
     memset(
        (void *) &cpu_int_idt,
@@ -52,9 +67,14 @@ void cpu_int_init() {
         entry->offsetHigh = (uint32_t) (offset >> 32);
         entry->zero0 = entry->zero1 = 0;
         entry->cs = 0x08;
-        entry->flags = 0x8E | 0x60; // TODO: Only set privilege level for selected interrupts
+        entry->flags = 0x8E;
     }
 
+    // Only system calls may be invoked from user mode using INT (the other
+    // vectors raise #GP there, so user code cannot enter e.g. the fast IRQ
+    // and IPI stubs, which send EOIs)
+    (&cpu_int_idt)[SYSCALL_INT_VECTOR].flags |= 0x60;
+
     // Load idt
     cpu_int_lidt();
 }
@@ -62,20 +82,25 @@ void cpu_int_init() {
 /**
  * Handles an interrupt by dispatching it to the correct handler.
  *
- * Called by cpu_int_handler_common.
+ * Called by cpu_int_handler_common and by the fast stubs, if their fast path
+ * requires the full handler.
  *
  * @param state The state the processor has been interrupted in. May be modified
  *  to alter the return state.
+ * @return The frame to return to, which is on the stack of another thread, if
+ *  the handler switched threads (see thread_switch).
  */
-void cpu_int_handle(cpu_int_state_t *state);
-void cpu_int_handle(cpu_int_state_t *state) {
-    // TODO: Make this faster!
-    cpu_int_handler_t handler = (&cpu_int_handlers)[state->vector];
+cpu_int_state_t *cpu_int_handle(cpu_int_state_t *state);
+cpu_int_state_t *cpu_int_handle(cpu_int_state_t *state) {
+    smp_cpu_t *cpu = smp_cpu();
+    cpu->resume = state;
+
+    cpu_int_handler_t handler = _cpu_int_handlers[state->vector];
 
-    if (0 == handler)
-        return;
+    if (0 != handler)
+        handler(state);
 
-    handler(state);
+    return cpu->resume;
 }
 
 /**
@@ -85,7 +110,9 @@ void cpu_int_handle(cpu_int_state_t *state) {
  * @param callback The handler to register for the given vector.
  */
 inline void cpu_int_register(uint8_t vector, cpu_int_handler_t callback) {
-    (&cpu_int_handlers)[vector] = callback;
+    _cpu_int_handlers[vector] = callback;
 }
 
-
+void cpu_int_load(void) {
+    cpu_int_lidt();
+}
@@ -1,27 +1,30 @@
 /**
  * Carbon Operating System
  * Copyright (C) 2011 Lukas Heidemann
- *
+ * 
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
- *
+ * 
  * This program is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
- *
+ * 
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include <api/types.h>
 #include <cpu.h>
-#include <fault.h>
 
-void fault_install(void) {
-    cpu_int_register(FAULT_GP_VECTOR, &fault_gp);
-    cpu_int_register(FAULT_PF_VECTOR, &fault_pf);
-    cpu_int_register(FAULT_XF_VECTOR, &fault_xf);
+//- Time Stamp Counter ---------------------------------------------------------
+
+uint64_t cpu_tsc_read(void)
+{
+    uint32_t low, high;
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t) high << 32) | low;
 }
@@ -22,23 +22,30 @@
 #include <memory.h>
 #include <debug.h>
 
-extern uint8_t stack_runtime_top;
-extern void cpu_tss_load(void);
-
 /**
- * Creates and loads a Task State Segment.
+ * Creates a GDT and a TSS for the current processor and loads them.
+ *
+ * The GDT is a copy of the one set up by the loader, with the TSS descriptor
+ * pointing to the processor's own TSS.
+ *
+ * @param stack_top The stack to switch to when entering the kernel.
+ * @return The created TSS.
  */
-void cpu_tss_create(void) {
+cpu_tss_t *cpu_tss_create(uintptr_t stack_top) {
     // Create TSS
     cpu_tss_t *tss = (cpu_tss_t *) heap_alloc(sizeof(cpu_tss_t));
     memset((void *) tss, 0, sizeof(cpu_tss_t));
 
-    tss->rsp0 = (uintptr_t) &stack_runtime_top;
+    tss->rsp0 = stack_top;
+
+    // Copy GDT
+    uint8_t *gdt = (uint8_t *) heap_alloc(GDT_LENGTH);
+    memcpy((void *) gdt, (void *) (MEMORY_GDT64_VADDR + 0xA), GDT_LENGTH);
 
     // Create TSS pointer in GDT
     uintptr_t tss_addr = (uintptr_t) tss;
     
-    cpu_tss_ptr_t *ptr = (cpu_tss_ptr_t *) (MEMORY_GDT64_VADDR + 0xA + TSS_GDT_OFFSET);
+    cpu_tss_ptr_t *ptr = (cpu_tss_ptr_t *) (gdt + TSS_GDT_OFFSET);
     memset((void *) ptr, 0, sizeof(cpu_tss_ptr_t));
 
     // Set tss address as base
@@ -56,5 +63,30 @@ void cpu_tss_create(void) {
         (1 << 7) |  // Present
         (3 << 5);   // Ring 3
 
-    cpu_tss_load();
+    // Load GDT
+    struct {
+        uint16_t limit;
+        uint64_t base;
+    } PACKED gdtr = { GDT_LENGTH - 1, (uintptr_t) gdt };
+
+    asm volatile ("lgdt %0" :: "m" (gdtr));
+
+    // Reload code and data segments (GS keeps its base)
+    asm volatile (
+        "pushq $0x08\n"
+        "leaq 1f(%%rip), %%rax\n"
+        "pushq %%rax\n"
+        "lretq\n"
+        "1:\n"
+        "movw $0x10, %%ax\n"
+        "movw %%ax, %%ds\n"
+        "movw %%ax, %%es\n"
+        "movw %%ax, %%fs\n"
+        "movw %%ax, %%ss\n"
+        ::: "rax", "memory");
+
+    // Load TSS
+    asm volatile ("ltr %w0" :: "r" (TSS_GDT_OFFSET | 3));
+
+    return tss;
 }
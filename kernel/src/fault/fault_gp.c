@@ -46,7 +46,13 @@ void fault_gp(cpu_int_state_t *state) {
     DEBUG_HEX(state->error_code);
     DEBUG(").\n");
 
-    // Terminate process
-    process_terminate(process_current->pid);
+    // Terminate process (unless terminated by another processor meanwhile)
+    process_t *process = process_lock_current(true);
+
+    if (LIKELY(0 != process)) {
+        process_terminate(process->pid);
+        process_unlock_current(process, true);
+    }
+
     thread_switch(scheduler_next(), state);
 }
@@ -21,32 +21,65 @@
 #include <fault.h>
 #include <debug.h>
 #include <multitasking.h>
+#include <pager.h>
 
 /**
  * Fault Handler: Page Fault
  *
  * Kernel: Panic
- * User: Handle stack increase or terminate otherwise.
+ * User: Handle stack increase, forward to the pager of the faulting region or
+ * terminate otherwise.
  */
 void fault_pf(cpu_int_state_t *state) {
+    // Faulting address (before anything else could fault)
+    uintptr_t address;
+    asm volatile ("mov %%cr2, %0" : "=r" (address));
+
     // Is in kernel?
     if (state->cs == 0x8) {
         console_print("PANIC: Page Fault in kernel at ");
         console_print_hex(state->rip);
         console_print(" regarding address ");
-        console_print_hex(state->state.r15); // TODO: Read CR2 directly
+        console_print_hex(address);
         console_print(".\n");
         while (1);
     }
 
     // Is stack?
-    uintptr_t address = state->state.r15;
     uintptr_t stack_end = thread_current->stack.address;
 
-    if (address < stack_end && address >= stack_end - STACK_LENGTH_MAX) {
-        // Resize stack
+    if (address < stack_end && address >= stack_end - thread_current->stack.limit) {
+        process_t *process = process_lock_current(false);
+
+        if (UNLIKELY(0 == process)) {
+            thread_switch(scheduler_next(), state);
+            return;
+        }
+
+        // Resize stack (by more than the faulting page, to fault less often)
         size_t stack_size = stack_end - (address & ~0xFFF);
-        stack_resize(&thread_current->stack, stack_size, process_current);
+        stack_size = (stack_size + STACK_GROW_LENGTH - 1) & ~(STACK_GROW_LENGTH - 1);
+
+        if (stack_size > thread_current->stack.limit)
+            stack_size = thread_current->stack.limit;
+
+        stack_resize(&thread_current->stack, stack_size, process);
+
+        process_unlock_current(process, false);
+        return;
+    }
+
+    // Forward to the region's pager, if any (unless terminated by another
+    // processor meanwhile)
+    process_t *process = process_lock_current(true);
+
+    if (UNLIKELY(0 == process)) {
+        thread_switch(scheduler_next(), state);
+        return;
+    }
+
+    if (pager_fault(process, address, state->error_code, state)) {
+        process_unlock_current(process, true);
         return;
     }
 
@@ -58,6 +91,8 @@ void fault_pf(cpu_int_state_t *state) {
     DEBUG(".\n");
 
     // Terminate process
-    process_terminate(process_current->pid);
+    process_terminate(process->pid);
+    process_unlock_current(process, true);
+
     thread_switch(scheduler_next(), state);
 }
@@ -15,14 +15,29 @@
 ; along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 bits 64
+
+;; Save area formats (see fpu_mode)
+%define FPU_MODE_FXSAVE		0
+%define FPU_MODE_XSAVE		1
+%define FPU_MODE_XSAVEOPT	2
+
+;; XCR0 state components
+%define XCR0_X87		(1 << 0)
+%define XCR0_SSE		(1 << 1)
+%define XCR0_AVX		(1 << 2)
+;; Opmask, ZMM_Hi256 and Hi16_ZMM
+%define XCR0_AVX512		((1 << 5) | (1 << 6) | (1 << 7))
+
 section .text
 
 global fpu_init
 fpu_init:
-	; Clear CR.EM and set CR.MP
+	push rbx
+
+	; Clear CR.EM and set CR.MP and CR0.TS (FPU is loaded on first use)
 	mov rax, cr0
 	and rax, ~(1 << 2)
-	or rax, (1 << 1)
+	or rax, (1 << 1) | (1 << 3)
 	mov cr0, rax
 
 	; Set CR4.OSFXSR and CR4.OSXMMEXCPT
@@ -31,25 +46,134 @@ fpu_init:
 	or rax, (1 << 10)
 	mov cr4, rax
 
+	; XSAVE supported?
+	mov eax, 0x1
+	xor ecx, ecx
+	cpuid
+	test ecx, (1 << 26)
+	jz .done
+
+	; Set CR4.OSXSAVE
+	mov rax, cr4
+	or rax, (1 << 18)
+	mov cr4, rax
+
+	; Supported components (x87 and SSE are always supported)
+	mov eax, 0xD
+	xor ecx, ecx
+	cpuid
+	and eax, XCR0_X87 | XCR0_SSE | XCR0_AVX | XCR0_AVX512
+
+	; AVX-512 components can only be enabled together with AVX
+	mov edx, eax
+	and edx, XCR0_AVX | XCR0_AVX512
+	cmp edx, XCR0_AVX | XCR0_AVX512
+	je .enable
+	and eax, ~(XCR0_AVX512)
+
+.enable:
+	; Program XCR0
+	xor edx, edx
+	xor ecx, ecx
+	xsetbv
+
+	; Size of the save area for the enabled components
+	mov eax, 0xD
+	xor ecx, ecx
+	cpuid
+	mov rax, fpu_state_size
+	mov [rax], rbx
+
+	; XSAVEOPT supported?
+	mov eax, 0xD
+	mov ecx, 0x1
+	cpuid
+	mov rdx, fpu_mode
+	mov byte [rdx], FPU_MODE_XSAVE
+	test eax, (1 << 0)
+	jz .done
+	mov byte [rdx], FPU_MODE_XSAVEOPT
+
+.done:
+	pop rbx
 	ret
 
-global fpu_prepare
-fpu_prepare:
-	; Set MXCSR.PM, MXCSR.UM, MXCSR.OM,
-	;     MXCSR.ZM and MXCSR.DM
-	stmxcsr dword [rsp - 4]
-	mov eax, dword [rsp - 4]
-	or rax, (1 << 12) | (1 << 11) | (1 << 10) | (1 << 9) | (1 << 8)
-	mov dword [rsp - 4], eax
-	ldmxcsr dword [rsp - 4]
+global fpu_state_init
+fpu_state_init:
+	; Clear region (including the XSAVE header)
+	mov rdx, rdi
+	mov rax, fpu_state_size
+	mov rcx, [rax]
+	shr rcx, 3
+	xor eax, eax
+	rep stosq
+
+	; Mask all x87 FPU and SSE exceptions
+	mov word [rdx], 0x037F		; FCW
+	mov dword [rdx + 24], 0x1F80	; MXCSR
+	ret
+
+global fpu_enable
+fpu_enable:
+	clts
+	ret
+
+global fpu_disable
+fpu_disable:
+	; Set CR0.TS
+	mov rax, cr0
+	or rax, (1 << 3)
+	mov cr0, rax
 	ret
 
 global fpu_save:
 fpu_save:
+	mov rax, fpu_mode
+	movzx ecx, byte [rax]
+
+	; Save all enabled components
+	mov eax, 0xFFFFFFFF
+	mov edx, eax
+
+	cmp ecx, FPU_MODE_XSAVEOPT
+	je .xsaveopt
+	cmp ecx, FPU_MODE_XSAVE
+	je .xsave
+
 	fxsave [rdi]
 	ret
 
+.xsave:
+	xsave [rdi]
+	ret
+
+.xsaveopt:
+	; Only writes components modified since the last XRSTOR from the region
+	xsaveopt [rdi]
+	ret
+
 global fpu_load
 fpu_load:
+	mov rax, fpu_mode
+	cmp byte [rax], FPU_MODE_FXSAVE
+	je .fxrstor
+
+	mov eax, 0xFFFFFFFF
+	mov edx, eax
+	xrstor [rdi]
+	ret
+
+.fxrstor:
 	fxrstor [rdi]
 	ret
+
+section .data
+
+;; Size of the save area (FXSAVE format unless XSAVE is supported)
+global fpu_state_size
+fpu_state_size:
+	dq 512
+
+;; Instructions used to save and load the state (see FPU_MODE_*)
+fpu_mode:
+	db FPU_MODE_FXSAVE
@@ -24,10 +24,47 @@
 #include <debug.h>
 #include <multitasking.h>
 #include <memory.h>
+#include <idmap.h>
 
 //- IPC - Buffer ----------------------------------------------------------------
 
-void ipc_buffer_resize(uint32_t size, uint8_t buffer, thread_t *thread) {
+/**
+ * Returns the address of a thread's IPC buffer.
+ *
+ * @param buffer The number of the buffer.
+ * @param thread The thread.
+ * @return The address.
+ */
+static uintptr_t _ipc_buffer_addr(uint8_t buffer, thread_t *thread) {
+	return IPC_BUFFER_VADDR(buffer) + IPC_BUFFER_SIZE * thread->tid;
+}
+
+/**
+ * Attaches the parked page table with the most pages to an empty buffer.
+ *
+ * @param buffer The number of the buffer.
+ * @param thread The thread whose buffer to attach the page table to.
+ * @param process The process hosting the thread.
+ */
+static void _ipc_buffer_unpark(uint8_t buffer, thread_t *thread, process_t *process) {
+	size_t slot, best = PROCESS_IPC_POOL;
+
+	for (slot = 0; slot < PROCESS_IPC_POOL; ++slot)
+		if (0 != process->ipc_pool[slot] &&
+				(PROCESS_IPC_POOL == best || process->ipc_pool[slot] > process->ipc_pool[best]))
+			best = slot;
+
+	if (PROCESS_IPC_POOL == best)
+		return;
+
+	uint64_t pt = memory_struct_remove(IPC_POOL_VADDR(best), PAGE_STRUCT_PT);
+	memory_struct_insert(_ipc_buffer_addr(buffer, thread), PAGE_STRUCT_PT, pt);
+
+	thread->ipc_buffer_mapped[buffer] = process->ipc_pool[best];
+	process->ipc_pool[best] = 0;
+}
+
+void ipc_buffer_resize(uint32_t size, uint8_t buffer, thread_t *thread, process_t *process) {
 	// Align size
 	size = memalign(size, 0x1000);
 
@@ -35,37 +72,60 @@ void ipc_buffer_resize(uint32_t size, uint8_t buffer, thread_t *thread) {
 	if (UNLIKELY(size > IPC_BUFFER_SIZE))
 		PANIC("Trying to increase IPC buffer size to a size larger than maximum.");
 
-	// Get current size
-	uint32_t size_current = thread->ipc_buffer_sz[buffer];
+	// Reuse a parked page table, if empty
+	if (size > 0 && 0 == thread->ipc_buffer_mapped[buffer])
+		_ipc_buffer_unpark(buffer, thread, process);
 
-	// Get buffer address
-	uintptr_t buffer_addr =
-			IPC_BUFFER_VADDR(buffer) +
-			thread->tid * IPC_BUFFER_SIZE;
+	// Map new pages beyond the high-water mark
+	uint32_t mapped = thread->ipc_buffer_mapped[buffer];
 
-	// Size increased?
-	if (size > size_current) {
-		// Map new pages
-		uintptr_t addr = buffer_addr + size_current;
+	if (size > mapped) {
+		uintptr_t buffer_addr = _ipc_buffer_addr(buffer, thread);
+		uintptr_t addr = buffer_addr + mapped;
 
 		for (; addr < buffer_addr + size; addr += 0x1000)
 			memory_map(addr, frame_alloc(), PAGE_FLAG_USER | PAGE_FLAG_WRITEABLE);
 
-	} else if (size < size_current) {
-		// Remove unused pages
-		uintptr_t addr = buffer_addr + size;
-
-		for (; addr < buffer_addr + size_current; addr += 0x1000) {
-			uintptr_t phys = memory_physical(addr);
-			memory_unmap(addr);
-			frame_free(phys);
-		}
+		thread->ipc_buffer_mapped[buffer] = size;
 	}
 
 	// Update size
 	thread->ipc_buffer_sz[buffer] = size;
 }
 
+void ipc_buffer_release(uint8_t buffer, thread_t *thread, process_t *process) {
+	uint32_t mapped = thread->ipc_buffer_mapped[buffer];
+	uintptr_t buffer_addr = _ipc_buffer_addr(buffer, thread);
+
+	thread->ipc_buffer_sz[buffer] = 0;
+	thread->ipc_buffer_mapped[buffer] = 0;
+
+	if (0 == mapped)
+		return;
+
+	// Park the page table in a free slot
+	size_t slot;
+
+	for (slot = 0; slot < PROCESS_IPC_POOL; ++slot) {
+		if (0 == process->ipc_pool[slot]) {
+			uint64_t pt = memory_struct_remove(buffer_addr, PAGE_STRUCT_PT);
+			memory_struct_insert(IPC_POOL_VADDR(slot), PAGE_STRUCT_PT, pt);
+
+			process->ipc_pool[slot] = mapped;
+			return;
+		}
+	}
+
+	// Pool is full: Free the pages (the page table is kept)
+	uintptr_t addr;
+
+	for (addr = buffer_addr; addr < buffer_addr + mapped; addr += 0x1000) {
+		uintptr_t phys = memory_physical(addr);
+		memory_unmap(addr);
+		frame_free(phys);
+	}
+}
+
 void ipc_buffer_move(
 		thread_t *source, uint8_t source_buf,
 		thread_t *target, uint8_t target_buf,
@@ -73,20 +133,239 @@ void ipc_buffer_move(
 	// Get PT in source address space
     uintptr_t source_addr =
     		IPC_BUFFER_VADDR(source_buf) + IPC_BUFFER_SIZE * source->tid;
+
+    // Clear pages kept beyond the size, which may hold older messages
+    uint32_t size = source->ipc_buffer_sz[source_buf];
+    uint32_t mapped = source->ipc_buffer_mapped[source_buf];
+
+    if (mapped > size)
+    	memset((void *) (source_addr + size), 0, mapped - size);
+
     uint64_t pt = memory_struct_remove(source_addr, PAGE_STRUCT_PT);
 
     // Switch to the target's address space
     memory_space_switch(target_proc->addr_space);
 
+    // Park the target buffer's pages, which would be lost otherwise
+    ipc_buffer_release(target_buf, target, target_proc);
+
     // Map the message to the target buffer
-    uint64_t target_addr =
-    		IPC_BUFFER_VADDR(target_buf) + IPC_BUFFER_SIZE * target->tid;
+    uint64_t target_addr = _ipc_buffer_addr(target_buf, target);
 
     memory_struct_insert(target_addr, PAGE_STRUCT_PT, pt);
 
     // Change buffer sizes
     target->ipc_buffer_sz[target_buf] = source->ipc_buffer_sz[source_buf];
+    target->ipc_buffer_mapped[target_buf] = source->ipc_buffer_mapped[source_buf];
     source->ipc_buffer_sz[source_buf] = 0;
+    source->ipc_buffer_mapped[source_buf] = 0;
+}
+
+//- IPC - Receivers ------------------------------------------------------------
+
+void ipc_receiver_wait(process_t *process, thread_t *thread) {
+	thread->role = THREAD_ROLE_IPC_WAITING;
+
+	// Push, so the receiver that ran last (whose stack and caches are still
+	// warm) is used first
+	thread->ipc_next = process->ipc_receivers;
+	process->ipc_receivers = thread;
+}
+
+thread_t *ipc_receiver_take(process_t *process) {
+	thread_t *thread = process->ipc_receivers;
+
+	if (0 == thread)
+		return 0;
+
+	process->ipc_receivers = thread->ipc_next;
+	thread->ipc_next = 0;
+	thread->role = THREAD_ROLE_IPC_RECEIVER;
+
+	return thread;
+}
+
+void ipc_receiver_remove(process_t *process, thread_t *thread) {
+	thread_t **link = &process->ipc_receivers;
+
+	while (0 != *link && thread != *link)
+		link = &(*link)->ipc_next;
+
+	if (0 != *link)
+		*link = thread->ipc_next;
+
+	thread->ipc_next = 0;
+	thread->role = THREAD_ROLE_IPC_RECEIVER;
+}
+
+//- IPC - Queues ---------------------------------------------------------------
+
+STATIC_ASSERT(
+	sizeof(ipc_queue_t) + IPC_QUEUE_SLOTS_MAX * sizeof(ipc_queue_msg_t) <= HEAP_ALLOC_MAX,
+	"A queue with the maximum number of slots must fit into a heap slot.");
+
+/**
+ * Maps queue ids to queues.
+ */
+static idmap_t _ipc_queue_map;
+
+void ipc_queue_init(void) {
+	idmap_init(&_ipc_queue_map, IPC_QUEUE_MAX);
+}
+
+/**
+ * Wakes up the first thread waiting for the given queue, if any.
+ *
+ * @param queue The queue.
+ */
+static void _ipc_queue_notify(ipc_queue_t *queue) {
+	thread_t *thread = queue->waiters;
+
+	if (0 == thread)
+		return;
+
+	queue->waiters = thread->ipc_next;
+	thread->ipc_next = 0;
+
+	// Returns no messages, so the receiver retries
+	thread->sleep_mode = 0;
+	thread->sleep_ctx = 0;
+	thread->state->state.rax = 0;
+	thread->state->state.rbx = 0;
+
+	thread_thaw(thread, 0);
+}
+
+ipc_queue_t *ipc_queue_create(process_t *process, uint32_t slots) {
+	uint32_t capacity = 1;
+
+	while (capacity < slots)
+		capacity <<= 1;
+
+	ipc_queue_t *queue = (ipc_queue_t *) heap_alloc(
+			sizeof(ipc_queue_t) + capacity * sizeof(ipc_queue_msg_t));
+
+	queue->id = idmap_alloc(&_ipc_queue_map, queue);
+
+	if (UNLIKELY(IDMAP_NONE == queue->id)) {
+		heap_free(queue);
+		return 0;
+	}
+
+	queue->owner = process->pid;
+	queue->capacity = capacity;
+	queue->head = queue->tail = 0;
+	queue->waiters = 0;
+
+	queue->next = process->ipc_queues;
+	process->ipc_queues = queue;
+
+	return queue;
+}
+
+ipc_queue_t *ipc_queue_get(uint32_t id) {
+	return (ipc_queue_t *) idmap_get(&_ipc_queue_map, id);
+}
+
+uint32_t ipc_queue_push(
+		ipc_queue_t *queue,
+		uint32_t sender,
+		ipc_queue_msg_t *messages,
+		uint32_t count) {
+	bool was_empty = (queue->head == queue->tail);
+	uint32_t free = queue->capacity - (queue->tail - queue->head);
+
+	if (count > free)
+		count = free;
+
+	uint32_t i;
+
+	for (i = 0; i < count; ++i) {
+		ipc_queue_msg_t *slot = &queue->slots[(queue->tail + i) & (queue->capacity - 1)];
+
+		memcpy(slot, &messages[i], sizeof(ipc_queue_msg_t));
+		slot->sender = sender;
+
+		if (slot->length > IPC_SHORT_SIZE)
+			slot->length = IPC_SHORT_SIZE;
+	}
+
+	queue->tail += count;
+
+	// Only notify on the transition to non-empty (see ipc_queue_pop)
+	if (was_empty && count > 0)
+		_ipc_queue_notify(queue);
+
+	return count;
+}
+
+uint32_t ipc_queue_pop(ipc_queue_t *queue, ipc_queue_msg_t *messages, uint32_t count) {
+	uint32_t used = queue->tail - queue->head;
+
+	if (count > used)
+		count = used;
+
+	uint32_t i;
+
+	for (i = 0; i < count; ++i)
+		memcpy(
+				&messages[i],
+				&queue->slots[(queue->head + i) & (queue->capacity - 1)],
+				sizeof(ipc_queue_msg_t));
+
+	queue->head += count;
+
+	// Pass the notification on, if this receiver left messages
+	if (queue->head != queue->tail)
+		_ipc_queue_notify(queue);
+
+	return count;
+}
+
+void ipc_queue_wait(ipc_queue_t *queue, thread_t *thread) {
+	thread->sleep_mode = THREAD_SLEEP_QUEUE;
+	thread->sleep_ctx = queue;
+	thread->ipc_next = queue->waiters;
+	queue->waiters = thread;
+
+	thread_freeze(thread);
+}
+
+void ipc_queue_waiter_remove(thread_t *thread) {
+	ipc_queue_t *queue = (ipc_queue_t *) thread->sleep_ctx;
+	thread_t **link = &queue->waiters;
+
+	while (0 != *link && thread != *link)
+		link = &(*link)->ipc_next;
+
+	if (0 != *link)
+		*link = thread->ipc_next;
+
+	thread->ipc_next = 0;
+	thread->sleep_mode = 0;
+	thread->sleep_ctx = 0;
+}
+
+void ipc_queue_destroy(process_t *process, ipc_queue_t *queue) {
+	// Unlink from owner
+	ipc_queue_t **link = &process->ipc_queues;
+
+	while (queue != *link)
+		link = &(*link)->next;
+
+	*link = queue->next;
+
+	// Wake up waiters, which fail to find the queue when retrying
+	while (0 != queue->waiters)
+		_ipc_queue_notify(queue);
+
+	idmap_free(&_ipc_queue_map, queue->id);
+	heap_free(queue);
+}
+
+void ipc_queue_dispose(process_t *process) {
+	while (0 != process->ipc_queues)
+		ipc_queue_destroy(process, process->ipc_queues);
 }
 
 //- IPC ------------------------------------------------------------------------
@@ -105,3 +384,12 @@ void ipc_message_header(
     state->state.rdx = sender_pid;
     state->state.rbx = flags;
 }
+
+void ipc_message_short(cpu_int_state_t *source, cpu_int_state_t *target) {
+	target->state.r8 = source->state.r8;
+	target->state.r9 = source->state.r9;
+	target->state.r12 = source->state.r12;
+	target->state.r13 = source->state.r13;
+	target->state.r14 = source->state.r14;
+	target->state.r15 = source->state.r15;
+}
@@ -0,0 +1,157 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <irq.h>
+#include <acpi.h>
+#include <memory.h>
+
+//- I/O APIC -------------------------------------------------------------------
+
+bool irq_ioapic_enabled = false;
+
+/**
+ * Number of redirection entries for each I/O APIC.
+ */
+static uint32_t _irq_ioapic_entries[ACPI_IOAPIC_MAX];
+
+/**
+ * Returns the base address of the registers of the I/O APIC with the given
+ * index.
+ *
+ * @param index The index of the I/O APIC.
+ * @return The base address.
+ */
+static inline volatile uint32_t *_irq_ioapic_regs(size_t index) {
+    return (volatile uint32_t *) (MEMORY_IOAPIC_VADDR + index * PAGE_SIZE +
+        (acpi_ioapics[index].paddr & (PAGE_SIZE - 1)));
+}
+
+/**
+ * Reads the register of the given I/O APIC.
+ *
+ * @param index The index of the I/O APIC.
+ * @param reg The register to read.
+ * @return The value of the register.
+ */
+static uint32_t _irq_ioapic_read(size_t index, uint32_t reg) {
+    volatile uint32_t *regs = _irq_ioapic_regs(index);
+    regs[0] = reg;
+    return regs[4];
+}
+
+/**
+ * Writes to the register of the given I/O APIC.
+ *
+ * @param index The index of the I/O APIC.
+ * @param reg The register to write.
+ * @param value The value to write.
+ */
+static void _irq_ioapic_write(size_t index, uint32_t reg, uint32_t value) {
+    volatile uint32_t *regs = _irq_ioapic_regs(index);
+    regs[0] = reg;
+    regs[4] = value;
+}
+
+/**
+ * Finds the I/O APIC that handles the given global system interrupt.
+ *
+ * @param gsi The global system interrupt.
+ * @param pin Pointer to store the input pin of the I/O APIC to.
+ * @return The index of the I/O APIC or ACPI_IOAPIC_MAX, if there is none.
+ */
+static size_t _irq_ioapic_find(uint32_t gsi, uint32_t *pin) {
+    size_t i;
+    for (i = 0; i < acpi_ioapic_count; ++i) {
+        uint32_t base = acpi_ioapics[i].gsi_base;
+
+        if (gsi >= base && gsi < base + _irq_ioapic_entries[i]) {
+            *pin = gsi - base;
+            return i;
+        }
+    }
+
+    return ACPI_IOAPIC_MAX;
+}
+
+void irq_ioapic_init(void) {
+    // Map and mask all entries
+    size_t i;
+    for (i = 0; i < acpi_ioapic_count; ++i) {
+        memory_map(
+            MEMORY_IOAPIC_VADDR + i * PAGE_SIZE,
+            acpi_ioapics[i].paddr & ~((uintptr_t) PAGE_SIZE - 1),
+            PAGE_FLAG_WRITEABLE | PAGE_FLAG_CACHE_DISABLE | PAGE_FLAG_WRITE_THROUGH);
+
+        uint32_t version = _irq_ioapic_read(i, IRQ_IOAPIC_REG_VERSION);
+        _irq_ioapic_entries[i] = ((version >> 16) & 0xFF) + 1;
+
+        uint32_t pin;
+        for (pin = 0; pin < _irq_ioapic_entries[i]; ++pin)
+            _irq_ioapic_write(i, IRQ_IOAPIC_REG_REDIR + pin * 2, IRQ_IOAPIC_REDIR_MASKED);
+    }
+
+    // Route ISA IRQs to this processor
+    uint8_t dest = irq_lapic_id();
+    uint8_t index;
+
+    for (index = 0; index < ACPI_ISA_IRQ_COUNT; ++index) {
+        acpi_isa_irq_t *isa = &acpi_isa_irqs[index];
+        uint32_t pin;
+        size_t ioapic = _irq_ioapic_find(isa->gsi, &pin);
+
+        if (ACPI_IOAPIC_MAX == ioapic)
+            continue;
+
+        // ISA defaults: active high, edge triggered
+        uint32_t low = (IRQ_OFFSET + index) | IRQ_IOAPIC_REDIR_MASKED;
+
+        if (ACPI_MADT_ISO_POLARITY_LOW == (isa->flags & ACPI_MADT_ISO_POLARITY_MASK))
+            low |= IRQ_IOAPIC_REDIR_POLARITY_LOW;
+
+        if (ACPI_MADT_ISO_TRIGGER_LEVEL == (isa->flags & ACPI_MADT_ISO_TRIGGER_MASK))
+            low |= IRQ_IOAPIC_REDIR_TRIGGER_LEVEL;
+
+        _irq_ioapic_write(ioapic, IRQ_IOAPIC_REG_REDIR + pin * 2 + 1, ((uint32_t) dest) << 24);
+        _irq_ioapic_write(ioapic, IRQ_IOAPIC_REG_REDIR + pin * 2, low);
+    }
+
+    irq_ioapic_enabled = (acpi_ioapic_count > 0);
+}
+
+void irq_ioapic_mask(uint32_t gsi) {
+    uint32_t pin;
+    size_t ioapic = _irq_ioapic_find(gsi, &pin);
+
+    if (UNLIKELY(ACPI_IOAPIC_MAX == ioapic))
+        return;
+
+    uint32_t reg = IRQ_IOAPIC_REG_REDIR + pin * 2;
+    _irq_ioapic_write(ioapic, reg, _irq_ioapic_read(ioapic, reg) | IRQ_IOAPIC_REDIR_MASKED);
+}
+
+void irq_ioapic_unmask(uint32_t gsi) {
+    uint32_t pin;
+    size_t ioapic = _irq_ioapic_find(gsi, &pin);
+
+    if (UNLIKELY(ACPI_IOAPIC_MAX == ioapic))
+        return;
+
+    uint32_t reg = IRQ_IOAPIC_REG_REDIR + pin * 2;
+    _irq_ioapic_write(ioapic, reg, _irq_ioapic_read(ioapic, reg) & ~IRQ_IOAPIC_REDIR_MASKED);
+}
@@ -0,0 +1,68 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <irq.h>
+#include <acpi.h>
+#include <debug.h>
+
+//- IRQ Routing ----------------------------------------------------------------
+
+void irq_init(void) {
+    // Reroute and mask the PIC in any case (spurious IRQs)
+    irq_pic_init();
+
+    // Discover APICs
+    if (!acpi_init() || !acpi_madt_parse()) {
+        DEBUG("No ACPI MADT found, using PIC.\n");
+        return;
+    }
+
+    if (!irq_lapic_init()) {
+        DEBUG("No local APIC found, using PIC.\n");
+        return;
+    }
+
+    irq_ioapic_init();
+
+    if (irq_ioapic_enabled)
+        irq_pic_disable();
+    else
+        DEBUG("No I/O APIC found, routing ISA IRQs through PIC.\n");
+}
+
+void irq_eoi(uint8_t index) {
+    if (irq_ioapic_enabled)
+        irq_lapic_eoi();
+    else
+        irq_pic_eoi(index);
+}
+
+void irq_mask(uint8_t index) {
+    if (irq_ioapic_enabled && index < ACPI_ISA_IRQ_COUNT)
+        irq_ioapic_mask(acpi_isa_irqs[index].gsi);
+    else
+        irq_pic_mask(index);
+}
+
+void irq_unmask(uint8_t index) {
+    if (irq_ioapic_enabled && index < ACPI_ISA_IRQ_COUNT)
+        irq_ioapic_unmask(acpi_isa_irqs[index].gsi);
+    else
+        irq_pic_unmask(index);
+}
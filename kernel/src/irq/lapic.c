@@ -0,0 +1,140 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <irq.h>
+#include <cpu.h>
+#include <acpi.h>
+#include <memory.h>
+
+//- Local APIC -----------------------------------------------------------------
+
+bool irq_lapic_enabled = false;
+
+/**
+ * The initial count the LAPIC timer has been programmed with last.
+ */
+static uint32_t _irq_lapic_timer_programmed = 0;
+
+/**
+ * Reads the LAPIC register at the given offset.
+ *
+ * @param reg The offset of the register.
+ * @return The value of the register.
+ */
+static inline uint32_t _irq_lapic_read(uint32_t reg) {
+    return *((volatile uint32_t *) (MEMORY_LAPIC_VADDR + reg));
+}
+
+/**
+ * Writes the given value to the LAPIC register at the given offset.
+ *
+ * @param reg The offset of the register.
+ * @param value The value to write.
+ */
+static inline void _irq_lapic_write(uint32_t reg, uint32_t value) {
+    *((volatile uint32_t *) (MEMORY_LAPIC_VADDR + reg)) = value;
+}
+
+bool irq_lapic_init(void) {
+    // Check for LAPIC
+    uint32_t regs[4];
+    cpu_cpuid(CPU_CPUID_FEATURES, regs);
+
+    if (0 == (regs[3] & CPU_CPUID_FEATURES_EDX_APIC))
+        return false;
+
+    // Physical address from the MADT or the APIC base MSR
+    uint64_t base = cpu_msr_read(CPU_MSR_APIC_BASE);
+    uintptr_t paddr = (0 != acpi_lapic_paddr) ? acpi_lapic_paddr : base;
+    paddr &= ~((uintptr_t) PAGE_SIZE - 1);
+
+    // Map registers (uncached)
+    memory_map(
+        MEMORY_LAPIC_VADDR, paddr,
+        PAGE_FLAG_WRITEABLE | PAGE_FLAG_CACHE_DISABLE | PAGE_FLAG_WRITE_THROUGH);
+
+    // Globally enable
+    cpu_msr_write(CPU_MSR_APIC_BASE, base | IRQ_LAPIC_BASE_ENABLE);
+
+    // Accept all priorities
+    _irq_lapic_write(IRQ_LAPIC_REG_TPR, 0);
+
+    // Mask local interrupts that are not used
+    _irq_lapic_write(IRQ_LAPIC_REG_LVT_TIMER, IRQ_LAPIC_LVT_MASKED | IRQ_LAPIC_TIMER_VECTOR);
+    _irq_lapic_write(IRQ_LAPIC_REG_LVT_ERROR, IRQ_LAPIC_LVT_MASKED);
+
+    // Software enable and set spurious vector
+    _irq_lapic_write(
+        IRQ_LAPIC_REG_SVR,
+        IRQ_LAPIC_SVR_ENABLE | IRQ_LAPIC_SPURIOUS_VECTOR);
+
+    // Clear pending EOIs
+    irq_lapic_eoi();
+
+    irq_lapic_enabled = true;
+    return true;
+}
+
+void irq_lapic_eoi(void) {
+    _irq_lapic_write(IRQ_LAPIC_REG_EOI, 0);
+}
+
+uint8_t irq_lapic_id(void) {
+    return (uint8_t) (_irq_lapic_read(IRQ_LAPIC_REG_ID) >> 24);
+}
+
+void irq_lapic_ipi(uint8_t apic_id, uint32_t command) {
+    _irq_lapic_write(IRQ_LAPIC_REG_ICR_HIGH, ((uint32_t) apic_id) << 24);
+    _irq_lapic_write(IRQ_LAPIC_REG_ICR_LOW, command);
+
+    // Wait for delivery
+    while (0 != (_irq_lapic_read(IRQ_LAPIC_REG_ICR_LOW) & IRQ_LAPIC_ICR_PENDING))
+        asm volatile ("pause");
+}
+
+uint32_t irq_lapic_timer_calibrate(uint32_t pit_counts) {
+    // One-shot, masked, divide by 16
+    _irq_lapic_write(IRQ_LAPIC_REG_TIMER_DIVIDE, IRQ_LAPIC_TIMER_DIVIDE_16);
+    _irq_lapic_write(IRQ_LAPIC_REG_LVT_TIMER, IRQ_LAPIC_LVT_MASKED | IRQ_LAPIC_TIMER_VECTOR);
+
+    // Start both timers and wait for the PIT to expire
+    irq_pit_oneshot(pit_counts);
+    _irq_lapic_write(IRQ_LAPIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+
+    while (irq_pit_elapsed() < pit_counts);
+
+    uint32_t current = _irq_lapic_read(IRQ_LAPIC_REG_TIMER_CURRENT);
+
+    // Stop LAPIC timer
+    _irq_lapic_write(IRQ_LAPIC_REG_TIMER_INITIAL, 0);
+
+    return 0xFFFFFFFF - current;
+}
+
+void irq_lapic_timer_oneshot(uint32_t counts) {
+    _irq_lapic_write(IRQ_LAPIC_REG_LVT_TIMER, IRQ_LAPIC_TIMER_VECTOR);
+    _irq_lapic_write(IRQ_LAPIC_REG_TIMER_INITIAL, counts);
+
+    _irq_lapic_timer_programmed = counts;
+}
+
+uint32_t irq_lapic_timer_elapsed(void) {
+    return _irq_lapic_timer_programmed -
+        _irq_lapic_read(IRQ_LAPIC_REG_TIMER_CURRENT);
+}
@@ -32,7 +32,7 @@ void irq_pic_init() {
 
     // ICW2: Define PIC vectors
     io_outb(IO_PIC1_DATA, IRQ_OFFSET);
-    io_outb(IO_PIC2_DATA, IRQ_OFFSET + 7);
+    io_outb(IO_PIC2_DATA, IRQ_OFFSET + 8);
 
     // ICW3: Continue init sequence
     io_outb(IO_PIC1_DATA, 4);
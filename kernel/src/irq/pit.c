@@ -20,66 +20,46 @@
 #include <irq.h>
 #include <cpu.h>
 #include <io.h>
-#include <debug.h>
-#include <multitasking.h>
 
-/**
- * The number of ticks since the system was started.
- *
- * Increased by 1 every time the PIT fires.
- */
-time_t irq_pit_ticks = 0;
+//- Programmable Interrupt Timer -----------------------------------------------
 
 /**
- * Sets the tick frequency of the PIT.
- *
- * @param hz Tick frequency in Hz.
+ * The number of counts the PIT has been programmed with last.
  */
-static void irq_pit_set_freq(uint32_t hz) {
-    uint32_t divider;
+static uint32_t _irq_pit_programmed = 0;
 
-    divider = 1193180 / hz;
+void irq_pit_oneshot(uint32_t counts) {
+    if (counts < IRQ_PIT_ONESHOT_MIN)
+        counts = IRQ_PIT_ONESHOT_MIN;
+    else if (counts > IRQ_PIT_ONESHOT_MAX)
+        counts = IRQ_PIT_ONESHOT_MAX;
 
-    if ((divider == 0) || (divider >= 65536))
-        PANIC("Failed to program PIT to illegal frequency.");
+    // Channel 0, lobyte/hibyte, mode 0 (interrupt on terminal count)
+    io_outb(0x43, 0x30);
+    io_outb(0x40, (uint8_t) (counts & 0xFF));
+    io_outb(0x40, (uint8_t) (counts >> 0x8));
 
-    io_outb(0x43, 0x36);
-    io_outb(0x40, (uint8_t) (divider & 0xFF));
-    io_outb(0x40, (uint8_t) (divider >> 0x8));
+    _irq_pit_programmed = counts;
 }
 
-/**
- * Initializes the PIT by settings its frequency to IRQ_PIT_FREQ,
- * registering the handler and unmasking the PIT IRQ line.
- */
-void irq_pit_init(void) {
-    // Set frequency
-    irq_pit_set_freq(IRQ_PIT_FREQ);
+uint32_t irq_pit_elapsed(void) {
+    // Latch channel 0
+    io_outb(0x43, 0x00);
 
-    // Set handler
-    cpu_int_register(IRQ_PIT_VECTOR, &irq_pit_handler);
+    uint32_t low = io_inb(0x40);
+    uint32_t high = io_inb(0x40);
+    uint32_t count = (high << 8) | low;
 
-    // Unmask IRQ line
-    irq_pic_unmask(IRQ_PIT_INDEX);
+    // The counter keeps decrementing (and wraps) after reaching zero
+    if (count <= _irq_pit_programmed)
+        return _irq_pit_programmed - count;
+    else
+        return _irq_pit_programmed + (0x10000 - count);
 }
 
-/**
- * The interrupt handler for handling PIT timer ticks.
- *
- * @param state The interrupt state.
- */
-void irq_pit_handler(cpu_int_state_t *state) {
-    // Increase ticks
-    ++irq_pit_ticks;
-
-    // Schedule next thread, if current thread's ttl elapsed
-    if (0 == thread_current || --thread_current->ttl == 0) {
-        thread_switch(scheduler_next(), state);
-
-        if (0 != thread_current)
-            thread_current->ttl += THREAD_TTL_GAIN;
-    }
+void irq_pit_delay(uint32_t counts) {
+    irq_pit_oneshot(counts);
 
-    // EOI
-    irq_pic_eoi(IRQ_PIT_INDEX);
+    while (irq_pit_elapsed() < counts)
+        asm volatile ("pause");
 }
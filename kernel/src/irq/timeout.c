@@ -0,0 +1,327 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <timeout.h>
+#include <spinlock.h>
+#include <smp.h>
+#include <irq.h>
+
+//- Timeouts -------------------------------------------------------------------
+
+#define TIMEOUT_SLOT_MASK (TIMEOUT_SLOTS - 1)
+
+// Number of ticks covered by the given level
+#define TIMEOUT_LEVEL_RANGE(level) ((time_t) 1 << (TIMEOUT_SLOT_BITS * ((level) + 1)))
+
+// Number of ticks covered by the whole wheel
+#define TIMEOUT_RANGE TIMEOUT_LEVEL_RANGE(TIMEOUT_LEVELS - 1)
+
+#define NS_PER_SECOND 1000000000ULL
+
+/**
+ * Lock protecting the wheel and the timeouts' states.
+ */
+static spinlock_t _timeout_lock = SPINLOCK_INIT;
+
+/**
+ * The slots of all levels of the wheel.
+ */
+static timeout_t *_timeout_wheel[TIMEOUT_LEVELS][TIMEOUT_SLOTS];
+
+/**
+ * Bitmaps of the slots that contain timeouts, per level.
+ */
+static uint64_t _timeout_occupied[TIMEOUT_LEVELS];
+
+/**
+ * Timeouts that have been armed, but not inserted into the wheel yet.
+ */
+static timeout_t *_timeout_pending = 0;
+
+/**
+ * Timeouts that expired.
+ */
+static timeout_t *_timeout_due = 0;
+
+/**
+ * The tick the wheel has been advanced to.
+ */
+static time_t _timeout_now = 0;
+
+/**
+ * Links the given timeout into the given list.
+ *
+ * @param timeout The timeout to link.
+ * @param list The list to link the timeout into.
+ */
+static void _timeout_link(timeout_t *timeout, timeout_t **list) {
+    timeout->list = list;
+    timeout->prev = 0;
+    timeout->next = *list;
+
+    if (0 != *list)
+        (*list)->prev = timeout;
+
+    *list = timeout;
+}
+
+/**
+ * Unlinks the given timeout from the list it is linked into.
+ *
+ * Clears the slot's bit in the occupancy bitmap, if the list is a wheel slot
+ * that became empty.
+ *
+ * @param timeout The timeout to unlink.
+ */
+static void _timeout_unlink(timeout_t *timeout) {
+    timeout_t **list = timeout->list;
+
+    if (0 != timeout->prev)
+        timeout->prev->next = timeout->next;
+    else
+        *list = timeout->next;
+
+    if (0 != timeout->next)
+        timeout->next->prev = timeout->prev;
+
+    timeout->list = 0;
+    timeout->next = timeout->prev = 0;
+
+    // Wheel slot that became empty?
+    uintptr_t index = list - &_timeout_wheel[0][0];
+
+    if (index < TIMEOUT_LEVELS * TIMEOUT_SLOTS && 0 == *list)
+        _timeout_occupied[index / TIMEOUT_SLOTS] &= ~(1ULL << (index % TIMEOUT_SLOTS));
+}
+
+/**
+ * Inserts the given timeout into the wheel, relative to the wheel's current
+ * tick, or marks it as due if it already expired.
+ *
+ * @param timeout The timeout to insert.
+ */
+static void _timeout_insert(timeout_t *timeout) {
+    // Already expired?
+    if (timeout->expires <= _timeout_now) {
+        timeout->state = TIMEOUT_STATE_DUE;
+        _timeout_link(timeout, &_timeout_due);
+        return;
+    }
+
+    // Find the finest level that covers the timeout
+    time_t delta = timeout->expires - _timeout_now;
+    time_t at = timeout->expires;
+    uint8_t level;
+
+    for (level = 0; level < TIMEOUT_LEVELS - 1; ++level)
+        if (delta < TIMEOUT_LEVEL_RANGE(level))
+            break;
+
+    // Beyond the wheel's range: Put into the last slot, reinserted on cascade
+    if (delta >= TIMEOUT_RANGE)
+        at = _timeout_now + TIMEOUT_RANGE - 1;
+
+    uint32_t slot = (at >> (TIMEOUT_SLOT_BITS * level)) & TIMEOUT_SLOT_MASK;
+
+    timeout->state = TIMEOUT_STATE_ARMED;
+    _timeout_link(timeout, &_timeout_wheel[level][slot]);
+    _timeout_occupied[level] |= (1ULL << slot);
+}
+
+/**
+ * Calculates the tick at which the wheel has to be processed next.
+ *
+ * For the finest level this is when the first occupied slot expires, for the
+ * coarser levels when the first occupied slot is cascaded.
+ *
+ * @return The tick or TIMEOUT_NONE, if the wheel is empty.
+ */
+static time_t _timeout_next_event(void) {
+    time_t next = TIMEOUT_NONE;
+    uint8_t level;
+
+    for (level = 0; level < TIMEOUT_LEVELS; ++level) {
+        uint64_t occupied = _timeout_occupied[level];
+
+        if (0 == occupied)
+            continue;
+
+        // Rotate, so bit 0 is the slot after the current one
+        uint8_t shift = TIMEOUT_SLOT_BITS * level;
+        uint32_t rotate = (((_timeout_now >> shift) & TIMEOUT_SLOT_MASK) + 1) & TIMEOUT_SLOT_MASK;
+
+        if (0 != rotate)
+            occupied = (occupied >> rotate) | (occupied << (64 - rotate));
+
+        time_t distance = __builtin_ctzll(occupied) + 1;
+        time_t tick = ((_timeout_now >> shift) + distance) << shift;
+
+        if (tick < next)
+            next = tick;
+    }
+
+    return next;
+}
+
+/**
+ * Inserts all pending timeouts relative to the given tick.
+ *
+ * @param now The current tick.
+ */
+static void _timeout_insert_pending(time_t now) {
+    while (0 != _timeout_pending) {
+        timeout_t *timeout = _timeout_pending;
+        _timeout_unlink(timeout);
+
+        timeout->expires += now;
+        _timeout_insert(timeout);
+    }
+}
+
+time_t timeout_ticks(uint64_t ns) {
+    // Split to avoid overflows
+    time_t ticks = (ns / NS_PER_SECOND) * IRQ_TIMER_FREQ;
+    uint64_t rest = (ns % NS_PER_SECOND) * IRQ_TIMER_FREQ;
+
+    return ticks + (rest + NS_PER_SECOND - 1) / NS_PER_SECOND;
+}
+
+void timeout_set(timeout_t *timeout, time_t ticks) {
+    spinlock_acquire(&_timeout_lock);
+
+    if (0 != timeout->list)
+        _timeout_unlink(timeout);
+
+    // Inserted by the bootstrap processor once it accounted the elapsed time
+    ++timeout->seq;
+    timeout->expires = ticks;
+    timeout->state = TIMEOUT_STATE_PENDING;
+    _timeout_link(timeout, &_timeout_pending);
+
+    spinlock_release(&_timeout_lock);
+
+    if (0 == smp_cpu()->index)
+        irq_timer_update();
+    else
+        smp_reschedule(smp_cpus[0]);
+}
+
+void timeout_cancel(timeout_t *timeout) {
+    // Only armed while the owner's locks are held, so this cannot change
+    if (TIMEOUT_STATE_IDLE == timeout->state)
+        return;
+
+    spinlock_acquire(&_timeout_lock);
+
+    if (0 != timeout->list)
+        _timeout_unlink(timeout);
+
+    ++timeout->seq;
+    timeout->state = TIMEOUT_STATE_IDLE;
+
+    spinlock_release(&_timeout_lock);
+}
+
+void timeout_advance(time_t now) {
+    spinlock_acquire(&_timeout_lock);
+
+    _timeout_insert_pending(_timeout_now);
+
+    while (true) {
+        time_t next = _timeout_next_event();
+
+        if (TIMEOUT_NONE == next || next > now)
+            break;
+
+        _timeout_now = next;
+
+        // Cascade coarser levels whose current slot changed
+        uint8_t level;
+
+        for (level = TIMEOUT_LEVELS - 1; level > 0; --level) {
+            uint8_t shift = TIMEOUT_SLOT_BITS * level;
+
+            if (0 != (next & (((time_t) 1 << shift) - 1)))
+                continue;
+
+            timeout_t **slot = &_timeout_wheel[level][(next >> shift) & TIMEOUT_SLOT_MASK];
+
+            while (0 != *slot) {
+                timeout_t *timeout = *slot;
+                _timeout_unlink(timeout);
+                _timeout_insert(timeout);
+            }
+        }
+
+        // Expire finest slot
+        timeout_t **slot = &_timeout_wheel[0][next & TIMEOUT_SLOT_MASK];
+
+        while (0 != *slot) {
+            timeout_t *timeout = *slot;
+            _timeout_unlink(timeout);
+
+            timeout->state = TIMEOUT_STATE_DUE;
+            _timeout_link(timeout, &_timeout_due);
+        }
+    }
+
+    if (now > _timeout_now)
+        _timeout_now = now;
+
+    spinlock_release(&_timeout_lock);
+}
+
+time_t timeout_next(time_t now) {
+    spinlock_acquire(&_timeout_lock);
+
+    _timeout_insert_pending(now);
+
+    time_t next = (0 != _timeout_due) ? now : _timeout_next_event();
+
+    spinlock_release(&_timeout_lock);
+    return next;
+}
+
+timeout_t *timeout_pop(uint32_t *seq) {
+    spinlock_acquire(&_timeout_lock);
+
+    timeout_t *timeout = _timeout_due;
+
+    if (0 != timeout) {
+        _timeout_unlink(timeout);
+        timeout->state = TIMEOUT_STATE_FIRING;
+        *seq = timeout->seq;
+    }
+
+    spinlock_release(&_timeout_lock);
+    return timeout;
+}
+
+bool timeout_fire(timeout_t *timeout, uint32_t seq) {
+    spinlock_acquire(&_timeout_lock);
+
+    bool fire = (TIMEOUT_STATE_FIRING == timeout->state && seq == timeout->seq);
+
+    if (fire)
+        timeout->state = TIMEOUT_STATE_IDLE;
+
+    spinlock_release(&_timeout_lock);
+    return fire;
+}
@@ -0,0 +1,263 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <irq.h>
+#include <cpu.h>
+#include <debug.h>
+#include <multitasking.h>
+#include <smp.h>
+#include <timeout.h>
+#include <kdata.h>
+#include <syscall.h>
+
+//- Timer ----------------------------------------------------------------------
+
+/**
+ * The number of ticks since the system was started.
+ *
+ * Advanced by the bootstrap processor by the number of elapsed ticks every
+ * time its timer fires or is reprogrammed.
+ */
+time_t irq_timer_ticks = 0;
+
+/**
+ * Whether the LAPIC timer is used instead of the PIT.
+ */
+static bool _irq_timer_lapic = false;
+
+/**
+ * The number of timer counts per tick.
+ */
+static uint32_t _irq_timer_tick_counts = IRQ_PIT_TICK_COUNTS;
+
+/**
+ * Programs the timer to fire once after the given number of counts.
+ *
+ * @param counts The number of timer counts until the interrupt.
+ */
+static void _irq_timer_oneshot(uint64_t counts) {
+    if (_irq_timer_lapic) {
+        if (counts < IRQ_LAPIC_ONESHOT_MIN)
+            counts = IRQ_LAPIC_ONESHOT_MIN;
+        else if (counts > IRQ_LAPIC_ONESHOT_MAX)
+            counts = IRQ_LAPIC_ONESHOT_MAX;
+
+        irq_lapic_timer_oneshot((uint32_t) counts);
+
+    } else {
+        if (counts > IRQ_PIT_ONESHOT_MAX)
+            counts = IRQ_PIT_ONESHOT_MAX;
+
+        irq_pit_oneshot((uint32_t) counts);
+    }
+}
+
+/**
+ * Accounts the time elapsed since the timer was programmed last.
+ *
+ * @return The number of full ticks that elapsed.
+ */
+static time_t _irq_timer_account(void) {
+    smp_cpu_t *cpu = smp_cpu();
+    uint64_t elapsed = _irq_timer_lapic
+        ? irq_lapic_timer_elapsed()
+        : irq_pit_elapsed();
+
+    // Convert to ticks
+    elapsed += cpu->timer_residual;
+    cpu->timer_residual = elapsed % _irq_timer_tick_counts;
+
+    time_t ticks = elapsed / _irq_timer_tick_counts;
+
+    if (0 == cpu->index && 0 != ticks) {
+        irq_timer_ticks += ticks;
+        kdata_time_update(irq_timer_ticks);
+    }
+
+    return ticks;
+}
+
+/**
+ * Calculates the number of timer counts until the current thread's time
+ * slice ends.
+ *
+ * @return Counts until the end of the time slice.
+ */
+static uint64_t _irq_timer_next_slice(void) {
+    // Idle: Reschedule as soon as there is something to run
+    if (0 == thread_current)
+        return (scheduler_count() > 0) ? 0 : (uint64_t) -1;
+
+    // Only one runnable thread: Nothing to preempt for
+    if (scheduler_count() <= 1)
+        return (uint64_t) -1;
+
+    // End of the current thread's time slice
+    uint64_t counts = (uint64_t) thread_current->ttl * _irq_timer_tick_counts;
+    uint32_t residual = smp_cpu()->timer_residual;
+
+    return (counts > residual) ? counts - residual : 0;
+}
+
+/**
+ * Calculates the number of timer counts until the next timer event.
+ *
+ * On the bootstrap processor this includes the next event of the timeout
+ * wheel.
+ *
+ * @return Counts until the next event.
+ */
+static uint64_t _irq_timer_next_event(void) {
+    uint64_t counts = _irq_timer_next_slice();
+
+    if (0 != smp_cpu()->index)
+        return counts;
+
+    time_t next = timeout_next(irq_timer_ticks);
+
+    if (TIMEOUT_NONE == next)
+        return counts;
+
+    uint64_t wheel = 0;
+    uint32_t residual = smp_cpu()->timer_residual;
+
+    if (next > irq_timer_ticks) {
+        wheel = (next - irq_timer_ticks) * _irq_timer_tick_counts;
+        wheel = (wheel > residual) ? wheel - residual : 0;
+    }
+
+    return (wheel < counts) ? wheel : counts;
+}
+
+/**
+ * Signals an EOI to the controller the timer is connected to.
+ */
+static void _irq_timer_eoi(void) {
+    if (_irq_timer_lapic)
+        irq_lapic_eoi();
+    else
+        irq_eoi(IRQ_PIT_INDEX);
+}
+
+void irq_timer_calibrate(void) {
+    if (irq_lapic_enabled) {
+        // Calibrate LAPIC timer against the PIT
+        uint32_t counts = irq_lapic_timer_calibrate(
+            IRQ_PIT_TICK_COUNTS * IRQ_TIMER_CALIBRATE_TICKS);
+
+        _irq_timer_tick_counts = counts / IRQ_TIMER_CALIBRATE_TICKS;
+        _irq_timer_lapic = (_irq_timer_tick_counts > 0);
+    }
+
+    if (!_irq_timer_lapic)
+        _irq_timer_tick_counts = IRQ_PIT_TICK_COUNTS;
+}
+
+void irq_timer_init(void) {
+    // Program first event
+    smp_cpu()->timer_enabled = true;
+    _irq_timer_oneshot(_irq_timer_next_event());
+
+    // Unmask IRQ line
+    if (!_irq_timer_lapic)
+        irq_unmask(IRQ_PIT_INDEX);
+}
+
+void irq_timer_update(void) {
+    // Not initialized yet?
+    if (UNLIKELY(!smp_cpu()->timer_enabled))
+        return;
+
+    // Account elapsed time and program next event
+    time_t ticks = _irq_timer_account();
+
+    if (0 != thread_current)
+        thread_current->ttl = (thread_current->ttl > ticks)
+            ? thread_current->ttl - ticks
+            : 1;
+
+    _irq_timer_oneshot(_irq_timer_next_event());
+}
+
+bool irq_timer_fast(void) {
+    // Account elapsed ticks
+    time_t ticks = _irq_timer_account();
+
+    // Timeouts due? Expired by irq_timer_handler (might wake threads)
+    bool due = false;
+
+    if (0 == smp_cpu()->index)
+        due = (timeout_next(irq_timer_ticks) <= irq_timer_ticks);
+
+    // Idle? Scheduled by irq_timer_handler
+    if (0 == thread_current)
+        return true;
+
+    // Consume the current thread's time slice (zero if elapsed)
+    thread_current->ttl = (thread_current->ttl > ticks) ? thread_current->ttl - ticks : 0;
+
+    // Time slice elapsed and another thread to run or a ring to poll?
+    bool poll = (0 != process_current->ring);
+
+    if (due || (0 == thread_current->ttl && (scheduler_count() > 1 || poll)))
+        return true;
+
+    // Program next event
+    _irq_timer_oneshot(_irq_timer_next_event());
+
+    // EOI
+    _irq_timer_eoi();
+    return false;
+}
+
+void irq_timer_handler(cpu_int_state_t *state) {
+    // Expire timeouts (might wake threads)
+    if (0 == smp_cpu()->index) {
+        timeout_advance(irq_timer_ticks);
+        thread_timeouts_run();
+    }
+
+    // Schedule next thread, if idle or current thread's time slice elapsed
+    if (0 == thread_current) {
+        thread_switch(scheduler_next(), state);
+
+        if (0 != thread_current)
+            thread_current->ttl = THREAD_TTL_GAIN;
+
+    } else if (0 == thread_current->ttl) {
+        // Interrupted in user mode? Process the submissions to the process's
+        // ring meanwhile
+        bool alive = true;
+
+        if (0 != (state->cs & 3))
+            alive = syscall_ring_poll();
+
+        if (scheduler_count() > 1 || UNLIKELY(!alive))
+            thread_switch(scheduler_next(), state);
+
+        if (0 != thread_current)
+            thread_current->ttl += THREAD_TTL_GAIN;
+    }
+
+    // Program next event
+    _irq_timer_oneshot(_irq_timer_next_event());
+
+    // EOI
+    _irq_timer_eoi();
+}
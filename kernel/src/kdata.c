@@ -0,0 +1,135 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/string.h>
+
+#include <kdata.h>
+#include <cpu.h>
+#include <irq.h>
+#include <memory.h>
+#include <multitasking.h>
+
+//- Kernel Data Pages ----------------------------------------------------------
+
+#define NS_PER_SECOND 1000000000ULL
+
+/**
+ * The time page, as mapped into the kernel (shared by all address spaces).
+ */
+static kdata_time_t *_kdata_time = (kdata_time_t *) MEMORY_KDATA_TIME_VADDR;
+
+/**
+ * The frame of the time page.
+ */
+static uintptr_t _kdata_time_frame = 0;
+
+/**
+ * Checks whether the TSC runs at a constant rate (invariant TSC).
+ *
+ * @return Whether the TSC can be used for timing.
+ */
+static bool _kdata_tsc_invariant(void) {
+    uint32_t regs[4];
+    cpu_cpuid(CPU_CPUID_EXT_MAX, regs);
+
+    if (regs[0] < CPU_CPUID_EXT_POWER)
+        return false;
+
+    cpu_cpuid(CPU_CPUID_EXT_POWER, regs);
+    return (0 != (regs[3] & CPU_CPUID_EXT_POWER_EDX_INVARIANT_TSC));
+}
+
+void kdata_init(void) {
+    // Allocate time page
+    _kdata_time_frame = frame_alloc();
+    memory_map(
+        MEMORY_KDATA_TIME_VADDR, _kdata_time_frame,
+        PAGE_FLAG_WRITEABLE | PAGE_FLAG_GLOBAL);
+    memset(_kdata_time, 0, PAGE_SIZE);
+
+    _kdata_time->tick_ns = NS_PER_SECOND / IRQ_TIMER_FREQ;
+
+    if (!_kdata_tsc_invariant())
+        return;
+
+    // Calibrate TSC against the PIT
+    uint64_t start = cpu_tsc_read();
+    irq_pit_delay(KDATA_TSC_CALIBRATE_COUNTS);
+    uint64_t counts = cpu_tsc_read() - start;
+
+    if (UNLIKELY(0 == counts))
+        return;
+
+    uint64_t ns = (KDATA_TSC_CALIBRATE_COUNTS * NS_PER_SECOND) / IRQ_PIT_BASE_FREQ;
+
+    _kdata_time->tsc_mult = (ns << 32) / counts;
+    _kdata_time->tsc_base = cpu_tsc_read();
+}
+
+void kdata_map(process_t *process, thread_t *thread) {
+    uintptr_t old_addr_space = memory_space_get();
+
+    if (old_addr_space != process->addr_space)
+        memory_space_switch(process->addr_space);
+
+    // Map time and process pages on the process's first thread
+    // (supervisor writes ignore the read-only mappings, as CR0.WP is clear)
+    if ((uintptr_t) -1 == memory_physical(KDATA_TIME_VADDR)) {
+        memory_map(KDATA_TIME_VADDR, _kdata_time_frame, PAGE_FLAG_USER | PAGE_FLAG_SHARED);
+        memory_map(KDATA_PROCESS_VADDR, frame_alloc(), PAGE_FLAG_USER);
+
+        kdata_process_t *info = (kdata_process_t *) KDATA_PROCESS_VADDR;
+        memset(info, 0, PAGE_SIZE);
+
+        info->pid = process->pid;
+        info->parent_pid = (0 != process->parent) ? process->parent->pid : (uint32_t) -1;
+    }
+
+    // Map the page of the thread's slot, if required
+    uintptr_t slot = KDATA_THREADS_VADDR + thread->tid * sizeof(kdata_thread_t);
+    uintptr_t page = slot & ~((uintptr_t) PAGE_SIZE - 1);
+
+    if ((uintptr_t) -1 == memory_physical(page)) {
+        memory_map(page, frame_alloc(), PAGE_FLAG_USER);
+        memset((void *) page, 0, PAGE_SIZE);
+    }
+
+    kdata_thread_t *info = (kdata_thread_t *) slot;
+    info->tid = thread->tid;
+    info->pid = process->pid;
+
+    thread->kdata = slot;
+
+    if (old_addr_space != process->addr_space)
+        memory_space_switch(old_addr_space);
+}
+
+void kdata_time_update(time_t ticks) {
+    _kdata_time->ticks = ticks;
+}
+
+uint64_t kdata_time_ns(void) {
+    if (0 == _kdata_time->tsc_mult)
+        return irq_timer_ticks * _kdata_time->tick_ns;
+
+    uint64_t counts = cpu_tsc_read() - _kdata_time->tsc_base;
+    return (uint64_t) (((unsigned __int128) counts * _kdata_time->tsc_mult) >> 32);
+}
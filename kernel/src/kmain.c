@@ -29,6 +29,10 @@
 #include <syscall.h>
 #include <fault.h>
 #include <fpu.h>
+#include <smp.h>
+#include <kdata.h>
+#include <shm.h>
+#include <ipc.h>
 
 static boot_info_t *info;
 
@@ -77,6 +81,9 @@ static void kmain_header() {
 static void kmain_init() {
     DEBUG("---------------------------------------\n");
 
+    // Per-CPU data (required by locks)
+    smp_init();
+
     // Virtual Memory Management
     DEBUG("Initializing virtual memory management...\n");
     memory_space_initial = memory_space_get();
@@ -88,11 +95,10 @@ static void kmain_init() {
     // Interrupts
     DEBUG("Initializing interrupt management...\n");
 
-    irq_pic_init(); // Initialize PIC (reroutes and masks all IRQs)
+    irq_init(); // Initialize PIC or APICs (reroutes and masks all IRQs)
     cpu_int_init(); // Initializes the IDT to handle interrupts
     cpu_int_enable(); // Enables interrupts
-    cpu_tss_create(); // For UserMode to Kernel interrupts
-    fault_install(); // Install fault handlers
+    smp_cpu_setup(smp_cpu()); // GDT and TSS for UserMode to Kernel interrupts
 
     // FPU
     DEBUG("Initializing floating point unit...\n");
@@ -103,9 +109,21 @@ static void kmain_init() {
     DEBUG("Initializing multitasking...\n");
 
     process_init();
+    shm_init();
+    ipc_queue_init();
 
     // System calls
-    cpu_int_register(SYSCALL_INT_VECTOR, &syscall_handler_int);
+    syscall_init();
+
+    // Application processors
+    DEBUG("Starting application processors...\n");
+
+    irq_timer_calibrate();
+
+    // Kernel data pages (calibrates the TSC against the PIT)
+    kdata_init();
+
+    smp_boot();
 }
 
 static void kmain_root() {
@@ -133,16 +151,17 @@ static void kmain_root() {
     uintptr_t entry_addr = binary_load_elf64((void *) root_mod->mapping, pflags);
 
     DEBUG("Starting thread...\n");
-    thread_thaw(thread_spawn(proc, entry_addr), 0);
+    thread_thaw(thread_spawn(proc, entry_addr, 0), 0);
 
-    // Enable timer
-    // No operations should be performed in this 'thread'
-    // after enabling the timer to prevent concurrency
-    // issues (disabled interrupts while handling an interrupt
-    // acts as a kernel lock).
+    // Enable timer and let the application processors schedule
+    // The boot code is only resumed when the processor idles,
+    // as it is not a thread the scheduler knows about, and then
+    // enters the idle loop.
     DEBUG("Passing control to root process...\n");
     DEBUG("---------------------------------------\n");
-    irq_pit_init();
+    smp_release();
+    irq_timer_init();
+    smp_cpu()->idle = true;
 }
 
 void kmain(void);
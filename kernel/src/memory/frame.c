@@ -87,6 +87,8 @@ void frame_init(boot_info_t *info) {
  * @return Physical address of allocated chunk.
  */
 uintptr_t frame_alloc(void) {
+	spinlock_acquire_recursive(&memory_lock);
+
 	// Out of memory?
 	if (0 == frame_stack_free)
 		PANIC("Out of memory!");
@@ -102,6 +104,7 @@ uintptr_t frame_alloc(void) {
 		(uintptr_t) frame > (uintptr_t) &frame_alloc_init + 0x1000)
 		heap_free(frame);
 
+	spinlock_release_recursive(&memory_lock);
     return address;
 }
 
@@ -111,6 +114,8 @@ uintptr_t frame_alloc(void) {
  * @param addr Physical address of chunk to free.
  */
 void frame_free(uintptr_t addr) {
+	spinlock_acquire_recursive(&memory_lock);
+
 	// Init allocation page?
 	frame_stack_t *frame;
 
@@ -124,4 +129,6 @@ void frame_free(uintptr_t addr) {
 	frame_stack_free = frame;
 
 	frame->address = addr;
+
+	spinlock_release_recursive(&memory_lock);
 }
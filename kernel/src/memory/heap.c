@@ -66,7 +66,7 @@ typedef struct heap_slot_t {
  * heap_free_slot_t structure), and the maximum size is 1 << 12
  * = 0x1000.
  */
-static heap_slot_t *heap_slots[9];
+static heap_slot_t *heap_slots[10];
 
 //- Free Slab Storage ----------------------------------------------------------
 
@@ -175,9 +175,11 @@ static void _heap_alloc_slab(uint8_t slot_idx) {
 
 void *heap_alloc(size_t size) {
 	// Greater than a page?
-	if (size >= 0x1000)
+	if (size > HEAP_ALLOC_MAX)
 		PANIC("Cannot heap_alloc more than one page at once.");
 
+	spinlock_acquire_recursive(&memory_lock);
+
 	// Get slot size
 	size_t slot_idx;
 
@@ -196,11 +198,15 @@ void *heap_alloc(size_t size) {
 	// Clear slot
 	memset((void *) slot, 0, HEAP_SLOT_SIZE(slot_idx));
 
+	spinlock_release_recursive(&memory_lock);
+
 	// Return slot
 	return (void *) slot;
 }
 
 void heap_free(void *ptr) {
+	spinlock_acquire_recursive(&memory_lock);
+
 	// Get addresses
 	uintptr_t region_addr = HEAP_REGION_HEADER((uintptr_t) ptr);
 	uintptr_t slab_offset = HEAP_REGION_OFFSET((uintptr_t) ptr);
@@ -212,4 +218,6 @@ void heap_free(void *ptr) {
 	heap_slot_t *slot = (heap_slot_t *) ptr;
 	slot->next = heap_slots[slab->size_index];
 	heap_slots[slab->size_index] = slot;
+
+	spinlock_release_recursive(&memory_lock);
 }
@@ -20,6 +20,7 @@
 #include <api/string.h>
 
 #include <memory.h>
+#include <smp.h>
 #include <debug.h>
 
 // TODO: Refactor this mess!
@@ -55,6 +56,10 @@
 
 #define PAGE_PHYSICAL(a)            (a & ~0x1FF)
 
+//- Locking --------------------------------------------------------------------
+
+spinlock_t memory_lock = SPINLOCK_INIT;
+
 //- Virtual Memory Management --------------------------------------------------
 
 #define PAGE_FLAGS_RECURSIVE PAGE_FLAG_PRESENT | PAGE_FLAG_WRITEABLE
@@ -198,18 +203,30 @@ static bool _memory_page_exists(uintptr_t virt, bool create)
 
 void memory_map(uint64_t virt, uint64_t phys, uint16_t flags)
 {
+    spinlock_acquire_recursive(&memory_lock);
+
     // Create the page (if it does not already exist)
 	_memory_page_exists(virt, true);
     
     // Map page
-    _memory_map((uint64_t *) PAGE_VIRT_PAGE(virt), phys, flags);
+    uint64_t *page = (uint64_t *) PAGE_VIRT_PAGE(virt);
+    bool remap = (0 != (*page & PAGE_FLAG_PRESENT));
+
+    _memory_map(page, phys, flags);
     
-    // Invalidate TLB entry
+    // Invalidate TLB entry (on other processors as well, if replaced)
     _memory_invalidate(virt);
+
+    if (remap)
+        smp_tlb_shootdown(virt);
+
+    spinlock_release_recursive(&memory_lock);
 }
 
 void memory_unmap(uint64_t virt)
 {
+    spinlock_acquire_recursive(&memory_lock);
+
     // Check if the page exists
     if (_memory_page_exists(virt, false)) {
         // Remove present flag
@@ -217,7 +234,10 @@ void memory_unmap(uint64_t virt)
 	
 		// Invalidate TLB
 		_memory_invalidate(virt);
+		smp_tlb_shootdown(virt);
     }
+
+    spinlock_release_recursive(&memory_lock);
 }
 
 uint64_t memory_physical(uint64_t virt)
@@ -277,6 +297,16 @@ bool memory_user_accessible(uint64_t virt) {
     return ((*pte & PAGE_FLAG_USER) != 0);
 }
 
+bool memory_user_writeable(uint64_t virt) {
+    // Structures are created writeable, so only the page's flag matters
+    if (!memory_user_accessible(virt))
+        return false;
+
+    virt &= ~0xFFF;
+    uint64_t *pte = (uint64_t *) PAGE_VIRT_PAGE(virt);
+    return ((*pte & PAGE_FLAG_WRITEABLE) != 0);
+}
+
 bool memory_region_accessible(uint64_t virtual_addr, uint64_t length) {
     uint64_t ptr = memalign(virtual_addr, 0x1000);
 
@@ -361,6 +391,8 @@ static void _memory_struct_dispose(
 }
 
 uint64_t memory_struct_remove(uint64_t virtual_addr, uint8_t struct_idx) {
+	spinlock_acquire_recursive(&memory_lock);
+
 	// Get parent
 	uint64_t *parent = _memory_struct_parent(virtual_addr, struct_idx);
 
@@ -369,6 +401,12 @@ uint64_t memory_struct_remove(uint64_t virtual_addr, uint8_t struct_idx) {
 
 	// Remove structure
 	*parent = 0;
+
+	// Flush TLBs
+	memory_space_switch(memory_space_get());
+	smp_tlb_shootdown(SMP_TLB_FLUSH_ALL);
+
+	spinlock_release_recursive(&memory_lock);
 	return struct_ptr;
 }
 
@@ -376,6 +414,8 @@ void memory_struct_insert(
 		uint64_t virtual_addr,
 		uint8_t struct_idx,
 		uint64_t struct_ptr) {
+	spinlock_acquire_recursive(&memory_lock);
+
 	// Make sure parent structure exists
 	_memory_struct_exists(
 			PAGE_PML4E_INDEX(virtual_addr),
@@ -386,9 +426,10 @@ void memory_struct_insert(
 
 	// Get parent
 	uint64_t *parent = _memory_struct_parent(virtual_addr, struct_idx);
+	bool replaced = (0 != (*parent & PAGE_FLAG_PRESENT));
 
 	// Dispose previous structure
-	if (0 != (*parent & PAGE_FLAG_PRESENT))
+	if (replaced)
 		_memory_struct_dispose(
 				PAGE_PML4E_INDEX(virtual_addr),
 				PAGE_PDPE_INDEX(virtual_addr),
@@ -397,6 +438,14 @@ void memory_struct_insert(
 
 	// Set structure
 	*parent = PAGE_PHYSICAL(struct_ptr) | PAGE_FLAG_USER | PAGE_FLAG_PRESENT;
+
+	// Flush TLBs, if stale entries may exist
+	if (replaced) {
+		memory_space_switch(memory_space_get());
+		smp_tlb_shootdown(SMP_TLB_FLUSH_ALL);
+	}
+
+	spinlock_release_recursive(&memory_lock);
 }
 
 //- Address Spaces -------------------------------------------------------------
@@ -404,6 +453,8 @@ void memory_struct_insert(
 uintptr_t memory_space_initial = 0;
 
 uintptr_t memory_space_create() {
+    spinlock_acquire_recursive(&memory_lock);
+
     // Allocate frame for PML4
     uintptr_t pml4_phys = frame_alloc();
 
@@ -426,63 +477,195 @@ uintptr_t memory_space_create() {
     // Unmap helper page
     memory_unmap(MEMORY_SPACE_HELPER_VADDR);
 
+    spinlock_release_recursive(&memory_lock);
     return pml4_phys;
 }
 
-void memory_space_dispose() {
-    // Is initial PML4?
-    if (memory_space_get() == memory_space_initial)
-	PANIC("Failed trying to dipose initial address space.");
+/**
+ * An address space that has been released and waits for disposal.
+ */
+typedef struct memory_space_released_t {
+    uintptr_t space;
+    struct memory_space_released_t *next;
+} memory_space_released_t;
+
+/**
+ * Lock protecting the list of released address spaces.
+ */
+static spinlock_t _memory_space_released_lock = SPINLOCK_INIT;
+
+/**
+ * Address spaces that wait for disposal.
+ */
+static memory_space_released_t *_memory_space_released = 0;
+
+/**
+ * Adds the given node to the list of released address spaces.
+ *
+ * @param node The node to add.
+ */
+static void _memory_space_released_push(memory_space_released_t *node) {
+    spinlock_acquire(&_memory_space_released_lock);
+    node->next = _memory_space_released;
+    _memory_space_released = node;
+    spinlock_release(&_memory_space_released_lock);
+}
+
+/**
+ * Removes a node from the list of released address spaces.
+ *
+ * @return The node or a null pointer, if the list is empty.
+ */
+static memory_space_released_t *_memory_space_released_pop(void) {
+    spinlock_acquire(&_memory_space_released_lock);
+    memory_space_released_t *node = _memory_space_released;
+
+    if (0 != node)
+        _memory_space_released = node->next;
+
+    spinlock_release(&_memory_space_released_lock);
+    return node;
+}
+
+/**
+ * Checks whether another processor still uses the given address space and
+ * asks those processors to leave it.
+ *
+ * @param space The address space to check.
+ * @return Whether the address space is in use.
+ */
+static bool _memory_space_loaded(uintptr_t space) {
+    smp_cpu_t *self = smp_cpu();
+    bool loaded = false;
+    size_t i;
 
-    // Dispose structures (except the kernel and recursive ones)
-    uintptr_t pml4 = memory_space_get();
+    // Pairs with the announcement in thread_switch
+    __sync_synchronize();
+
+    for (i = 0; i < smp_cpu_count; ++i) {
+        smp_cpu_t *cpu = smp_cpus[i];
+
+        if (cpu == self || cpu->addr_space != space)
+            continue;
+
+        cpu->space_leave = true;
+        smp_reschedule(cpu);
+        loaded = true;
+    }
+
+    return loaded;
+}
+
+/**
+ * Lets pending interrupts preempt the idle loop, e.g. to run a thread.
+ */
+static void _memory_space_preempt(void) {
+    cpu_int_enable();
+    cpu_int_disable();
+}
+
+/**
+ * Frees the page structures of the current address space (except the kernel
+ * and recursive ones) and all frames mapped in it, except for shared ones
+ * (see PAGE_FLAG_SHARED).
+ *
+ * Preemptible after each page table.
+ */
+static void _memory_space_free_structs(void) {
     size_t pml4e, pdpe, pde, pte;
     uint64_t *page;
-    
-    for (pml4e = 0; pml4e < 512; ++pml4e) {
-        // Kernel or recursive?
-        if (pml4e >= 510)
-            break;
-        
-        // Children
+
+    for (pml4e = 0; pml4e < 510; ++pml4e) {
+        uint64_t *pml4e_ptr = (uint64_t *) PAGE_VIRT_PML4E(pml4e);
+
+        if (0 == (*pml4e_ptr & PAGE_FLAG_PRESENT))
+            continue;
+
         for (pdpe = 0; pdpe < 512; ++pdpe) {
-            // Children
+            uint64_t *pdpe_ptr = (uint64_t *) PAGE_VIRT_PDPE(pml4e, pdpe);
+
+            if (0 == (*pdpe_ptr & PAGE_FLAG_PRESENT))
+                continue;
+
             for (pde = 0; pde < 512; ++pde) {
-                // Children
+                uint64_t *pde_ptr = (uint64_t *) PAGE_VIRT_PDE(pml4e, pdpe, pde);
+
+                if (0 == (*pde_ptr & PAGE_FLAG_PRESENT))
+                    continue;
+
+                // Free frames
                 for (pte = 0; pte < 512; ++pte) {
-                    // Get PTE
                     page = (uint64_t *) PAGE_VIRT_PTE(pml4e, pdpe, pde, pte);
-                
-                    // Free frame
-                    // Makes the assumption that all frames belonged to the
-                    // disposed address space
-                    frame_free(PAGE_PHYSICAL(*page));
+
+                    if (0 != (*page & PAGE_FLAG_PRESENT) &&
+                        0 == (*page & PAGE_FLAG_SHARED))
+                        frame_free(PAGE_PHYSICAL(*page));
                 }
-                
-                // Get PDE
-                page = (uint64_t *) PAGE_VIRT_PDE(pml4e, pdpe, pde);
-                
-                // Free frame
-                frame_free(PAGE_PHYSICAL(*page));
+
+                // Free PT
+                frame_free(PAGE_PHYSICAL(*pde_ptr));
+                *pde_ptr = 0;
+
+                _memory_space_preempt();
             }
-            
-            // Get PDPE
-            page = (uint64_t *) PAGE_VIRT_PDPE(pml4e, pdpe);
-            
-            // Free frame
-            frame_free(PAGE_PHYSICAL(*page));
+
+            // Free PD
+            frame_free(PAGE_PHYSICAL(*pdpe_ptr));
+            *pdpe_ptr = 0;
         }
-        
-        // Get PML4E
-        page = (uint64_t *) PAGE_VIRT_PML4E(pml4e);
-        
-        // Free frame
-        frame_free(PAGE_PHYSICAL(*page));
+
+        // Free PDP
+        frame_free(PAGE_PHYSICAL(*pml4e_ptr));
+        *pml4e_ptr = 0;
     }
+}
+
+void memory_space_release(uintptr_t space) {
+    // Is initial PML4?
+    if (UNLIKELY(space == memory_space_initial))
+        PANIC("Failed trying to release initial address space.");
+
+    memory_space_released_t *node = (memory_space_released_t *) heap_alloc(
+        sizeof(memory_space_released_t));
+    node->space = space;
 
-    // Switch to initial space
-    memory_space_switch(memory_space_initial);
+    _memory_space_released_push(node);
+}
 
-    // Free PML4
-    frame_free(pml4);
+void memory_space_reap(void) {
+    smp_cpu_t *cpu = smp_cpu();
+    memory_space_released_t *deferred = 0;
+    memory_space_released_t *node;
+
+    while (0 != (node = _memory_space_released_pop())) {
+        uintptr_t space = node->space;
+
+        // Still in use? Retried when idling the next time
+        if (_memory_space_loaded(space)) {
+            node->next = deferred;
+            deferred = node;
+            continue;
+        }
+
+        heap_free(node);
+
+        // Dispose structures (switched back to when preempted, see thread.c)
+        cpu->idle_space = space;
+        memory_space_switch(space);
+
+        _memory_space_free_structs();
+
+        // Switch to initial space and free PML4
+        memory_space_switch(memory_space_initial);
+        cpu->idle_space = 0;
+
+        frame_free(space);
+    }
+
+    // Requeue address spaces that are still in use
+    while (0 != deferred) {
+        node = deferred;
+        deferred = deferred->next;
+        _memory_space_released_push(node);
+    }
 }
@@ -0,0 +1,217 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <multitasking.h>
+#include <memory.h>
+
+//- Futex Wait Queues ----------------------------------------------------------
+
+/**
+ * Returns the wait queue of the futex at the given address.
+ */
+static futex_waiter_t **_futex_queue(process_t *process, uintptr_t futex) {
+    // Fibonacci hashing of the 32 bit aligned address
+    uint64_t hash = (futex >> 2) * 0x9E3779B97F4A7C15ULL;
+    return &process->futex_queues[hash >> (64 - FUTEX_QUEUE_BITS)];
+}
+
+static void _futex_link(futex_waiter_t *waiter, futex_waiter_t **queue) {
+    waiter->prev = 0;
+    waiter->next = *queue;
+
+    if (0 != *queue)
+        (*queue)->prev = waiter;
+
+    *queue = waiter;
+}
+
+static void _futex_unlink(futex_waiter_t *waiter, futex_waiter_t **queue) {
+    if (0 != waiter->prev)
+        waiter->prev->next = waiter->next;
+    else
+        *queue = waiter->next;
+
+    if (0 != waiter->next)
+        waiter->next->prev = waiter->prev;
+
+    waiter->next = waiter->prev = 0;
+}
+
+/**
+ * Returns whether the given entry waits on the futex and is woken by
+ * futex_wake and the like, as opposed to priority inheritance futexes, whose
+ * waiters are only woken by futex_wake_pi.
+ */
+static bool _futex_waits(futex_waiter_t *waiter, uintptr_t futex) {
+    return futex == waiter->futex &&
+        THREAD_SLEEP_FUTEX_PI != waiter->thread->sleep_mode;
+}
+
+void futex_enqueue(process_t *process, thread_t *thread, futex_waiter_t *waiters, uint32_t count) {
+    thread->futex_waiters = waiters;
+    thread->futex_waiter_count = count;
+
+    uint32_t i;
+    for (i = 0; i < count; ++i) {
+        waiters[i].thread = thread;
+        _futex_link(&waiters[i], _futex_queue(process, waiters[i].futex));
+    }
+}
+
+void futex_dequeue(process_t *process, thread_t *thread) {
+    futex_waiter_t *waiters = thread->futex_waiters;
+    uint32_t count = thread->futex_waiter_count;
+
+    uint32_t i;
+    for (i = 0; i < count; ++i)
+        _futex_unlink(&waiters[i], _futex_queue(process, waiters[i].futex));
+
+    if (0 != waiters && waiters != &thread->futex_waiter)
+        heap_free(waiters);
+
+    thread->futex_waiters = 0;
+    thread->futex_waiter_count = 0;
+}
+
+/**
+ * Ends the wait of the thread of the given entry, without thawing it.
+ *
+ * @param process The process hosting the thread.
+ * @param waiter The entry of the futex the thread is woken by.
+ */
+static void _futex_release(process_t *process, futex_waiter_t *waiter) {
+    thread_t *thread = waiter->thread;
+
+    // Report the futex the thread has been woken by
+    if (THREAD_SLEEP_FUTEX_VEC == thread->sleep_mode)
+        thread->state->state.rax = waiter->index;
+
+    futex_dequeue(process, thread);
+    thread->sleep_mode = 0;
+}
+
+uint32_t futex_wake(process_t *process, uintptr_t futex, uint32_t count) {
+    futex_waiter_t *waiter = *_futex_queue(process, futex);
+    uint32_t woken = 0;
+
+    while (0 != waiter && woken < count) {
+        futex_waiter_t *next = waiter->next;
+        thread_t *thread = waiter->thread;
+
+        if (_futex_waits(waiter, futex)) {
+            // Skip the thread's other entries, that are unlinked with it
+            while (0 != next && thread == next->thread)
+                next = next->next;
+
+            _futex_release(process, waiter);
+            thread_thaw(thread, 0);
+            ++woken;
+        }
+
+        waiter = next;
+    }
+
+    return woken;
+}
+
+thread_t *futex_wake_one(process_t *process, uintptr_t futex) {
+    futex_waiter_t *waiter = *_futex_queue(process, futex);
+
+    while (0 != waiter && !_futex_waits(waiter, futex))
+        waiter = waiter->next;
+
+    if (0 == waiter)
+        return 0;
+
+    thread_t *thread = waiter->thread;
+    _futex_release(process, waiter);
+
+    // Keep other processors from running the thread before it is switched to
+    thread_claim(thread);
+    thread_thaw(thread, 0);
+
+    return thread;
+}
+
+uint32_t futex_requeue(process_t *process, uintptr_t futex, uintptr_t target, uint32_t count) {
+    futex_waiter_t **queue = _futex_queue(process, futex);
+    futex_waiter_t **target_queue = _futex_queue(process, target);
+    futex_waiter_t *waiter = *queue;
+    uint32_t moved = 0;
+
+    // Nothing to move within the same queue
+    if (queue == target_queue) {
+        for (; 0 != waiter && moved < count; waiter = waiter->next) {
+            if (_futex_waits(waiter, futex)) {
+                waiter->futex = target;
+                ++moved;
+            }
+        }
+
+        return moved;
+    }
+
+    while (0 != waiter && moved < count) {
+        futex_waiter_t *next = waiter->next;
+
+        if (_futex_waits(waiter, futex)) {
+            _futex_unlink(waiter, queue);
+            waiter->futex = target;
+            _futex_link(waiter, target_queue);
+            ++moved;
+        }
+
+        waiter = next;
+    }
+
+    return moved;
+}
+
+thread_t *futex_wake_pi(process_t *process, uintptr_t futex, bool *others) {
+    futex_waiter_t *waiter = *_futex_queue(process, futex);
+    futex_waiter_t *oldest = 0;
+
+    *others = false;
+
+    // Entries are linked at the head, so the last one has waited the longest
+    for (; 0 != waiter; waiter = waiter->next) {
+        thread_t *thread = waiter->thread;
+
+        if (futex != waiter->futex || THREAD_SLEEP_FUTEX_PI != thread->sleep_mode)
+            continue;
+
+        // Killed, but not joined yet?
+        if (UNLIKELY(0 != (thread->flags & THREAD_FLAG_TERMINATED)))
+            continue;
+
+        if (0 != oldest)
+            *others = true;
+
+        oldest = waiter;
+    }
+
+    if (0 == oldest)
+        return 0;
+
+    thread_t *thread = oldest->thread;
+    _futex_release(process, oldest);
+
+    return thread;
+}
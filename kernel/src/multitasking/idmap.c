@@ -0,0 +1,121 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/string.h>
+#include <api/compiler.h>
+#include <idmap.h>
+#include <memory.h>
+
+//- Id Maps --------------------------------------------------------------------
+
+#define IDMAP_CHUNK(id) ((id) >> IDMAP_CHUNK_BITS)
+#define IDMAP_INDEX(id) ((id) & (IDMAP_CHUNK_SIZE - 1))
+
+void idmap_init(idmap_t *map, uint32_t limit) {
+    memset(map, 0, sizeof(idmap_t));
+    map->limit = (limit > IDMAP_MAX) ? IDMAP_MAX : limit;
+}
+
+void idmap_dispose(idmap_t *map) {
+    size_t chunk;
+
+    for (chunk = 0; chunk < IDMAP_CHUNKS; ++chunk)
+        if (0 != map->chunks[chunk])
+            heap_free(map->chunks[chunk]);
+
+    memset(map, 0, sizeof(idmap_t));
+}
+
+uint32_t idmap_alloc(idmap_t *map, void *entry) {
+    // Find first chunk with a free id
+    uint32_t chunk = IDMAP_CHUNKS;
+    size_t word;
+
+    for (word = 0; word < IDMAP_CHUNKS / 64; ++word) {
+        if (~0ULL != map->full[word]) {
+            chunk = word * 64 + __builtin_ctzll(~map->full[word]);
+            break;
+        }
+    }
+
+    if (UNLIKELY(chunk * IDMAP_CHUNK_SIZE >= map->limit))
+        return IDMAP_NONE;
+
+    // Allocate chunk on first use
+    idmap_chunk_t *data = map->chunks[chunk];
+
+    if (0 == data) {
+        data = (idmap_chunk_t *) heap_alloc(sizeof(idmap_chunk_t));
+        memset(data, 0, sizeof(idmap_chunk_t));
+        map->chunks[chunk] = data;
+    }
+
+    // Find first free id in chunk
+    for (word = 0; ~0ULL == data->used[word]; ++word);
+
+    uint32_t index = word * 64 + __builtin_ctzll(~data->used[word]);
+    uint32_t id = chunk * IDMAP_CHUNK_SIZE + index;
+
+    if (UNLIKELY(id >= map->limit))
+        return IDMAP_NONE;
+
+    // Mark as used
+    data->used[word] |= (1ULL << (index % 64));
+    data->entries[index] = entry;
+
+    if (IDMAP_CHUNK_SIZE == ++data->count)
+        map->full[chunk / 64] |= (1ULL << (chunk % 64));
+
+    return id;
+}
+
+void idmap_free(idmap_t *map, uint32_t id) {
+    if (UNLIKELY(id >= map->limit))
+        return;
+
+    uint32_t chunk = IDMAP_CHUNK(id);
+    uint32_t index = IDMAP_INDEX(id);
+    idmap_chunk_t *data = map->chunks[chunk];
+
+    // Not in use?
+    if (0 == data || 0 == (data->used[index / 64] & (1ULL << (index % 64))))
+        return;
+
+    data->used[index / 64] &= ~(1ULL << (index % 64));
+    data->entries[index] = 0;
+    map->full[chunk / 64] &= ~(1ULL << (chunk % 64));
+
+    // Free empty chunks (the first one is kept, as it is used the most)
+    if (0 == --data->count && 0 != chunk) {
+        heap_free(data);
+        map->chunks[chunk] = 0;
+    }
+}
+
+void *idmap_get(idmap_t *map, uint32_t id) {
+    if (UNLIKELY(id >= map->limit))
+        return 0;
+
+    idmap_chunk_t *data = map->chunks[IDMAP_CHUNK(id)];
+
+    if (0 == data)
+        return 0;
+
+    return data->entries[IDMAP_INDEX(id)];
+}
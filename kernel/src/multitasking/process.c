@@ -22,60 +22,23 @@
 #include <multitasking.h>
 #include <memory.h>
 #include <debug.h>
+#include <pager.h>
+#include <shm.h>
+#include <ipc.h>
 
 //- Processes ------------------------------------------------------------------
 
-static process_t **process_map = (process_t **) MEMORY_PROCESS_MAP_VADDR;
-process_t *process_list = 0;
-
-static uint32_t _process_id_next(void) {
-    // Search for first free id
-    uint32_t id;
-
-    for (id = 0; id < PROCESS_MAX; ++id)
-        if (0 == process_map[id])
-            return id;
-
-    PANIC("Maximum number of processes reached.");
-    return -1;
-}
-
-static void _process_create_thread_map(uint32_t pid) {
-    // Map thread map
-    uintptr_t thread_map = MEMORY_THREAD_MAP_VADDR + pid * THREAD_MAP_SIZE;
-    uint16_t pflags = PAGE_FLAG_WRITEABLE | PAGE_FLAG_GLOBAL;
-    size_t offset;
-
-    for (offset = 0; offset < THREAD_MAP_SIZE; offset += 0x1000)
-        memory_map(thread_map + offset, frame_alloc(), pflags);
-
-    // Clear thread map
-    memset((void *) thread_map, 0, THREAD_MAP_SIZE);
-}
+/**
+ * Maps process ids to processes.
+ */
+static idmap_t _process_map;
 
-static void _process_dispose_thread_map(uint32_t pid) {
-    // Unmap thread map
-    uintptr_t thread_map = MEMORY_THREAD_MAP_VADDR + pid * THREAD_MAP_SIZE;
-    size_t offset = 0;
+process_t *process_list = 0;
 
-    for (offset = 0; offset < THREAD_MAP_SIZE; offset += 0x1000) {
-        uintptr_t phys = memory_physical(thread_map + offset);
-        memory_unmap(thread_map + offset);
-        frame_free(phys);
-    }
-}
+rwlock_t process_table_lock = RWLOCK_INIT;
 
 void process_init(void) {
-    // Map the thread map
-    uintptr_t vaddr = MEMORY_PROCESS_MAP_VADDR;
-    uint16_t pflags = PAGE_FLAG_GLOBAL | PAGE_FLAG_WRITEABLE;
-    uintptr_t offset;
-
-    for (offset = 0; offset < PROCESS_MAP_SIZE; offset += 0x1000)
-        memory_map(vaddr + offset, frame_alloc(), pflags);
-
-    // Clear the thread map
-    memset((void *) vaddr, 0, PROCESS_MAP_SIZE);
+    idmap_init(&_process_map, PROCESS_MAX);
 }
 
 process_t *process_spawn(uintptr_t addr_space, process_t *parent) {
@@ -83,18 +46,22 @@ process_t *process_spawn(uintptr_t addr_space, process_t *parent) {
     process_t *proc = (process_t *) heap_alloc(sizeof(process_t));
     memset(proc, 0, sizeof(process_t));
 
+    // Allocate id and link in map
+    proc->pid = idmap_alloc(&_process_map, proc);
+
+    if (UNLIKELY(IDMAP_NONE == proc->pid)) {
+        heap_free(proc);
+        return 0;
+    }
+
     // Fill structure
-    proc->pid = _process_id_next();
     proc->threads = 0;
     proc->addr_space = addr_space;
     proc->stack_offset = 0;
     proc->parent = parent;
 
     // Create thread map
-    _process_create_thread_map(proc->pid);
-
-    // Link in map
-    process_map[proc->pid] = proc;
+    idmap_init(&proc->thread_map, THREAD_MAX);
 
     // Set order (if the process has a parent, zero otherwise)
     if (LIKELY(0 != parent))
@@ -108,10 +75,7 @@ process_t *process_spawn(uintptr_t addr_space, process_t *parent) {
 }
 
 process_t *process_get(uint32_t pid) {
-    if (pid >= PROCESS_MAX)
-        return 0;
-
-    return process_map[pid];
+    return (process_t *) idmap_get(&_process_map, pid);
 }
 
 void process_terminate(uint32_t pid) {
@@ -139,14 +103,58 @@ void process_terminate(uint32_t pid) {
         proc_prev->next = proc->next;
 
     // Remove from map
-    process_map[pid] = 0;
+    idmap_free(&_process_map, pid);
 
-    // Stop and free all threads
+    // Stop and free all threads (their memory goes with the address space)
+    proc->terminating = true;
     thread_dispose_all(proc);
 
-    // Dispose thread map
-    _process_dispose_thread_map(pid);
+    // Dispose thread map and released stack slots
+    idmap_dispose(&proc->thread_map);
+    stack_slots_dispose(proc);
+    pager_dispose(proc);
+    shm_dispose(proc);
+    ipc_queue_dispose(proc);
+
+    // Dispose address space in the background
+    memory_space_release(proc->addr_space);
 
     // Free process structure
     heap_free(proc);
 }
+
+process_t *process_lock_current(bool exclusive) {
+    // Lock process table
+    if (exclusive)
+        rwlock_write_acquire(&process_table_lock);
+    else
+        rwlock_read_acquire(&process_table_lock);
+
+    // Current thread terminated by another processor meanwhile?
+    process_t *proc = process_get(thread_current->pid);
+
+    if (UNLIKELY(0 == proc || 0 != (thread_current->flags & THREAD_FLAG_TERMINATED))) {
+        if (exclusive)
+            rwlock_write_release(&process_table_lock);
+        else
+            rwlock_read_release(&process_table_lock);
+
+        return 0;
+    }
+
+    // Lock process (a writer has exclusive access anyway)
+    if (!exclusive)
+        spinlock_acquire(&proc->lock);
+
+    return proc;
+}
+
+void process_unlock_current(process_t *proc, bool exclusive) {
+    if (exclusive) {
+        rwlock_write_release(&process_table_lock);
+
+    } else {
+        spinlock_release(&proc->lock);
+        rwlock_read_release(&process_table_lock);
+    }
+}
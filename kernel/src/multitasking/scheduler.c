@@ -18,79 +18,338 @@
 
 #include <api/types.h>
 #include <multitasking.h>
+#include <memory.h>
 #include <debug.h>
+#include <irq.h>
+#include <smp.h>
 
 //- Scheduler ------------------------------------------------------------------
 
-static thread_t *scheduler_threads_first = 0;
-static thread_t *scheduler_threads_last = 0;
+/**
+ * Locks the run queue the given thread is in.
+ *
+ * Retries until the thread has not been migrated meanwhile.
+ *
+ * @param thread The thread whose run queue to lock.
+ * @return The processor owning the locked run queue.
+ */
+static smp_cpu_t *_scheduler_lock_thread(thread_t *thread) {
+    while (true) {
+        smp_cpu_t *cpu = smp_cpus[thread->cpu];
+        spinlock_acquire(&cpu->sched_lock);
+
+        if (LIKELY(cpu->index == thread->cpu))
+            return cpu;
+
+        spinlock_release(&cpu->sched_lock);
+    }
+}
+
+/**
+ * Unlinks the given thread from the locked run queue of the given processor.
+ *
+ * @param cpu The processor whose run queue to remove the thread from.
+ * @param thread The thread to remove.
+ * @return Whether the thread has been in the run queue.
+ */
+static bool _scheduler_unlink(smp_cpu_t *cpu, thread_t *thread) {
+    thread_t *thread_cur = cpu->sched_first;
+    thread_t *thread_prev = 0;
+
+    while (0 != thread_cur && thread != thread_cur) {
+        thread_prev = thread_cur;
+        thread_cur = thread_cur->next_sched;
+    }
+
+    if (0 == thread_cur)
+        return false;
+
+    // First?
+    if (0 == thread_prev)
+        cpu->sched_first = thread->next_sched;
+    else
+        thread_prev->next_sched = thread->next_sched;
+
+    // Last?
+    if (0 == thread->next_sched)
+        cpu->sched_last = thread_prev;
+
+    thread->next_sched = 0;
+    --cpu->sched_count;
+    return true;
+}
+
+/**
+ * Appends the given thread to the locked run queue of the given processor.
+ *
+ * @param cpu The processor whose run queue to append the thread to.
+ * @param thread The thread to append.
+ */
+static void _scheduler_append(smp_cpu_t *cpu, thread_t *thread) {
+    thread->next_sched = 0;
+    thread->cpu = cpu->index;
+
+    if (0 == cpu->sched_last)
+        cpu->sched_first = thread;
+    else
+        cpu->sched_last->next_sched = thread;
+
+    cpu->sched_last = thread;
+    ++cpu->sched_count;
+}
+
+/**
+ * Chooses the processor to queue a recently thawed thread on.
+ *
+ * Prefers the processor the thread has run on last (if idle), then any idle
+ * processor and the current processor otherwise.
+ *
+ * @param thread The thread to queue.
+ * @return The processor to queue the thread on.
+ */
+static smp_cpu_t *_scheduler_target(thread_t *thread) {
+    smp_cpu_t *self = smp_cpu();
+    smp_cpu_t *last = smp_cpus[thread->cpu];
+
+    if (last->idle || self->idle)
+        return last->idle ? last : self;
+
+    size_t i;
+    for (i = 0; i < smp_cpu_count; ++i)
+        if (smp_cpus[i]->online && smp_cpus[i]->idle)
+            return smp_cpus[i];
+
+    return self;
+}
+
+/**
+ * Locks the run queues of the two given processors in index order.
+ *
+ * @param a One processor.
+ * @param b The other processor.
+ */
+static void _scheduler_lock_pair(smp_cpu_t *a, smp_cpu_t *b) {
+    if (a->index < b->index) {
+        spinlock_acquire(&a->sched_lock);
+        spinlock_acquire(&b->sched_lock);
+
+    } else {
+        spinlock_acquire(&b->sched_lock);
+        spinlock_acquire(&a->sched_lock);
+    }
+}
+
+/**
+ * Steals a thread that is not running from another processor's run queue.
+ *
+ * @param self The current processor.
+ * @return The stolen and claimed thread or a null pointer, if there is none.
+ */
+static thread_t *_scheduler_steal(smp_cpu_t *self) {
+    size_t offset;
+
+    for (offset = 1; offset < smp_cpu_count; ++offset) {
+        smp_cpu_t *victim = smp_cpus[(self->index + offset) % smp_cpu_count];
+
+        // Anything but the running thread?
+        if (victim->sched_count < 2 && !(victim->idle && victim->sched_count > 0))
+            continue;
+
+        _scheduler_lock_pair(self, victim);
+
+        thread_t *thread = victim->sched_first;
+
+        while (0 != thread && !thread_claim(thread))
+            thread = thread->next_sched;
+
+        // Migrate
+        if (0 != thread) {
+            _scheduler_unlink(victim, thread);
+            _scheduler_append(self, thread);
+        }
+
+        spinlock_release(&victim->sched_lock);
+        spinlock_release(&self->sched_lock);
+
+        if (0 != thread)
+            return thread;
+    }
+
+    return 0;
+}
 
 void scheduler_add(thread_t *thread, uint8_t flags) {
     // Still frozen?
     if (UNLIKELY(thread->frozen > 0))
         PANIC("Trying to add frozen thread to scheduling.");
-    
+
+    smp_cpu_t *cpu;
+
     // Instant
-    if (0 != (flags & SCHED_FLAG_INSTANT)) {
+    if (0 != (flags & SCHED_FLAG_INSTANT) && 0 == (flags & SCHED_FLAG_THAWED)) {
         // Not recently thawed => already in scheduling
-        // Otherwise will be added as first, anyway.
-        if (0 == (flags & SCHED_FLAG_THAWED)) {
-            // Remove from list, if not first
-            if (thread != scheduler_threads_first)
-                scheduler_remove(thread);
+        cpu = _scheduler_lock_thread(thread);
+
+        // Already first?
+        if (thread == cpu->sched_first) {
+            spinlock_release(&cpu->sched_lock);
+            return;
         }
+
+        // Remove from list
+        _scheduler_unlink(cpu, thread);
+
+    } else {
+        cpu = _scheduler_target(thread);
+        spinlock_acquire(&cpu->sched_lock);
     }
-    
+
     // Add thread (as first in queue)
-    thread->next_sched = scheduler_threads_first;
-    scheduler_threads_first = thread;
-    
-    if (0 == scheduler_threads_last)
-        scheduler_threads_last = thread;
+    thread->next_sched = cpu->sched_first;
+    thread->cpu = cpu->index;
+    cpu->sched_first = thread;
+
+    if (0 == cpu->sched_last)
+        cpu->sched_last = thread;
+
+    // Timer may have been deferred while idle or with a single thread
+    bool notify = (++cpu->sched_count == 2 || cpu->idle);
+
+    spinlock_release(&cpu->sched_lock);
+
+    if (!notify)
+        return;
+
+    if (cpu == smp_cpu())
+        irq_timer_update();
+    else
+        smp_reschedule(cpu);
 }
 
 void scheduler_remove(thread_t *thread) {
-    // Iterate
-    thread_t *thread_cur = scheduler_threads_first;
-    thread_t *thread_prev = 0;
+    smp_cpu_t *cpu = _scheduler_lock_thread(thread);
+    _scheduler_unlink(cpu, thread);
+    spinlock_release(&cpu->sched_lock);
+}
 
-    while (0 != thread_cur) {
-        // Match?
-        if (thread->tid != thread_cur->tid ||
-            thread->pid != thread_cur->pid) {
-            thread_prev = thread_cur;
-            thread_cur = thread_cur->next_sched;
-            continue;
-        }
+void scheduler_migrate(thread_t *thread) {
+    smp_cpu_t *self = smp_cpu();
+
+    while (true) {
+        smp_cpu_t *source = smp_cpus[thread->cpu];
+
+        if (source == self)
+            return;
+
+        _scheduler_lock_pair(self, source);
+
+        // Not migrated by someone else meanwhile?
+        bool stable = (source->index == thread->cpu);
 
-        // First?
-        if (thread_prev == 0)
-            scheduler_threads_first = thread->next_sched;
-        else
-            thread_prev->next_sched = thread->next_sched;
+        if (stable && _scheduler_unlink(source, thread))
+            _scheduler_append(self, thread);
+        else if (stable)
+            thread->cpu = self->index;
 
-        // Last?
-        if (thread->next_sched == 0)
-            scheduler_threads_last = thread_prev;
+        spinlock_release(&source->sched_lock);
+        spinlock_release(&self->sched_lock);
 
-        break;
+        if (stable)
+            return;
     }
 }
 
-thread_t *scheduler_next() {
-    // No threads?
-    if (0 == scheduler_threads_first)
+size_t scheduler_count(void) {
+    return smp_cpu()->sched_count;
+}
+
+/**
+ * Picks and claims a thread in the given address space among the first
+ * threads of the locked run queue of the given processor, unless the first
+ * thread has been passed over too often.
+ *
+ * Moves the thread to the end of the queue.
+ *
+ * @param cpu The current processor.
+ * @param space The current address space.
+ * @return The thread or a null pointer, if the first thread should run.
+ */
+static thread_t *_scheduler_next_space(smp_cpu_t *cpu, uintptr_t space) {
+    thread_t *first = cpu->sched_first;
+
+    if (0 == first || space == first->addr_space || first->sched_skipped >= SCHED_SKIP_MAX)
         return 0;
 
-    // One thread?
-    if (scheduler_threads_first == scheduler_threads_last)
-        return scheduler_threads_first;
+    thread_t *prev = first;
+    thread_t *thread = first->next_sched;
+    size_t scanned;
+
+    for (scanned = 1; 0 != thread && scanned < SCHED_SPACE_SCAN; ++scanned) {
+        // Not the current thread, whose slice elapsed
+        if (space == thread->addr_space && cpu->thread != thread && thread_claim(thread))
+            break;
+
+        prev = thread;
+        thread = thread->next_sched;
+    }
+
+    if (0 == thread || scanned >= SCHED_SPACE_SCAN)
+        return 0;
+
+    // Account the threads passed over
+    thread_t *skipped;
+
+    for (skipped = first; skipped != thread; skipped = skipped->next_sched)
+        ++skipped->sched_skipped;
+
+    // Move to the end of the queue
+    if (thread != cpu->sched_last) {
+        prev->next_sched = thread->next_sched;
+        cpu->sched_last->next_sched = thread;
+        cpu->sched_last = thread;
+        thread->next_sched = 0;
+    }
+
+    return thread;
+}
+
+thread_t *scheduler_next() {
+    smp_cpu_t *cpu = smp_cpu();
+    thread_t *next = 0;
+
+    spinlock_acquire(&cpu->sched_lock);
+
+    // Prefer staying in the current address space
+    next = _scheduler_next_space(cpu, memory_space_get());
+
+    // Rotate until finding a thread that is not running elsewhere
+    size_t remaining = (0 == next) ? cpu->sched_count : 0;
+
+    while (remaining-- > 0) {
+        thread_t *thread = cpu->sched_first;
+
+        // Move to the end of the queue
+        if (thread != cpu->sched_last) {
+            cpu->sched_first = thread->next_sched;
+            cpu->sched_last->next_sched = thread;
+            cpu->sched_last = thread;
+            thread->next_sched = 0;
+        }
+
+        if (thread_claim(thread)) {
+            next = thread;
+            break;
+        }
+    }
+
+    if (0 != next)
+        next->sched_skipped = 0;
+
+    spinlock_release(&cpu->sched_lock);
+
+    // Nothing to run here?
+    if (0 == next && smp_cpu_count > 1)
+        next = _scheduler_steal(cpu);
 
-    // Get next thread and add it to the end of the queue
-    thread_t *next = scheduler_threads_first;
-    scheduler_threads_first = next->next_sched;
-    scheduler_threads_last->next_sched = next;
-    scheduler_threads_last = next;
-    
     return next;
 }
@@ -25,28 +25,98 @@
 
 //- Stack ----------------------------------------------------------------------
 
-void stack_create(stack_t *stack, process_t *process) {
-    stack->address = MEMORY_USER_STACK_VADDR + process->stack_offset + STACK_LENGTH_MAX;
-    process->stack_offset += STACK_LENGTH_MAX;
-    stack->length = 0;
+void stack_create(stack_t *stack, process_t *process, uintptr_t limit) {
+    // Page aligned limit (the slot's size at most)
+    limit = (limit + 0xFFF) & ~0xFFFULL;
 
-    if (UNLIKELY(stack->address >= MEMORY_USER_STACK_VADDR + STACK_PROCESS_MAX))
-        PANIC("Exceeded maximum number of stacks per process.");
+    if (0 == limit || limit > STACK_LENGTH_MAX)
+        limit = STACK_LENGTH_MAX;
+
+    stack->limit = limit;
+
+    // Reuse a released slot, preferring one that is still mapped
+    stack_slot_t *slot = process->stack_warm;
+
+    if (0 != slot) {
+        process->stack_warm = slot->next;
+        --process->stack_warm_count;
+
+    } else if (0 != (slot = process->stack_cold)) {
+        process->stack_cold = slot->next;
+    }
+
+    if (0 != slot) {
+        stack->address = slot->address;
+        stack->length = slot->length;
+        heap_free(slot);
+
+    } else {
+        stack->address = MEMORY_USER_STACK_VADDR + process->stack_offset + STACK_LENGTH_MAX;
+        process->stack_offset += STACK_LENGTH_MAX;
+        stack->length = 0;
+
+        if (UNLIKELY(stack->address >= MEMORY_USER_STACK_VADDR + STACK_PROCESS_MAX))
+            PANIC("Exceeded maximum number of stacks per process.");
+    }
+
+    // Pre-fault (never shrinks a reused stack beyond its limit)
+    uintptr_t length = (STACK_PREFAULT_LENGTH < limit) ? STACK_PREFAULT_LENGTH : limit;
+
+    if (stack->length > limit)
+        length = limit;
+    else if (stack->length > length)
+        return;
 
     uintptr_t old_addr_space = memory_space_get();
 
     if (old_addr_space != process->addr_space)
         memory_space_switch(process->addr_space);
 
-    stack_resize(stack, 0x1000, process);
+    stack_resize(stack, length, process);
 
     if (old_addr_space != process->addr_space)
         memory_space_switch(old_addr_space);
 }
 
 void stack_dispose(stack_t *stack, process_t *process) {
-    // Resize stack to zero
-    stack_resize(stack, 0, process);
+    stack_slot_t *slot = (stack_slot_t *) heap_alloc(sizeof(stack_slot_t));
+    slot->address = stack->address;
+
+    // Keep the top of the stack mapped for the next thread, unless enough are
+    if (process->stack_warm_count < STACK_WARM_MAX) {
+        if (stack->length > STACK_WARM_LENGTH)
+            stack_resize(stack, STACK_WARM_LENGTH, process);
+
+        slot->next = process->stack_warm;
+        process->stack_warm = slot;
+        ++process->stack_warm_count;
+
+    } else {
+        stack_resize(stack, 0, process);
+
+        slot->next = process->stack_cold;
+        process->stack_cold = slot;
+    }
+
+    slot->length = stack->length;
+}
+
+void stack_slots_dispose(process_t *process) {
+    stack_slot_t *lists[] = { process->stack_warm, process->stack_cold };
+    size_t i;
+
+    for (i = 0; i < 2; ++i) {
+        stack_slot_t *slot = lists[i];
+
+        while (0 != slot) {
+            stack_slot_t *next = slot->next;
+            heap_free(slot);
+            slot = next;
+        }
+    }
+
+    process->stack_warm = process->stack_cold = 0;
+    process->stack_warm_count = 0;
 }
 
 void stack_resize(stack_t *stack, uintptr_t new_len, process_t *process) {
@@ -87,3 +157,111 @@ void stack_resize(stack_t *stack, uintptr_t new_len, process_t *process) {
     // Set new size
     stack->length = new_len;
 }
+
+//- Kernel Stacks --------------------------------------------------------------
+
+/**
+ * A released kernel stack slot whose pages have been unmapped.
+ */
+typedef struct kernel_stack_slot_t {
+    uintptr_t top;
+    struct kernel_stack_slot_t *next;
+} kernel_stack_slot_t;
+
+/**
+ * Lock protecting the lists of released kernel stacks.
+ */
+static spinlock_t _kernel_stack_lock = SPINLOCK_INIT;
+
+/**
+ * Released stacks that are still mapped (linked through their lowest word).
+ */
+static uintptr_t _kernel_stack_cache = 0;
+static size_t _kernel_stack_cache_count = 0;
+
+/**
+ * Released slots without pages.
+ */
+static kernel_stack_slot_t *_kernel_stack_slots = 0;
+
+/**
+ * Top of the first slot that has never been used.
+ */
+static uintptr_t _kernel_stack_next = MEMORY_KERNEL_STACKS_VADDR + KERNEL_STACK_SLOT;
+
+uintptr_t kernel_stack_create(void) {
+    spinlock_acquire(&_kernel_stack_lock);
+
+    // Reuse a mapped stack
+    uintptr_t top = _kernel_stack_cache;
+
+    if (0 != top) {
+        _kernel_stack_cache = *((uintptr_t *) (top - KERNEL_STACK_SIZE));
+        --_kernel_stack_cache_count;
+
+        spinlock_release(&_kernel_stack_lock);
+        return top;
+    }
+
+    // Reuse a released slot or take a new one
+    kernel_stack_slot_t *slot = _kernel_stack_slots;
+
+    if (0 != slot) {
+        top = slot->top;
+        _kernel_stack_slots = slot->next;
+
+    } else {
+        top = _kernel_stack_next;
+        _kernel_stack_next += KERNEL_STACK_SLOT;
+
+        if (UNLIKELY(top > MEMORY_MODULES_VADDR))
+            PANIC("Exceeded maximum number of kernel stacks.");
+    }
+
+    spinlock_release(&_kernel_stack_lock);
+
+    if (0 != slot)
+        heap_free(slot);
+
+    // Map stack (below is unmapped and serves as guard)
+    uintptr_t addr;
+
+    for (addr = top - KERNEL_STACK_SIZE; addr < top; addr += PAGE_SIZE)
+        memory_map(addr, frame_alloc(), PAGE_FLAG_WRITEABLE | PAGE_FLAG_GLOBAL);
+
+    return top;
+}
+
+void kernel_stack_dispose(uintptr_t top) {
+    spinlock_acquire(&_kernel_stack_lock);
+
+    // Keep mapped for reuse?
+    if (_kernel_stack_cache_count < KERNEL_STACK_CACHE) {
+        *((uintptr_t *) (top - KERNEL_STACK_SIZE)) = _kernel_stack_cache;
+        _kernel_stack_cache = top;
+        ++_kernel_stack_cache_count;
+
+        spinlock_release(&_kernel_stack_lock);
+        return;
+    }
+
+    spinlock_release(&_kernel_stack_lock);
+
+    // Unmap stack
+    uintptr_t addr;
+
+    for (addr = top - KERNEL_STACK_SIZE; addr < top; addr += PAGE_SIZE) {
+        uintptr_t phys = memory_physical(addr);
+        memory_unmap(addr);
+        frame_free(phys);
+    }
+
+    // Remember slot
+    kernel_stack_slot_t *slot = (kernel_stack_slot_t *) heap_alloc(sizeof(kernel_stack_slot_t));
+    slot->top = top;
+
+    spinlock_acquire(&_kernel_stack_lock);
+    slot->next = _kernel_stack_slots;
+    _kernel_stack_slots = slot;
+    spinlock_release(&_kernel_stack_lock);
+}
@@ -24,57 +24,108 @@
 #include <memory.h>
 #include <debug.h>
 #include <ipc.h>
+#include <syscall.h>
+#include <kdata.h>
 
 //- Thread ---------------------------------------------------------------------
 
-#define THREAD_MAP(pid) ((thread_t **) (MEMORY_THREAD_MAP_VADDR + (pid * THREAD_MAP_SIZE)))
+extern uint8_t idle;
 
-thread_t *thread_current = 0;
-process_t *process_current = 0;
+/**
+ * Frees the structure of the given thread.
+ *
+ * @param thread The thread to free.
+ */
+static void _thread_destroy(thread_t *thread) {
+    kernel_stack_dispose(thread->kernel_stack);
+    heap_free(thread->fx_data);
+    heap_free(thread);
+}
 
-extern uint8_t idle;
-static cpu_int_state_t _thread_state_idle;
+/**
+ * Marks the given thread as not running anymore on the current processor.
+ *
+ * Frees the thread if that has been deferred and notifies the processor the
+ * thread has been queued on meanwhile.
+ *
+ * @param thread The thread to release.
+ */
+static void _thread_release(thread_t *thread) {
+    // Read before releasing, as the thread may be freed by others afterwards
+    bool queued_elsewhere = (0 == thread->frozen && thread->cpu != smp_cpu()->index);
+    uint32_t cpu = thread->cpu;
 
-static uint32_t _thread_id_next(uint32_t pid) {
-    thread_t **map = THREAD_MAP(pid);
-    uint32_t tid;
+    uint32_t on_cpu = __sync_fetch_and_and(&thread->on_cpu, ~THREAD_ON_CPU_MASK);
 
-    for (tid = 0; tid < THREAD_MAX; ++tid)
-        if (0 == map[tid])
-            return tid;
+    if (0 != (on_cpu & THREAD_ON_CPU_FREE)) {
+        _thread_destroy(thread);
 
-    PANIC("Maximum number of threads reached.");
-    return -1;
+    } else if (queued_elsewhere) {
+        // Could not be run there while running here
+        smp_reschedule(smp_cpus[cpu]);
+    }
 }
 
-thread_t *thread_spawn(process_t *process, uintptr_t entry_point) {
+bool thread_claim(thread_t *thread) {
+    uint32_t self = smp_cpu()->index + 1;
+
+    while (true) {
+        uint32_t on_cpu = thread->on_cpu;
+
+        // Already running here?
+        if (self == on_cpu)
+            return true;
+
+        // Running elsewhere or about to be freed?
+        if (0 != on_cpu)
+            return false;
+
+        if (__sync_bool_compare_and_swap(&thread->on_cpu, 0, self))
+            return true;
+    }
+}
+
+thread_t *thread_spawn(process_t *process, uintptr_t entry_point, uintptr_t stack_limit) {
     // Create thread structure
     thread_t *thread = (thread_t *) heap_alloc(sizeof(thread_t));
     memset(thread, 0, sizeof(thread_t));
 
+    // Allocate id and add to map
+    thread->tid = idmap_alloc(&process->thread_map, thread);
+
+    if (UNLIKELY(IDMAP_NONE == thread->tid)) {
+        heap_free(thread);
+        return 0;
+    }
+
     // Fill structure
-    thread->tid = _thread_id_next(process->pid);
     thread->pid = process->pid;
     thread->frozen = 1;
     thread->entry_point = entry_point;
-    stack_create(&thread->stack, process);
+    thread->addr_space = process->addr_space;
+    thread->cpu = smp_cpu()->index;
+    stack_create(&thread->stack, process, stack_limit);
+    kdata_map(process, thread);
     thread->next_sched = 0;
 
-    // Setup state
-    thread->state.rsp = thread->state.state.rbp = (uintptr_t) thread->stack.address;
-    thread->state.flags |= (1 << 9); // Enable interrupts
-    thread->state.rip = entry_point;
+    // Setup state at the top of the kernel stack, where interrupts from user
+    // mode push their frame
+    thread->kernel_stack = kernel_stack_create();
+    thread->state = (cpu_int_state_t *) (thread->kernel_stack - sizeof(cpu_int_state_t));
+    memset(thread->state, 0, sizeof(cpu_int_state_t));
 
-    thread->state.cs = 0x1B;
-    thread->state.ds = thread->state.ss = 0x23;
+    thread->state->rsp = thread->state->state.rbp = (uintptr_t) thread->stack.address;
+    thread->state->flags |= (1 << 9); // Enable interrupts
+    thread->state->rip = entry_point;
 
-    // Setup FPU state
-    // (512 bytes are allocated on 512 byte boundary, which is
-    //  aligned to 16 bytes).
-    thread->fx_data = heap_alloc(512);
+    thread->state->cs = 0x23;
+    thread->state->ds = thread->state->ss = 0x1B;
 
-    // Add to map
-    THREAD_MAP(process->pid)[thread->tid] = thread;
+    // Setup FPU state, loaded on first use
+    // (heap slots are aligned to their power of two size, so the
+    //  area is aligned to 64 bytes).
+    thread->fx_data = heap_alloc(fpu_state_size);
+    fpu_state_init(thread->fx_data);
 
     // Add to list
     thread->next = process->threads;
@@ -84,10 +135,7 @@ thread_t *thread_spawn(process_t *process, uintptr_t entry_point) {
 }
 
 thread_t *thread_get(process_t *process, uint32_t tid) {
-    if (tid >= THREAD_MAX)
-        return 0;
-
-    return THREAD_MAP(process->pid)[tid];
+    return (thread_t *) idmap_get(&process->thread_map, tid);
 }
 
 void thread_stop(process_t *process, thread_t *thread) {
@@ -97,27 +145,41 @@ void thread_stop(process_t *process, thread_t *thread) {
 
     // Is last thread and implicit thread-triggered termination flag
     // set in hosting process?
-    if (process->threads == thread && 0 == thread->next &&
+    if (!process->terminating &&
+        process->threads == thread && 0 == thread->next &&
         0 != (process->term_implicit & PROCESS_TERM_THREADS)) {
 
         process_terminate(process->pid);
         return;
     }
 
-    // Remove from scheduler
+    // Remove from scheduler and wait queues
     thread_freeze(thread);
+    timeout_cancel(&thread->timeout);
 
-    // Dispose stack
-    stack_dispose(&thread->stack, process);
+    if (0 != thread->futex_waiter_count) {
+        futex_dequeue(process, thread);
+        thread->sleep_mode = 0;
+    }
 
-    // Dispose FPU data
-    heap_free(thread->fx_data);
+    if (THREAD_SLEEP_QUEUE == thread->sleep_mode)
+        ipc_queue_waiter_remove(thread);
 
-    // Add terminated flag
+    // Add terminated flag (FPU data is disposed with the structure, as the
+    // thread might still be running on another processor)
     thread->flags |= THREAD_FLAG_TERMINATED;
 
+    // Running on another processor?
+    uint32_t on_cpu = thread->on_cpu & THREAD_ON_CPU_MASK;
+
+    if (0 != on_cpu && on_cpu != smp_cpu()->index + 1)
+        smp_reschedule(smp_cpus[on_cpu - 1]);
+
     // Free message if it is an IPC thread
-    if (THREAD_ROLE_IPC_RECEIVER == thread->role) {
+    if (THREAD_ROLE_IPC_WAITING == thread->role)
+        ipc_receiver_remove(process, thread);
+
+    if (THREAD_ROLE_NORMAL != thread->role) {
 
         if (0 != thread->role_ctx) {
             heap_free(thread->role_ctx);
@@ -125,10 +187,23 @@ void thread_stop(process_t *process, thread_t *thread) {
         }
     }
 
-    // Dispose all IPC buffers
-    uint8_t buffer;
-    for (buffer = 0; buffer <= 1; ++buffer)
-    	ipc_buffer_resize(0, buffer, thread);
+    // Dispose stack and IPC buffers (unless the whole address space is about
+    // to be disposed)
+    if (!process->terminating) {
+        uintptr_t old_space = memory_space_get();
+
+        if (old_space != process->addr_space)
+            memory_space_switch(process->addr_space);
+
+        stack_dispose(&thread->stack, process);
+
+        uint8_t buffer;
+        for (buffer = 0; buffer <= 1; ++buffer)
+            ipc_buffer_release(buffer, thread, process);
+
+        if (old_space != process->addr_space)
+            memory_space_switch(old_space);
+    }
 
     // Free if detached.
     if (0 != (thread->flags & THREAD_FLAG_DETACHED)) {
@@ -167,7 +242,7 @@ void thread_free(process_t *process, uint32_t tid) {
         return;
 
     // Remove from map
-    THREAD_MAP(process->pid)[tid] = 0;
+    idmap_free(&process->thread_map, tid);
 
     // Remove from process
     if (0 == thread_prev)
@@ -175,8 +250,11 @@ void thread_free(process_t *process, uint32_t tid) {
     else
         thread_prev->next = thread->next;
 
-    // Free structure
-    heap_free(thread);
+    // Free structure, unless still running
+    uint32_t on_cpu = __sync_fetch_and_or(&thread->on_cpu, THREAD_ON_CPU_FREE);
+
+    if (0 == (on_cpu & THREAD_ON_CPU_MASK))
+        _thread_destroy(thread);
 }
 
 void thread_dispose_all(process_t *process) {
@@ -219,9 +297,13 @@ void thread_thaw(thread_t *thread, uint8_t flags) {
         return;
 
     // Completely thawed afterwards?
-    if (0 == --thread->frozen)
+    if (0 == --thread->frozen) {
+        // Woken before timing out
+        timeout_cancel(&thread->timeout);
+
         // Add to scheduler
         scheduler_add(thread, SCHED_FLAG_THAWED | flags);
+    }
 }
 
 bool thread_join_sleep(thread_t *thread, thread_t *wait_for) {
@@ -259,12 +341,86 @@ void thread_join_awake(thread_t *thread, thread_t *wait_for) {
     heap_free(thread->sleep_ctx);
 
     // Set result in thread's state
-    thread->state.state.rbx = (uintptr_t) wait_for->result_ptr;
+    thread->state->state.rbx = (uintptr_t) wait_for->result_ptr;
 
     // Thaw thread
     thread_thaw(thread, 0);
 }
 
+void thread_timeout_set(thread_t *thread, uint64_t ns) {
+    if (THREAD_TIMEOUT_NONE == ns)
+        return;
+
+    timeout_set(&thread->timeout, timeout_ticks(ns));
+}
+
+/**
+ * Aborts the sleep of the given thread after its timeout expired.
+ *
+ * @param process The process hosting the thread.
+ * @param thread The thread whose timeout expired.
+ */
+static void _thread_timeout_expire(process_t *process, thread_t *thread) {
+    switch (thread->sleep_mode) {
+        case THREAD_SLEEP_TIMER:
+            break;
+
+        case THREAD_SLEEP_FUTEX:
+            futex_dequeue(process, thread);
+            thread->state->state.rax = 2;
+            break;
+
+        case THREAD_SLEEP_FUTEX_VEC:
+            futex_dequeue(process, thread);
+            thread->state->state.rax = SYSCALL_FUTEX_WAITV_TIMEOUT;
+            break;
+
+        case THREAD_SLEEP_JOIN:
+            heap_free(thread->sleep_ctx);
+            thread->state->state.rax = 4;
+            break;
+
+        case THREAD_SLEEP_IPC:
+            thread->state->state.rax = 4;
+            thread->state->state.rsi = 0;
+            break;
+
+        default:
+            // Not sleeping in a timed wait
+            return;
+    }
+
+    thread->sleep_mode = 0;
+    thread->sleep_ctx = 0;
+    thread_thaw(thread, 0);
+}
+
+void thread_timeouts_run(void) {
+    // Threads with armed timeouts are not freed while the table is locked
+    rwlock_read_acquire(&process_table_lock);
+
+    timeout_t *timeout;
+    uint32_t seq;
+
+    while (0 != (timeout = timeout_pop(&seq))) {
+        thread_t *thread = (thread_t *) ((uintptr_t) timeout - OFFSETOF(thread_t, timeout));
+        process_t *process = process_get(thread->pid);
+
+        if (UNLIKELY(0 == process))
+            continue;
+
+        spinlock_acquire(&process->lock);
+
+        // Not woken or stopped meanwhile?
+        if (timeout_fire(timeout, seq))
+            _thread_timeout_expire(process, thread);
+
+        spinlock_release(&process->lock);
+    }
+
+    rwlock_read_release(&process_table_lock);
+}
+
 /*static void thread_state_dump(cpu_int_state_t *state) {
     DEBUG("Thread state dump\n");
     DEBUG("DS: ");
@@ -282,63 +438,172 @@ void thread_join_awake(thread_t *thread, thread_t *wait_for) {
     DEBUG("\n");
 }*/
 
-static void _thread_idle(cpu_int_state_t *state) {
-    extern uint8_t stack_runtime_top;
+/**
+ * Lets the current processor idle.
+ *
+ * Resumes the idle loop (or the boot code), if it has been interrupted before,
+ * or starts it over at the top of the processor's stack otherwise.
+ *
+ * @param leave Whether to leave the current address space, as it might be
+ *  about to be disposed.
+ */
+static void _thread_idle(bool leave) {
+    smp_cpu_t *cpu = smp_cpu();
 
     // No current thread or process
-    process_current = 0;
-    thread_current = 0;
+    cpu->process = 0;
+    cpu->thread = 0;
+    cpu->idle = true;
 
-    // Idle state initialized?
-    if (0 == _thread_state_idle.rip) {
-        _thread_state_idle.rsp = _thread_state_idle.state.rbp = (uintptr_t) &stack_runtime_top;
-        _thread_state_idle.flags |= (1 << 9); // Enable interrupts
-        _thread_state_idle.rip = (uintptr_t) &idle;
+    // Interrupted before?
+    cpu_int_state_t *state = cpu->idle_context;
+    cpu->idle_context = 0;
 
-        _thread_state_idle.cs = 0x08;
-        _thread_state_idle.ds = _thread_state_idle.ss = 0x10;
+    if (0 == state) {
+        state = (cpu_int_state_t *) (cpu->stack_top - sizeof(cpu_int_state_t));
+        memset(state, 0, sizeof(cpu_int_state_t));
+
+        state->rsp = state->state.rbp = cpu->stack_top;
+        state->flags |= (1 << 9); // Enable interrupts
+        state->rip = (uintptr_t) &idle;
+
+        state->cs = 0x08;
+        state->ds = state->ss = 0x10;
     }
 
-    // Load state
-    memcpy(state, &_thread_state_idle, sizeof(cpu_int_state_t));
+    cpu->resume = state;
+
+    // Return to the address space the idle loop disposes or leave the current
+    // one, if requested
+    uintptr_t space = cpu->idle_space;
+
+    if (0 == space && (leave || cpu->space_leave))
+        space = memory_space_initial;
+
+    cpu->space_leave = false;
+
+    if (0 != space && memory_space_get() != space)
+        memory_space_switch(space);
 }
 
 void thread_switch(thread_t *thread, cpu_int_state_t *state) {
-    // Backup state for current thread
-    if (0 != thread_current) {
-    	// Registers
-        memcpy(&thread_current->state, state, sizeof(cpu_int_state_t));
+    smp_cpu_t *cpu = smp_cpu();
+    thread_t *previous = cpu->thread;
+
+    // Switching away from the context the interrupt has been raised in?
+    bool interrupted = (state == cpu->resume);
+
+    // Interrupted the idle loop (or the boot code)? Resumed when idle again
+    if (0 == previous && interrupted)
+        cpu->idle_context = state;
+
+    // Thread running on another processor?
+    if (0 != thread && !thread_claim(thread))
+        thread = scheduler_next();
 
-        // FPU
-        fpu_save(thread_current->fx_data);
+    // Queued on another processor?
+    if (0 != thread && thread->cpu != cpu->index)
+        scheduler_migrate(thread);
+
+    // Leave the previous thread's address space when idle, if terminated
+    bool leave = (0 != previous && 0 != (previous->flags & THREAD_FLAG_TERMINATED));
+
+    // Hosting process terminated meanwhile? (the address space is announced
+    // before, so it is not disposed while switching to it, see
+    // memory_space_reap)
+    process_t *process = 0;
+
+    if (0 != thread) {
+        cpu->addr_space = thread->addr_space;
+        __sync_synchronize();
+
+        process = process_get(thread->pid);
+
+        if (0 == process) {
+            cpu->addr_space = memory_space_get();
+
+            if (thread != previous)
+                _thread_release(thread);
+
+            thread = 0;
+            leave = true;
+        }
+    }
+
+    // Backup FPU state for current thread, if used (unless terminated
+    // meanwhile), its registers remain in the frame on its kernel stack
+    if (cpu->fpu_active && previous != thread) {
+        if (0 == (previous->flags & THREAD_FLAG_TERMINATED))
+            fpu_save(previous->fx_data);
+
+        cpu->fpu_active = false;
+        fpu_disable();
+    }
+
+    // Switching back to the thread whose release has been deferred?
+    if (0 != thread && thread == cpu->switch_prev)
+        cpu->switch_prev = 0;
+
+    // Release previous thread (after leaving its kernel stack, if running on it)
+    if (0 != previous && previous != thread) {
+        if (interrupted)
+            cpu->switch_prev = previous;
+        else
+            _thread_release(previous);
     }
 
     // Idle?
     if (0 == thread) {
-        _thread_idle(state);
+        _thread_idle(leave);
 
     } else {
-        // Get current process
-        if (0 == process_current || process_current->pid != thread->pid)
-            process_current = process_get(thread->pid);
+        // Set current thread and process
+        cpu->thread = thread;
+        cpu->process = process;
+        cpu->idle = false;
+
+        // Return to the thread's frame and take interrupts on its stack
+        cpu->resume = thread->state;
+        cpu->tss->rsp0 = cpu->kernel_stack = thread->kernel_stack;
 
-        // Set current thread
-        thread_current = thread;
+        // Point the user GS base at the thread's slot (swapped in on return)
+        if (thread != previous)
+            cpu_msr_write(CPU_MSR_KERNEL_GS_BASE, thread->kdata);
 
         // Address space switch required?
-        if (memory_space_get() != process_current->addr_space)
-            memory_space_switch(process_current->addr_space);
+        ++cpu->switch_count;
 
-        // Set thread state
-        memcpy(state, &thread->state, sizeof(cpu_int_state_t));
+        if (memory_space_get() != thread->addr_space) {
+            memory_space_switch(thread->addr_space);
+            ++cpu->switch_space_count;
+        }
 
-        // Load FPU data
-        fpu_load(thread_current->fx_data);
+        // FPU state is loaded on first use (see thread_fpu_activate)
+    }
+}
 
-        // Is FPU state prepared?
-        if (0 == (thread->flags & THREAD_FLAG_FX_PREPARED)) {
-            fpu_prepare();
-            thread->flags |= THREAD_FLAG_FX_PREPARED;
-        }
+void thread_fpu_activate(void) {
+    smp_cpu_t *cpu = smp_cpu();
+    thread_t *thread = cpu->thread;
+
+    fpu_enable();
+    cpu->fpu_active = true;
+
+    // State still loaded (not used by another thread or processor since)?
+    if (cpu->fpu_owner == thread && thread->fpu_cpu == cpu->index + 1)
+        return;
+
+    fpu_load(thread->fx_data);
+    cpu->fpu_owner = thread;
+    thread->fpu_cpu = cpu->index + 1;
+}
+
+void thread_switch_finish(void) {
+    smp_cpu_t *cpu = smp_cpu();
+    thread_t *previous = cpu->switch_prev;
+
+    if (0 != previous) {
+        cpu->switch_prev = 0;
+        _thread_release(previous);
     }
 }
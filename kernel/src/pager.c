@@ -0,0 +1,211 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/string.h>
+
+#include <pager.h>
+#include <ipc.h>
+#include <memory.h>
+#include <multitasking.h>
+#include <shm.h>
+
+//- External Pager -------------------------------------------------------------
+
+/**
+ * Finds the pager region of the given process containing the given address.
+ *
+ * @param process The process.
+ * @param address The address.
+ * @return The region or a null pointer, if none contains the address.
+ */
+static pager_region_t *_pager_region_find(process_t *process, uintptr_t address) {
+    pager_region_t *region;
+
+    for (region = process->pager_regions; 0 != region; region = region->next)
+        if (address >= region->start && address < region->end)
+            return region;
+
+    return 0;
+}
+
+bool pager_register(process_t *process, uintptr_t start, size_t length, uint32_t pager) {
+    uintptr_t end = memalign(start + length, PAGE_SIZE);
+    start &= ~((uintptr_t) PAGE_SIZE - 1);
+
+    if (0 == length || end <= start || end > MEMORY_USER_END)
+        return false;
+
+    // Check for overlaps
+    pager_region_t *region;
+    size_t count = 0;
+
+    for (region = process->pager_regions; 0 != region; region = region->next) {
+        if (start < region->end && end > region->start)
+            return false;
+
+        ++count;
+    }
+
+    if (count >= PAGER_REGIONS_MAX)
+        return false;
+
+    // Add region
+    region = (pager_region_t *) heap_alloc(sizeof(pager_region_t));
+    region->start = start;
+    region->end = end;
+    region->pager = pager;
+    region->next = process->pager_regions;
+    process->pager_regions = region;
+
+    return true;
+}
+
+bool pager_fault(process_t *process, uintptr_t address, uint64_t error_code, cpu_int_state_t *state) {
+    pager_region_t *region = _pager_region_find(process, address);
+
+    if (0 == region)
+        return false;
+
+    // Pager still exists? (a process cannot page itself, as its handler
+    // might fault as well)
+    process_t *pager = process_get(region->pager);
+
+    if (0 == pager || pager == process || 0 == pager->message_handler)
+        return false;
+
+    // Spawn handler thread
+    thread_t *handler = thread_spawn(pager, pager->message_handler, 0);
+
+    if (UNLIKELY(0 == handler))
+        return false;
+
+    ipc_role_ctx_t *role_ctx =
+        (ipc_role_ctx_t *) heap_alloc(sizeof(ipc_role_ctx_t));
+
+    role_ctx->flags = IPC_FLAG_PAGE_FAULT;
+    role_ctx->sender_process = process->pid;
+    role_ctx->sender_thread = thread_current->tid;
+    role_ctx->fault_address = address;
+    role_ctx->fault_code = error_code;
+
+    handler->role = THREAD_ROLE_IPC_RECEIVER;
+    handler->role_ctx = role_ctx;
+
+    // Write the message to the handler's receive buffer
+    uintptr_t old_space = memory_space_switch(pager->addr_space);
+    ipc_buffer_resize(sizeof(pager_fault_t), IPC_BUFFER_RECV, handler, pager);
+
+    pager_fault_t *message = (pager_fault_t *)
+        (IPC_BUFFER_VADDR(IPC_BUFFER_RECV) + IPC_BUFFER_SIZE * handler->tid);
+
+    message->address = address;
+    message->error_code = error_code;
+    message->pid = process->pid;
+    message->tid = thread_current->tid;
+
+    memory_space_switch(old_space);
+
+    ipc_message_header(
+        IPC_BUFFER_RECV,
+        sizeof(pager_fault_t),
+        IPC_FLAG_PAGE_FAULT,
+        process->pid,
+        handler->tid,
+        handler->state);
+
+    // Freeze the faulting thread until the response (it retries the access)
+    thread_current->sleep_mode = THREAD_SLEEP_IPC;
+    thread_current->sleep_ctx = role_ctx;
+    thread_freeze(thread_current);
+
+    thread_switch(handler, state);
+    return true;
+}
+
+bool pager_resolve(ipc_role_ctx_t *role_ctx, uint32_t length, process_t *process) {
+    size_t count = length / sizeof(pager_map_t);
+
+    if (count > PAGER_MAP_MAX)
+        count = PAGER_MAP_MAX;
+
+    if (0 == count)
+        return false;
+
+    pager_map_t *response = (pager_map_t *)
+        (IPC_BUFFER_VADDR(IPC_BUFFER_SEND) + IPC_BUFFER_SIZE * thread_current->tid);
+    uintptr_t pager_space = memory_space_get();
+    uintptr_t fault_page = role_ctx->fault_address & ~((uintptr_t) PAGE_SIZE - 1);
+    bool resolved = false;
+    size_t done;
+
+    for (done = 0; done < count; done += PAGER_MAP_BATCH) {
+        pager_map_t maps[PAGER_MAP_BATCH];
+        size_t batch = count - done;
+        size_t i;
+
+        if (batch > PAGER_MAP_BATCH)
+            batch = PAGER_MAP_BATCH;
+
+        // Copy the mappings out of the pager's address space
+        for (i = 0; i < batch; ++i) {
+            pager_map_t *map = &response[done + i];
+            maps[i].source = map->source & ~((uintptr_t) PAGE_SIZE - 1);
+            maps[i].target = map->target & ~((uintptr_t) PAGE_SIZE - 1);
+            maps[i].flags = map->flags;
+        }
+
+        // Map into the faulting process (only unmapped pages of the pager's regions)
+        memory_space_switch(process->addr_space);
+
+        for (i = 0; i < batch; ++i) {
+            pager_region_t *region = _pager_region_find(process, maps[i].target);
+
+            if (0 == region || region->pager != process_current->pid)
+                continue;
+
+            if ((uintptr_t) -1 != memory_physical(maps[i].target))
+                continue;
+
+            // Only pages of shared memory regions the pager maps, whose frames
+            // are kept alive by the reference of the new mapping
+            bool writeable = (0 != (maps[i].flags & PAGER_MAP_WRITEABLE));
+
+            if (!shm_map_paged(process_current, maps[i].source, process, maps[i].target, writeable))
+                continue;
+
+            if (maps[i].target == fault_page &&
+                (writeable || 0 == (role_ctx->fault_code & PAGER_FAULT_WRITE)))
+                resolved = true;
+        }
+
+        memory_space_switch(pager_space);
+    }
+
+    return resolved;
+}
+
+void pager_dispose(process_t *process) {
+    while (0 != process->pager_regions) {
+        pager_region_t *region = process->pager_regions;
+        process->pager_regions = region->next;
+        heap_free(region);
+    }
+}
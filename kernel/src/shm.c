@@ -0,0 +1,400 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/string.h>
+
+#include <shm.h>
+#include <idmap.h>
+#include <memory.h>
+#include <multitasking.h>
+
+//- Shared Memory --------------------------------------------------------------
+
+STATIC_ASSERT(
+    sizeof(shm_chunk_t) <= HEAP_ALLOC_MAX,
+    "A chunk of a region's frames must fit into a heap slot.");
+
+/**
+ * Maps region ids to regions.
+ */
+static idmap_t _shm_map;
+
+/**
+ * All regions, for revoking the rights of terminated processes.
+ */
+static shm_t *_shm_list = 0;
+
+void shm_init(void) {
+    idmap_init(&_shm_map, IDMAP_MAX);
+}
+
+/**
+ * Finds the region mapping of the given process containing the given address.
+ *
+ * @param process The process.
+ * @param address The address.
+ * @param link Set to the link pointing to the mapping.
+ * @return The mapping or a null pointer, if none contains the address.
+ */
+static shm_mapping_t *_shm_mapping_find(
+        process_t *process,
+        uintptr_t address,
+        shm_mapping_t ***link) {
+    shm_mapping_t **current;
+
+    for (current = &process->shm_mappings; 0 != *current; current = &(*current)->next) {
+        shm_mapping_t *mapping = *current;
+        uintptr_t end = mapping->start + mapping->pages * PAGE_SIZE;
+
+        if (address >= mapping->start && address < end) {
+            *link = current;
+            return mapping;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Checks whether the given range can be mapped in the current address space,
+ * i.e. it is in user space and none of its pages is mapped.
+ *
+ * @param process The current process.
+ * @param address The start of the range.
+ * @param pages The number of pages of the range.
+ * @return Whether the range is free.
+ */
+static bool _shm_range_free(process_t *process, uintptr_t address, size_t pages) {
+    if (0 != (address & (PAGE_SIZE - 1)) || 0 == pages || pages > SHM_PAGES_MAX)
+        return false;
+
+    if (address >= MEMORY_USER_END || pages > (MEMORY_USER_END - address) / PAGE_SIZE)
+        return false;
+
+    // Limit the mappings per process (besides the pages mapped by pagers)
+    shm_mapping_t *mapping;
+    size_t count = 0;
+
+    for (mapping = process->shm_mappings; 0 != mapping; mapping = mapping->next)
+        if (!mapping->paged)
+            ++count;
+
+    if (count >= SHM_MAPPINGS_MAX)
+        return false;
+
+    size_t i;
+
+    for (i = 0; i < pages; ++i)
+        if ((uintptr_t) -1 != memory_physical(address + i * PAGE_SIZE))
+            return false;
+
+    return true;
+}
+
+/**
+ * Maps a range of the given region's pages into the current address space
+ * and adds the mapping to the given process.
+ *
+ * @param process The current process.
+ * @param shm The region.
+ * @param address The page aligned address to map the range at.
+ * @param first The index of the range's first page.
+ * @param pages The number of pages of the range.
+ * @param writeable Whether to map the range writeable.
+ * @return The mapping.
+ */
+static shm_mapping_t *_shm_mapping_add(
+        process_t *process,
+        shm_t *shm,
+        uintptr_t address,
+        size_t first,
+        size_t pages,
+        bool writeable) {
+    // Not owned by the address space (see _memory_space_free_structs)
+    uint16_t flags = PAGE_FLAG_USER | PAGE_FLAG_SHARED;
+
+    if (writeable)
+        flags |= PAGE_FLAG_WRITEABLE;
+
+    shm_chunk_t *chunk = shm->chunks;
+    size_t i;
+
+    for (i = 0; i < first / SHM_CHUNK_FRAMES; ++i)
+        chunk = chunk->next;
+
+    for (i = first; i < first + pages; ++i) {
+        if (i > first && 0 == i % SHM_CHUNK_FRAMES)
+            chunk = chunk->next;
+
+        memory_map(address + (i - first) * PAGE_SIZE, chunk->frames[i % SHM_CHUNK_FRAMES], flags);
+    }
+
+    shm_mapping_t *mapping = (shm_mapping_t *) heap_alloc(sizeof(shm_mapping_t));
+    mapping->shm = shm;
+    mapping->start = address;
+    mapping->first = first;
+    mapping->pages = pages;
+    mapping->writeable = writeable;
+    mapping->paged = false;
+    mapping->next = process->shm_mappings;
+    process->shm_mappings = mapping;
+
+    ++shm->refs;
+    return mapping;
+}
+
+/**
+ * Unmaps the pages of the given mapping from the current address space.
+ *
+ * @param mapping The mapping.
+ */
+static void _shm_mapping_unmap(shm_mapping_t *mapping) {
+    size_t i;
+
+    for (i = 0; i < mapping->pages; ++i)
+        memory_unmap(mapping->start + i * PAGE_SIZE);
+}
+
+/**
+ * Drops a reference to the given region, freeing it and its frames with the
+ * last one.
+ *
+ * @param shm The region.
+ */
+static void _shm_release(shm_t *shm) {
+    if (0 != --shm->refs)
+        return;
+
+    // Remove from list and map
+    shm_t **link = &_shm_list;
+
+    while (*link != shm)
+        link = &(*link)->next;
+
+    *link = shm->next;
+    idmap_free(&_shm_map, shm->id);
+
+    // Free rights and frames
+    while (0 != shm->grants) {
+        shm_grant_t *grant = shm->grants;
+        shm->grants = grant->next;
+        heap_free(grant);
+    }
+
+    size_t left = shm->pages;
+
+    while (0 != shm->chunks) {
+        shm_chunk_t *chunk = shm->chunks;
+        shm->chunks = chunk->next;
+
+        size_t count = (left < SHM_CHUNK_FRAMES) ? left : SHM_CHUNK_FRAMES;
+        size_t i;
+
+        for (i = 0; i < count; ++i)
+            frame_free(chunk->frames[i]);
+
+        left -= count;
+        heap_free(chunk);
+    }
+
+    heap_free(shm);
+}
+
+uint32_t shm_create(process_t *process, uintptr_t address, size_t pages) {
+    if (!_shm_range_free(process, address, pages))
+        return SHM_NONE;
+
+    shm_t *shm = (shm_t *) heap_alloc(sizeof(shm_t));
+    shm->id = idmap_alloc(&_shm_map, shm);
+
+    if (UNLIKELY(IDMAP_NONE == shm->id)) {
+        heap_free(shm);
+        return SHM_NONE;
+    }
+
+    shm->refs = 0;
+    shm->grants = 0;
+    shm->pages = pages;
+
+    // Allocate frames, appending chunks as required
+    shm_chunk_t **link = &shm->chunks;
+    shm_chunk_t *chunk = 0;
+    size_t i;
+
+    for (i = 0; i < pages; ++i) {
+        if (0 == i % SHM_CHUNK_FRAMES) {
+            chunk = (shm_chunk_t *) heap_alloc(sizeof(shm_chunk_t));
+            chunk->next = 0;
+            *link = chunk;
+            link = &chunk->next;
+        }
+
+        chunk->frames[i % SHM_CHUNK_FRAMES] = frame_alloc();
+    }
+
+    shm->next = _shm_list;
+    _shm_list = shm;
+
+    // Map and clear through the creator's mapping
+    _shm_mapping_add(process, shm, address, 0, pages, true);
+    memset((void *) address, 0, pages * PAGE_SIZE);
+
+    return shm->id;
+}
+
+bool shm_grant(process_t *process, uint32_t id, uint32_t pid, bool writeable) {
+    shm_t *shm = (shm_t *) idmap_get(&_shm_map, id);
+
+    if (0 == shm)
+        return false;
+
+    // Only rights held may be granted
+    shm_mapping_t *mapping;
+
+    for (mapping = process->shm_mappings; 0 != mapping; mapping = mapping->next)
+        if (shm == mapping->shm && !mapping->paged && (mapping->writeable || !writeable))
+            break;
+
+    if (0 == mapping)
+        return false;
+
+    // Extend an existing right
+    shm_grant_t *grant;
+
+    for (grant = shm->grants; 0 != grant; grant = grant->next) {
+        if (pid == grant->pid) {
+            grant->writeable = grant->writeable || writeable;
+            return true;
+        }
+    }
+
+    grant = (shm_grant_t *) heap_alloc(sizeof(shm_grant_t));
+    grant->pid = pid;
+    grant->writeable = writeable;
+    grant->next = shm->grants;
+    shm->grants = grant;
+
+    return true;
+}
+
+bool shm_map(process_t *process, uint32_t id, uintptr_t address, bool writeable) {
+    shm_t *shm = (shm_t *) idmap_get(&_shm_map, id);
+
+    if (0 == shm)
+        return false;
+
+    // Granted or mapped already?
+    bool allowed = false;
+    shm_grant_t *grant;
+    shm_mapping_t *mapping;
+
+    for (grant = shm->grants; 0 != grant && !allowed; grant = grant->next)
+        allowed = (process->pid == grant->pid && (grant->writeable || !writeable));
+
+    for (mapping = process->shm_mappings; 0 != mapping && !allowed; mapping = mapping->next)
+        allowed = (shm == mapping->shm && !mapping->paged && (mapping->writeable || !writeable));
+
+    if (!allowed || !_shm_range_free(process, address, shm->pages))
+        return false;
+
+    _shm_mapping_add(process, shm, address, 0, shm->pages, writeable);
+    return true;
+}
+
+bool shm_map_paged(
+        process_t *pager,
+        uintptr_t source,
+        process_t *process,
+        uintptr_t target,
+        bool writeable) {
+    shm_mapping_t **link;
+    shm_mapping_t *source_mapping = _shm_mapping_find(pager, source, &link);
+
+    // Only the pager's own pages, with the rights it holds
+    if (0 == source_mapping || source_mapping->paged)
+        return false;
+
+    if (writeable && !source_mapping->writeable)
+        return false;
+
+    size_t page = source_mapping->first + (source - source_mapping->start) / PAGE_SIZE;
+    shm_mapping_t *mapping = _shm_mapping_add(process, source_mapping->shm, target, page, 1, writeable);
+    mapping->paged = true;
+
+    return true;
+}
+
+bool shm_unmap(process_t *process, uintptr_t address) {
+    shm_mapping_t **link;
+    shm_mapping_t *mapping = _shm_mapping_find(process, address, &link);
+
+    if (0 == mapping || address != mapping->start)
+        return false;
+
+    *link = mapping->next;
+    _shm_mapping_unmap(mapping);
+
+    _shm_release(mapping->shm);
+    heap_free(mapping);
+
+    return true;
+}
+
+void shm_dispose(process_t *process) {
+    // Unmap before the frames may be freed, as the process's threads may
+    // still run on other processors until they are rescheduled
+    if (0 != process->shm_mappings) {
+        uintptr_t old_space = memory_space_switch(process->addr_space);
+        shm_mapping_t *mapping;
+
+        for (mapping = process->shm_mappings; 0 != mapping; mapping = mapping->next)
+            _shm_mapping_unmap(mapping);
+
+        memory_space_switch(old_space);
+    }
+
+    // Drop the mappings
+    while (0 != process->shm_mappings) {
+        shm_mapping_t *mapping = process->shm_mappings;
+        process->shm_mappings = mapping->next;
+
+        _shm_release(mapping->shm);
+        heap_free(mapping);
+    }
+
+    // Revoke rights, as the id may be reused
+    shm_t *shm;
+
+    for (shm = _shm_list; 0 != shm; shm = shm->next) {
+        shm_grant_t **link = &shm->grants;
+
+        while (0 != *link) {
+            shm_grant_t *grant = *link;
+
+            if (process->pid == grant->pid) {
+                *link = grant->next;
+                heap_free(grant);
+            } else {
+                link = &grant->next;
+            }
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/string.h>
+#include <smp.h>
+#include <acpi.h>
+#include <irq.h>
+#include <cpu.h>
+#include <fpu.h>
+#include <memory.h>
+#include <debug.h>
+#include <syscall.h>
+
+//- Processor Startup ----------------------------------------------------------
+
+// Delays for the INIT-SIPI-SIPI sequence (in PIT counts)
+#define SMP_DELAY_INIT      (IRQ_PIT_BASE_FREQ / 100)     // 10ms
+#define SMP_DELAY_STARTUP   (IRQ_PIT_BASE_FREQ / 5000)    // 200us
+#define SMP_DELAY_ONLINE    (IRQ_PIT_BASE_FREQ / 1000)    // 1ms
+
+// Number of SMP_DELAY_ONLINE periods to wait for a processor to come online
+#define SMP_ONLINE_TRIES 100
+
+extern uint8_t smp_trampoline_start;
+extern uint8_t smp_trampoline_end;
+extern uint64_t smp_trampoline_cr3;
+extern uint64_t smp_trampoline_stack;
+extern uint64_t smp_trampoline_entry;
+extern uint64_t smp_trampoline_cpu;
+extern uint8_t idle;
+
+/**
+ * Set by the BSP once the application processors may start scheduling.
+ */
+static volatile bool _smp_released = false;
+
+/**
+ * Returns the address of the given trampoline variable in the copy of the
+ * trampoline in low memory.
+ *
+ * @param var The trampoline variable in the kernel image.
+ * @return The variable in the copied trampoline.
+ */
+static uint64_t *_smp_trampoline_var(uint64_t *var) {
+    uintptr_t offset = (uintptr_t) var - (uintptr_t) &smp_trampoline_start;
+    return (uint64_t *) (SMP_TRAMPOLINE_PADDR + offset);
+}
+
+/**
+ * Maps a kernel stack for the application processor with the given index.
+ *
+ * @param index The processor's index.
+ * @return The top of the stack.
+ */
+static uintptr_t _smp_stack_create(uint32_t index) {
+    uintptr_t top = MEMORY_CPU_STACKS_VADDR + (index + 1) * SMP_STACK_SLOT;
+    uintptr_t addr;
+
+    for (addr = top - SMP_STACK_SIZE; addr < top; addr += PAGE_SIZE)
+        memory_map(addr, frame_alloc(), PAGE_FLAG_WRITEABLE | PAGE_FLAG_GLOBAL);
+
+    return top;
+}
+
+/**
+ * Starts the processor with the given APIC id.
+ *
+ * @param apic_id The processor's APIC id.
+ * @return Whether the processor came online.
+ */
+static bool _smp_start(uint8_t apic_id) {
+    // Create per-CPU data
+    uint32_t index = smp_cpu_count;
+
+    smp_cpu_t *cpu = (smp_cpu_t *) heap_alloc(sizeof(smp_cpu_t));
+    memset((void *) cpu, 0, sizeof(smp_cpu_t));
+
+    cpu->self = cpu;
+    cpu->index = index;
+    cpu->apic_id = apic_id;
+    cpu->stack_top = _smp_stack_create(index);
+
+    // Pass data to the trampoline
+    *_smp_trampoline_var(&smp_trampoline_cr3) = memory_space_initial;
+    *_smp_trampoline_var(&smp_trampoline_stack) = cpu->stack_top;
+    *_smp_trampoline_var(&smp_trampoline_entry) = (uintptr_t) &smp_ap_main;
+    *_smp_trampoline_var(&smp_trampoline_cpu) = (uintptr_t) cpu;
+
+    // INIT-SIPI-SIPI
+    irq_lapic_ipi(apic_id, IRQ_LAPIC_ICR_INIT | IRQ_LAPIC_ICR_LEVEL_ASSERT);
+    irq_pit_delay(SMP_DELAY_INIT);
+
+    uint8_t sipi;
+    for (sipi = 0; sipi < 2 && !cpu->online; ++sipi) {
+        irq_lapic_ipi(apic_id, IRQ_LAPIC_ICR_STARTUP | (SMP_TRAMPOLINE_PADDR >> 12));
+        irq_pit_delay(SMP_DELAY_STARTUP);
+    }
+
+    // Wait for the processor to come online
+    uint32_t tries;
+    for (tries = 0; tries < SMP_ONLINE_TRIES && !cpu->online; ++tries)
+        irq_pit_delay(SMP_DELAY_ONLINE);
+
+    if (!cpu->online) {
+        // Put the processor back into wait-for-SIPI state
+        irq_lapic_ipi(apic_id, IRQ_LAPIC_ICR_INIT | IRQ_LAPIC_ICR_LEVEL_ASSERT);
+        heap_free(cpu);
+
+        DEBUG("Processor ");
+        DEBUG_HEX(apic_id);
+        DEBUG(" did not respond.\n");
+        return false;
+    }
+
+    return true;
+}
+
+void smp_boot(void) {
+    smp_cpu_t *bsp = smp_cpu();
+
+    // Uniprocessor?
+    if (!irq_lapic_enabled || acpi_cpu_count <= 1)
+        return;
+
+    bsp->apic_id = irq_lapic_id();
+
+    // Copy trampoline to low memory (identity mapped)
+    size_t length = (uintptr_t) &smp_trampoline_end - (uintptr_t) &smp_trampoline_start;
+    memcpy((void *) SMP_TRAMPOLINE_PADDR, (void *) &smp_trampoline_start, length);
+
+    // Start application processors
+    size_t i;
+    for (i = 0; i < acpi_cpu_count && smp_cpu_count < SMP_CPU_MAX; ++i) {
+        if (acpi_cpu_apic_ids[i] == bsp->apic_id)
+            continue;
+
+        _smp_start(acpi_cpu_apic_ids[i]);
+    }
+
+    DEBUG("Processors online: ");
+    DEBUG_HEX(smp_cpu_count);
+    DEBUG("\n");
+}
+
+void smp_release(void) {
+    _smp_released = true;
+}
+
+void smp_ap_main(smp_cpu_t *cpu) {
+    // Per-CPU data
+    cpu_msr_write(CPU_MSR_GS_BASE, (uintptr_t) cpu);
+    cpu_msr_write(CPU_MSR_KERNEL_GS_BASE, 0);
+
+    // Descriptor tables and system call entry
+    smp_cpu_setup(cpu);
+    cpu_int_load();
+    syscall_init();
+
+    // Floating point unit
+    fpu_init();
+
+    // Local APIC
+    irq_lapic_init();
+
+    // Register processor
+    smp_cpus[cpu->index] = cpu;
+    ++smp_cpu_count;
+    cpu->online = true;
+
+    // Wait for the BSP to finish initialization
+    while (!_smp_released)
+        asm volatile ("pause");
+
+    // Start timer and idle until there is something to run
+    irq_timer_init();
+    cpu->idle = true;
+    cpu_int_enable();
+
+    void (*idle_loop)(void) = (void (*)(void)) &idle;
+    idle_loop();
+}
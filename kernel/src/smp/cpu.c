@@ -0,0 +1,55 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/string.h>
+#include <smp.h>
+#include <cpu.h>
+
+//- Per-CPU Data ---------------------------------------------------------------
+
+volatile size_t smp_cpu_count = 1;
+smp_cpu_t *smp_cpus[SMP_CPU_MAX];
+
+/**
+ * Per-CPU data of the bootstrap processor.
+ *
+ * Statically allocated, as it is required before the heap is available.
+ */
+static smp_cpu_t _smp_cpu_bsp;
+
+void smp_init(void) {
+    extern uint8_t stack_runtime_top;
+
+    memset((void *) &_smp_cpu_bsp, 0, sizeof(smp_cpu_t));
+    _smp_cpu_bsp.self = &_smp_cpu_bsp;
+    _smp_cpu_bsp.index = 0;
+    _smp_cpu_bsp.online = true;
+    _smp_cpu_bsp.stack_top = (uintptr_t) &stack_runtime_top;
+
+    smp_cpus[0] = &_smp_cpu_bsp;
+
+    // GS base points to the per-CPU data while in the kernel, the user's GS
+    // base is swapped in when returning to user mode
+    cpu_msr_write(CPU_MSR_GS_BASE, (uintptr_t) &_smp_cpu_bsp);
+    cpu_msr_write(CPU_MSR_KERNEL_GS_BASE, 0);
+}
+
+void smp_cpu_setup(smp_cpu_t *cpu) {
+    cpu->tss = cpu_tss_create(cpu->stack_top);
+}
@@ -0,0 +1,142 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <smp.h>
+#include <irq.h>
+#include <cpu.h>
+#include <memory.h>
+#include <multitasking.h>
+
+//- Inter-Processor Interrupts -------------------------------------------------
+
+/**
+ * Lock serializing TLB shootdowns.
+ */
+static spinlock_t _smp_tlb_lock = SPINLOCK_INIT;
+
+/**
+ * The page to invalidate for the current shootdown.
+ */
+static volatile uintptr_t _smp_tlb_vaddr = 0;
+
+/**
+ * Number of processors that still have to acknowledge the current shootdown.
+ */
+static volatile uint32_t _smp_tlb_remaining = 0;
+
+bool smp_reschedule_fast(void) {
+    // Current thread stopped from another processor or idle? Switch using the
+    // full handler
+    if (0 == thread_current ||
+        0 != thread_current->frozen ||
+        0 != (thread_current->flags & THREAD_FLAG_TERMINATED))
+        return true;
+
+    // Reevaluate the next timer event
+    irq_timer_update();
+    irq_lapic_eoi();
+    return false;
+}
+
+void smp_reschedule_handler(cpu_int_state_t *state) {
+    thread_switch(scheduler_next(), state);
+
+    // Reevaluate the next timer event
+    irq_timer_update();
+    irq_lapic_eoi();
+}
+
+bool smp_tlb_fast(void) {
+    smp_tlb_poll();
+    irq_lapic_eoi();
+    return false;
+}
+
+void smp_reschedule(smp_cpu_t *cpu) {
+    if (cpu == smp_cpu())
+        return;
+
+    irq_lapic_ipi(cpu->apic_id, SMP_RESCHEDULE_VECTOR);
+}
+
+void smp_tlb_poll(void) {
+    smp_cpu_t *cpu = smp_cpu();
+
+    if (LIKELY(!cpu->tlb_pending))
+        return;
+
+    // Invalidate
+    uintptr_t vaddr = _smp_tlb_vaddr;
+
+    if (SMP_TLB_FLUSH_ALL == vaddr)
+        memory_space_switch(memory_space_get());
+    else
+        asm volatile ("invlpg (%0)" :: "r" (vaddr) : "memory");
+
+    // Acknowledge
+    cpu->tlb_pending = false;
+    __sync_fetch_and_sub(&_smp_tlb_remaining, 1);
+}
+
+void smp_tlb_shootdown(uintptr_t vaddr) {
+    // Uniprocessor?
+    if (smp_cpu_count <= 1)
+        return;
+
+    smp_cpu_t *self = smp_cpu();
+    uintptr_t space = memory_space_get();
+    bool kernel = (SMP_TLB_FLUSH_ALL != vaddr) && (vaddr >= MEMORY_KERNEL_VADDR);
+
+    spinlock_acquire(&_smp_tlb_lock);
+
+    _smp_tlb_vaddr = vaddr;
+
+    // Select targets
+    uint32_t targets = 0;
+    size_t i;
+
+    for (i = 0; i < smp_cpu_count; ++i) {
+        smp_cpu_t *cpu = smp_cpus[i];
+
+        if (cpu == self || !cpu->online)
+            continue;
+
+        if (!kernel && cpu->addr_space != space)
+            continue;
+
+        ++targets;
+        cpu->tlb_pending = true;
+    }
+
+    _smp_tlb_remaining = targets;
+
+    // Notify targets
+    for (i = 0; i < smp_cpu_count; ++i) {
+        smp_cpu_t *cpu = smp_cpus[i];
+
+        if (cpu != self && cpu->tlb_pending)
+            irq_lapic_ipi(cpu->apic_id, SMP_TLB_VECTOR);
+    }
+
+    // Wait for acknowledgements
+    while (0 != _smp_tlb_remaining)
+        asm volatile ("pause");
+
+    spinlock_release(&_smp_tlb_lock);
+}
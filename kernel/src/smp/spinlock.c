@@ -0,0 +1,112 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <spinlock.h>
+#include <smp.h>
+
+//- Spinlocks ------------------------------------------------------------------
+
+void spinlock_acquire(spinlock_t *lock) {
+    while (0 != __sync_lock_test_and_set(&lock->locked, 1)) {
+        // Spin on a plain read to keep the cache line shared
+        while (0 != lock->locked) {
+            smp_tlb_poll();
+            asm volatile ("pause");
+        }
+    }
+}
+
+bool spinlock_try_acquire(spinlock_t *lock) {
+    return (0 == __sync_lock_test_and_set(&lock->locked, 1));
+}
+
+void spinlock_release(spinlock_t *lock) {
+    __sync_lock_release(&lock->locked);
+}
+
+void spinlock_acquire_recursive(spinlock_t *lock) {
+    uint32_t self = smp_cpu()->index + 1;
+
+    // Already owned?
+    if (self == lock->owner) {
+        ++lock->depth;
+        return;
+    }
+
+    spinlock_acquire(lock);
+    lock->owner = self;
+    lock->depth = 1;
+}
+
+void spinlock_release_recursive(spinlock_t *lock) {
+    if (0 != --lock->depth)
+        return;
+
+    lock->owner = 0;
+    spinlock_release(lock);
+}
+
+bool spinlock_owned(spinlock_t *lock) {
+    return (smp_cpu()->index + 1 == lock->owner);
+}
+
+//- Reader-Writer Locks --------------------------------------------------------
+
+/**
+ * Spins until the given condition is false, handling TLB shootdowns.
+ *
+ * @param cond The condition to wait for.
+ */
+#define RWLOCK_SPIN_WHILE(cond)     \
+    while (cond) {                  \
+        smp_tlb_poll();             \
+        asm volatile ("pause");     \
+    }
+
+void rwlock_read_acquire(rwlock_t *lock) {
+    while (true) {
+        RWLOCK_SPIN_WHILE(0 != lock->writer);
+
+        // Enter and check again, as a writer may have come in between
+        __sync_fetch_and_add(&lock->readers, 1);
+
+        if (LIKELY(0 == lock->writer))
+            return;
+
+        __sync_fetch_and_sub(&lock->readers, 1);
+    }
+}
+
+void rwlock_read_release(rwlock_t *lock) {
+    __sync_fetch_and_sub(&lock->readers, 1);
+}
+
+void rwlock_write_acquire(rwlock_t *lock) {
+    // Announce writer, blocking new readers
+    while (!__sync_bool_compare_and_swap(&lock->writer, 0, RWLOCK_WRITER))
+        RWLOCK_SPIN_WHILE(0 != lock->writer);
+
+    // Wait for readers to leave
+    RWLOCK_SPIN_WHILE(0 != lock->readers);
+}
+
+void rwlock_write_release(rwlock_t *lock) {
+    __sync_lock_release(&lock->writer);
+}
@@ -0,0 +1,113 @@
+; Carbon Operating System
+; Copyright (C) 2011 Lukas Heidemann
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+;; Startup code for application processors.
+;;
+;; Copied to SMP_TRAMPOLINE_PADDR (see smp.h) by smp_boot and started using a
+;; SIPI. Switches from real mode to long mode using the initial address space,
+;; which identity maps the low 2MB, and calls smp_ap_main.
+
+SMP_TRAMPOLINE_PADDR equ 0x8000
+
+%define TRAMPOLINE(label) (SMP_TRAMPOLINE_PADDR + (label - smp_trampoline_start))
+
+section .data
+
+global smp_trampoline_start
+global smp_trampoline_end
+global smp_trampoline_cr3
+global smp_trampoline_stack
+global smp_trampoline_entry
+global smp_trampoline_cpu
+
+align 16
+bits 16
+smp_trampoline_start:
+  cli
+  cld
+
+  xor ax, ax                    ; Flat real mode segments
+  mov ds, ax
+  mov es, ax
+  mov ss, ax
+
+  lgdt [TRAMPOLINE(smp_trampoline_gdtr)]
+
+  mov eax, cr0                  ; Enable protected mode
+  or eax, 1
+  mov cr0, eax
+
+  jmp dword 0x08:TRAMPOLINE(smp_trampoline_32)
+
+bits 32
+smp_trampoline_32:
+  mov ax, 0x10                  ; Load data segments
+  mov ds, ax
+  mov es, ax
+  mov ss, ax
+
+  mov eax, cr4                  ; Enable PAE
+  or eax, 1 << 5
+  mov cr4, eax
+
+  mov eax, [TRAMPOLINE(smp_trampoline_cr3)]
+  mov cr3, eax                  ; Load initial PML4
+
+  mov ecx, 0xC0000080           ; Enable long mode
+  rdmsr
+  or eax, 1 << 8
+  wrmsr
+
+  mov eax, 0x80000011           ; Enable paging (clears CR0.CD and CR0.NW)
+  mov cr0, eax
+
+  jmp 0x18:TRAMPOLINE(smp_trampoline_64)
+
+bits 64
+smp_trampoline_64:
+  mov rsp, [TRAMPOLINE(smp_trampoline_stack)]
+  mov rbp, 0x0
+
+  mov rdi, [TRAMPOLINE(smp_trampoline_cpu)]
+  mov rax, [TRAMPOLINE(smp_trampoline_entry)]
+  call rax                      ; Does not return
+  jmp $
+
+;; Temporary GDT
+align 8
+smp_trampoline_gdt:
+  dq 0x0000000000000000         ; Null
+  dq 0x00CF9A000000FFFF         ; 32 bit code
+  dq 0x00CF92000000FFFF         ; 32 bit data
+  dq 0x00AF9A000000FFFF         ; 64 bit code
+
+smp_trampoline_gdtr:
+  dw 0x1F
+  dd TRAMPOLINE(smp_trampoline_gdt)
+
+;; Parameters (written by smp_boot)
+align 8
+smp_trampoline_cr3:
+  dq 0
+smp_trampoline_stack:
+  dq 0
+smp_trampoline_entry:
+  dq 0
+smp_trampoline_cpu:
+  dq 0
+
+smp_trampoline_end:
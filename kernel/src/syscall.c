@@ -20,77 +20,62 @@
 #include <api/compiler.h>
 
 #include <cpu.h>
+#include <smp.h>
 #include <syscall.h>
+#include <multitasking.h>
 #include <debug.h>
 
 //- System Call API ------------------------------------------------------------
 
-static void syscall_debug(cpu_int_state_t *state) {
+// RFLAGS bits cleared when entering using SYSCALL (TF, IF, DF, AC)
+#define SYSCALL_FMASK ((1 << 8) | (1 << 9) | (1 << 10) | (1 << 18))
+
+extern void syscall_entry(void);
+
+void syscall_debug(cpu_int_state_t *state) {
 	DEBUG((int8_t *) state->state.rbx);
 	SYSCALL_RETURN_SUCCESS;
 }
 
-static void syscall_debug_hex(cpu_int_state_t *state) {
+void syscall_debug_hex(cpu_int_state_t *state) {
 	DEBUG_HEX(state->state.rbx);
 	SYSCALL_RETURN_SUCCESS;
 }
 
-static syscall_handler_t _syscall_handlers[] = {
-        // 0 - 7
-        &syscall_process_id,
-        &syscall_process_parent_id,
-        &syscall_process_exit,
-        &syscall_thread_id,
-        &syscall_thread_spawn,
-        &syscall_thread_join,
-        &syscall_thread_cancel,
-        0,
-
-        // 8 - 15
-        &syscall_process_create,
-        &syscall_process_kill,
-        &syscall_thread_create,
-        &syscall_thread_kill,
-        0, 0, 0, 0,
-
-        // 16 - 23
-        &syscall_mutex_lock,
-        &syscall_mutex_unlock,
-        &syscall_mutex_trylock,
-        0, 0, 0, 0, 0,
-
-        // 24 - 31
-        &syscall_ipc_send,
-        &syscall_ipc_respond,
-        &syscall_ipc_buffer_size,
-        &syscall_ipc_buffer_get,
-        &syscall_ipc_handler,
-        0, 0, 0,
-
-        // 32 - 39
-        &syscall_memory_alloc,
-        &syscall_memory_free,
-        &syscall_memory_map,
-        &syscall_memory_unmap,
-        0, 0, 0, 0,
-
-        // 40 - 47
-        &syscall_debug,
-        &syscall_debug_hex,
-        0, 0, 0, 0, 0, 0,
-
-        // 48 - 55
-        &syscall_futex_wake,
-        &syscall_futex_wait,
-        &syscall_futex_cmp_requeue,
-        0, 0, 0, 0, 0
-};
+void syscall_init(void) {
+    // Kernel segments on entry (0x08, 0x10), user segments on return with
+    // data before code (0x1B, 0x23)
+    cpu_msr_write(CPU_MSR_STAR, (0x10ULL << 48) | (0x08ULL << 32));
+    cpu_msr_write(CPU_MSR_LSTAR, (uintptr_t) &syscall_entry);
+
+    // Disable interrupts (like the interrupt gate), tracing, alignment
+    // checks and clear the direction flag on entry
+    cpu_msr_write(CPU_MSR_FMASK, SYSCALL_FMASK);
+
+    cpu_msr_write(CPU_MSR_EFER, cpu_msr_read(CPU_MSR_EFER) | CPU_MSR_EFER_SCE);
+}
+
+/**
+ * Handles a system call invoked using SYSCALL (called by syscall_entry).
+ *
+ * @param state The frame built by syscall_entry.
+ * @return The frame to return to (see cpu_int_handle).
+ */
+cpu_int_state_t *syscall_handle(cpu_int_state_t *state);
+cpu_int_state_t *syscall_handle(cpu_int_state_t *state) {
+    smp_cpu_t *cpu = smp_cpu();
+    cpu->resume = state;
+
+    syscall_handler_int(state);
+
+    return cpu->resume;
+}
 
 void syscall_handler_int(cpu_int_state_t *state) {
     // Check system call number
     uint64_t number = state->state.rax;
 
-    if (UNLIKELY(number > SYSCALL_COUNT) || 0 == _syscall_handlers[number]) {
+    if (UNLIKELY(number >= SYSCALL_COUNT) || 0 == syscall_handlers[number]) {
         // Log debug message and return
         DEBUG("Unknown system call ");
         DEBUG_HEX(number);
@@ -99,7 +84,27 @@ void syscall_handler_int(cpu_int_state_t *state) {
         return;
     }
 
+    if (UNLIKELY(!syscall_invoke(number, state)))
+        SYSCALL_SWITCH_THREAD;
+}
+
+bool syscall_invoke(uint64_t number, cpu_int_state_t *state) {
     // Get handler
-    syscall_handler_t handler = _syscall_handlers[number];
+    syscall_handler_t handler = syscall_handlers[number];
+
+    if (SYSCALL_LOCK_NONE == syscall_locks[number]) {
+        handler(state);
+        return true;
+    }
+
+    // Lock
+    bool exclusive = (SYSCALL_LOCK_GLOBAL == syscall_locks[number]);
+    process_t *process = process_lock_current(exclusive);
+
+    if (UNLIKELY(0 == process))
+        return false;
+
     handler(state);
+    process_unlock_current(process, exclusive);
+    return true;
 }
@@ -0,0 +1,118 @@
+; Carbon Operating System
+; Copyright (C) 2011 Lukas Heidemann
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+bits 64
+
+;; Imports
+extern syscall_handle
+extern thread_switch_finish
+extern cpu_int_return
+
+;; Offsets in smp_cpu_t (see smp.h)
+%define SMP_CPU_KERNEL_STACK 0x38
+%define SMP_CPU_SYSCALL_RSP 0x40
+
+;; Offset of the return address in cpu_int_state_t (see cpu.h)
+%define FRAME_RIP 0x90
+
+;; Selectors of the user segments (see loader/src/gdt.s)
+%define USER_DATA 0x1B
+%define USER_CODE 0x23
+
+;; Vector of the syscall interrupt (see syscall.h)
+%define SYSCALL_INT_VECTOR 0x80
+
+section .text
+
+; Entry for the SYSCALL instruction (see syscall_init)
+;
+; Builds the same frame as an interrupt from user mode on the thread's kernel
+; stack, with the user's R10 in place of RCX, which holds the return address.
+global syscall_entry
+syscall_entry:
+  swapgs                        ; Load per-CPU GS base
+  mov [gs:SMP_CPU_SYSCALL_RSP], rsp
+  mov rsp, [gs:SMP_CPU_KERNEL_STACK]
+
+  push qword USER_DATA          ; Push what an interrupt would
+  push qword [gs:SMP_CPU_SYSCALL_RSP]
+  push r11                      ; RFLAGS
+  push qword USER_CODE
+  push rcx                      ; RIP
+  push qword 0                  ; Error code
+  push qword SYSCALL_INT_VECTOR
+
+  push rax                      ; Push registers
+  push rbx
+  push r10                      ; Argument passed in R10 instead of RCX
+  push rdx
+  push rbp
+  push rdi
+  push rsi
+  push r8
+  push r9
+  push r10
+  push r11
+  push r12
+  push r13
+  push r14
+  push r15
+
+  xor rax, rax
+  mov ax, ds                    ; Back up data segment
+  push rax
+
+  mov rdi, rsp                  ; Frame as parameter (kept in RBX, which
+  mov rbx, rsp                  ; is preserved by the handler)
+  call syscall_handle
+
+  cmp rax, rbx                  ; Switched threads? Resume the other thread's
+  jne cpu_int_return            ; frame like an interrupt
+
+  mov rcx, [rax + FRAME_RIP]    ; Non-canonical return address? SYSRET
+  mov r11, 0x00007FFFFFFFFFFF   ; would fault in kernel mode then
+  cmp rcx, r11
+  ja cpu_int_return
+
+  mov rsp, rax
+  call thread_switch_finish
+
+  add rsp, 8                    ; Data segment has not been changed
+
+  pop r15                       ; Restore registers (RCX and R11 are
+  pop r14                       ; clobbered by SYSCALL anyway)
+  pop r13
+  pop r12
+  pop r11
+  pop r10
+  pop r9
+  pop r8
+  pop rsi
+  pop rdi
+  pop rbp
+  pop rdx
+  pop rcx
+  pop rbx
+  pop rax
+
+  add rsp, 16                   ; Skip error code and vector
+
+  mov rcx, [rsp]                ; Return address
+  mov r11, [rsp + 16]           ; RFLAGS
+  mov rsp, [rsp + 24]           ; User stack
+
+  swapgs                        ; Restore user GS base
+  o64 sysret
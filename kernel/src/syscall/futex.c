@@ -17,30 +17,11 @@
  */
 
 #include <api/types.h>
+#include <api/compiler.h>
 #include <syscall.h>
 #include <multitasking.h>
 #include <memory.h>
 
-static void _futex_wake_threads(uint32_t thread_count, uintptr_t futex_vaddr) {
-    thread_t *thread = process_current->threads;
-
-    while (0 != thread && thread_count > 0) {
-        // Is sleeping because of this futex?
-        if (thread->sleep_mode == THREAD_SLEEP_FUTEX &&
-            (uintptr_t) thread->sleep_ctx == futex_vaddr) {
-            // Wake thread up
-            thread->sleep_mode = 0;
-            thread_thaw(thread, 0);
-
-            // Decrease number of remaining threads
-            --thread_count;
-        }
-
-        // Next
-        thread = thread->next;
-    }
-}
-
 void syscall_futex_wake(cpu_int_state_t *state) {
     // Extract arguments
     uintptr_t futex_vaddr = state->state.rsi;
@@ -53,14 +34,14 @@ void syscall_futex_wake(cpu_int_state_t *state) {
     }
 
     // Wake n threads
-    _futex_wake_threads(thread_count, futex_vaddr);
+    futex_wake(process_current, futex_vaddr, thread_count);
 
     // Values were equal
     state->state.rax = 1;
     return;
 }
 
-void syscall_futex_wait(cpu_int_state_t *state) {
+static void _syscall_futex_wait(uint64_t timeout, cpu_int_state_t *state) {
     // Extract arguments
     uintptr_t futex_vaddr = state->state.rsi;
     uint32_t value_cmp = (uint32_t) state->state.rbx;
@@ -79,18 +60,36 @@ void syscall_futex_wait(cpu_int_state_t *state) {
         return;
     }
 
+    // Do not sleep when polling
+    if (0 == timeout) {
+        state->state.rax = 2;
+        return;
+    }
+
     // Enter sleep
+    thread_current->futex_waiter.futex = futex_vaddr;
+    thread_current->futex_waiter.index = 0;
+    futex_enqueue(process_current, thread_current, &thread_current->futex_waiter, 1);
+
     thread_current->sleep_mode = THREAD_SLEEP_FUTEX;
-    thread_current->sleep_ctx = (void *) futex_vaddr;
     thread_freeze(thread_current);
+    thread_timeout_set(thread_current, timeout);
 
-    // Ensure that 1 is returned on wakeup
+    // Ensure that 1 is returned on wakeup (2 on timeout)
     state->state.rax = 1;
 
     // Switch threads
     SYSCALL_SWITCH_THREAD;
 }
 
+void syscall_futex_wait(cpu_int_state_t *state) {
+    _syscall_futex_wait(THREAD_TIMEOUT_NONE, state);
+}
+
+void syscall_futex_wait_timeout(cpu_int_state_t *state) {
+    _syscall_futex_wait(state->state.rcx, state);
+}
+
 void syscall_futex_cmp_requeue(cpu_int_state_t *state) {
     // Extract arguments
     uintptr_t futex_vaddr = state->state.rsi;
@@ -114,25 +113,231 @@ void syscall_futex_cmp_requeue(cpu_int_state_t *state) {
     }
 
     // Wake up threads
-    _futex_wake_threads(wake_count, futex_vaddr);
+    futex_wake(process_current, futex_vaddr, wake_count);
 
     // Transfer threads
-    thread_t *thread = process_current->threads;
-
-    while (0 != thread && transfer_count > 0) {
-        // Is waiting on futex?
-        if (thread->sleep_mode == THREAD_SLEEP_FUTEX &&
-            thread->sleep_ctx == (void *) futex_vaddr) {
-            // Transfer thread
-            thread->sleep_ctx = (void *) target_vaddr;
-            --transfer_count;
-        }
-
-        // Next
-        thread = thread->next;
-    }
+    futex_requeue(process_current, futex_vaddr, target_vaddr, transfer_count);
 
     // Success
     state->state.rax = 1;
     return;
 }
+
+//- Direct Handoff -------------------------------------------------------------
+
+void syscall_futex_swap(cpu_int_state_t *state) {
+    // Extract arguments
+    uintptr_t wake_vaddr = state->state.rsi;
+    uintptr_t wait_vaddr = state->state.rdi;
+    uint32_t value_cmp = (uint32_t) state->state.rbx;
+    uint64_t timeout = state->state.rcx;
+
+    // Check
+    if (!memory_user_accessible(wake_vaddr & ~0xFFF) ||
+        !memory_user_accessible(wait_vaddr & ~0xFFF))
+        SYSCALL_RETURN_ERROR(0);
+
+    // Compare values (nothing is woken on mismatch)
+    if (value_cmp != *((uint32_t *) wait_vaddr))
+        SYSCALL_RETURN_ERROR(0);
+
+    // Wake a waiter (before waiting, so it is not the current thread itself,
+    // if both futexes are the same)
+    thread_t *next = futex_wake_one(process_current, wake_vaddr);
+
+    // Enter sleep
+    thread_current->futex_waiter.futex = wait_vaddr;
+    thread_current->futex_waiter.index = 0;
+    futex_enqueue(process_current, thread_current, &thread_current->futex_waiter, 1);
+
+    thread_current->sleep_mode = THREAD_SLEEP_FUTEX;
+    thread_freeze(thread_current);
+    thread_timeout_set(thread_current, timeout);
+
+    // Ensure that 1 is returned on wakeup (2 on timeout)
+    state->state.rax = 1;
+
+    // Run the waked thread on the rest of the time slice
+    if (0 == next) {
+        SYSCALL_SWITCH_THREAD;
+        return;
+    }
+
+    next->ttl = thread_current->ttl;
+    thread_switch(next, state);
+}
+
+//- Vectored Wait --------------------------------------------------------------
+
+STATIC_ASSERT(
+    SYSCALL_FUTEX_WAITV_MAX * sizeof(futex_waiter_t) <= HEAP_ALLOC_MAX,
+    "The waiters of futex_waitv must fit into a heap slot.");
+
+void syscall_futex_waitv(cpu_int_state_t *state) {
+    // Extract arguments
+    uintptr_t vector_vaddr = state->state.rsi;
+    uint32_t count = (uint32_t) state->state.rcx;
+    uint64_t timeout = state->state.rdx;
+
+    // Check
+    uintptr_t vector_end = vector_vaddr + count * sizeof(syscall_futex_waitv_t);
+
+    if (UNLIKELY(0 == count || count > SYSCALL_FUTEX_WAITV_MAX) ||
+        !memory_user_accessible(vector_vaddr & ~0xFFF) ||
+        !memory_user_accessible((vector_end - 1) & ~0xFFF))
+        SYSCALL_RETURN_ERROR(SYSCALL_FUTEX_WAITV_INVALID);
+
+    // Read the vector once, as it might be changed concurrently
+    syscall_futex_waitv_t *vector = (syscall_futex_waitv_t *) vector_vaddr;
+    futex_waiter_t *waiters = (futex_waiter_t *) heap_alloc(count * sizeof(futex_waiter_t));
+    uint32_t i;
+
+    for (i = 0; i < count; ++i) {
+        uintptr_t futex_vaddr = vector[i].futex;
+        uint32_t value_cmp = vector[i].value;
+
+        if (UNLIKELY(0 != (futex_vaddr & 3)) ||
+            !memory_user_accessible(futex_vaddr & ~0xFFF)) {
+            heap_free(waiters);
+            SYSCALL_RETURN_ERROR(SYSCALL_FUTEX_WAITV_INVALID);
+        }
+
+        // Compare values
+        if (value_cmp != *((uint32_t *) futex_vaddr)) {
+            heap_free(waiters);
+            SYSCALL_RETURN_ERROR(SYSCALL_FUTEX_WAITV_MISMATCH);
+        }
+
+        waiters[i].futex = futex_vaddr;
+        waiters[i].index = i;
+    }
+
+    // Do not sleep when polling
+    if (0 == timeout) {
+        heap_free(waiters);
+        SYSCALL_RETURN_ERROR(SYSCALL_FUTEX_WAITV_TIMEOUT);
+    }
+
+    // Enter sleep (the index of the waking futex is returned in RAX)
+    futex_enqueue(process_current, thread_current, waiters, count);
+
+    thread_current->sleep_mode = THREAD_SLEEP_FUTEX_VEC;
+    thread_freeze(thread_current);
+    thread_timeout_set(thread_current, timeout);
+
+    // Switch threads
+    SYSCALL_SWITCH_THREAD;
+}
+
+//- Priority Inheritance -------------------------------------------------------
+
+/**
+ * Lets the given owner of a priority inheritance futex run in place of the
+ * current thread, which waits for it.
+ *
+ * The scheduler has no priorities, so the waiter's time slice is donated
+ * instead: The owner is switched to directly, if it is runnable and not
+ * running on another processor.
+ *
+ * @param owner The owner of the futex.
+ * @param state The state of the current thread.
+ */
+static void _futex_pi_boost(thread_t *owner, cpu_int_state_t *state) {
+    if (0 == owner->frozen && 0 == (owner->on_cpu & THREAD_ON_CPU_MASK))
+        thread_switch(owner, state);
+    else
+        SYSCALL_SWITCH_THREAD;
+}
+
+void syscall_futex_lock_pi(cpu_int_state_t *state) {
+    // Extract arguments
+    uintptr_t futex_vaddr = state->state.rsi;
+
+    // Check
+    if (!memory_user_accessible(futex_vaddr & ~0xFFF))
+        SYSCALL_RETURN_ERROR(1);
+
+    // Other threads may lock and unlock in user space concurrently
+    volatile uint32_t *futex = (volatile uint32_t *) futex_vaddr;
+    uint32_t self = SYSCALL_FUTEX_PI_LOCKED | thread_current->tid;
+    thread_t *owner;
+
+    while (true) {
+        uint32_t value = *futex;
+        uint32_t waiters = value & SYSCALL_FUTEX_PI_WAITERS;
+
+        // Unlocked meanwhile?
+        if (0 == (value & SYSCALL_FUTEX_PI_LOCKED)) {
+            if (__sync_bool_compare_and_swap(futex, value, self | waiters))
+                SYSCALL_RETURN_SUCCESS;
+
+            continue;
+        }
+
+        // Already owned by the current thread?
+        uint32_t owner_tid = value & SYSCALL_FUTEX_PI_TID_MASK;
+
+        if (UNLIKELY(owner_tid == thread_current->tid))
+            SYSCALL_RETURN_ERROR(1);
+
+        // Owner terminated? Take over
+        owner = thread_get(process_current, owner_tid);
+
+        if (0 == owner || 0 != (owner->flags & THREAD_FLAG_TERMINATED)) {
+            if (__sync_bool_compare_and_swap(futex, value, self | waiters))
+                SYSCALL_RETURN_SUCCESS;
+
+            continue;
+        }
+
+        // Make the owner enter the kernel when unlocking
+        if (0 != waiters ||
+            __sync_bool_compare_and_swap(futex, value, value | SYSCALL_FUTEX_PI_WAITERS))
+            break;
+    }
+
+    // Enter sleep (the mode keeps futex_wake from waking the thread)
+    thread_current->sleep_mode = THREAD_SLEEP_FUTEX_PI;
+    thread_current->futex_waiter.futex = futex_vaddr;
+    thread_current->futex_waiter.index = 0;
+    futex_enqueue(process_current, thread_current, &thread_current->futex_waiter, 1);
+
+    thread_freeze(thread_current);
+
+    // Ensure that 0 is returned once handed over
+    state->state.rax = 0;
+
+    _futex_pi_boost(owner, state);
+}
+
+void syscall_futex_unlock_pi(cpu_int_state_t *state) {
+    // Extract arguments
+    uintptr_t futex_vaddr = state->state.rsi;
+
+    // Check
+    if (!memory_user_accessible(futex_vaddr & ~0xFFF))
+        SYSCALL_RETURN_ERROR(1);
+
+    // Owned by the current thread? (cannot be changed by others then)
+    volatile uint32_t *futex = (volatile uint32_t *) futex_vaddr;
+    uint32_t self = SYSCALL_FUTEX_PI_LOCKED | thread_current->tid;
+
+    if (UNLIKELY(self != (*futex & ~SYSCALL_FUTEX_PI_WAITERS)))
+        SYSCALL_RETURN_ERROR(1);
+
+    // Find the longest waiting thread and whether there are others
+    bool others;
+    thread_t *next = futex_wake_pi(process_current, futex_vaddr, &others);
+
+    // Nobody waiting?
+    if (0 == next) {
+        *futex = 0;
+        SYSCALL_RETURN_SUCCESS;
+    }
+
+    // Hand over before the thread can run
+    *futex = SYSCALL_FUTEX_PI_LOCKED | next->tid | (others ? SYSCALL_FUTEX_PI_WAITERS : 0);
+    thread_thaw(next, 0);
+
+    SYSCALL_RETURN_SUCCESS;
+}
@@ -18,18 +18,50 @@
 
 #include <api/types.h>
 #include <ipc.h>
+#include <pager.h>
 #include <syscall.h>
 #include <memory.h>
 #include <debug.h>
 
 //- System Calls - IPC ---------------------------------------------------------
 
-void syscall_ipc_send(cpu_int_state_t *state) {
-	// Extract arguments
+/**
+ * Checks the length of a message or response sent by the current thread.
+ *
+ * @param flags The flags of the message.
+ * @param length The length of the payload.
+ * @return Whether the payload fits the registers (short messages) or the
+ *  current thread's send buffer.
+ */
+static bool _syscall_ipc_length_valid(uint16_t flags, uint32_t length) {
+	if (0 != (flags & IPC_FLAG_SHORT))
+		return (length <= IPC_SHORT_SIZE);
+
+	return (length <= thread_current->ipc_buffer_sz[IPC_BUFFER_SEND]);
+}
+
+/**
+ * Sends a message to the process given in RDI.
+ *
+ * @param timeout The timeout for waiting for the response in nanoseconds (see
+ *  thread_timeout_set).
+ * @param short_message Whether the payload is passed in the registers (see
+ *  IPC_FLAG_SHORT).
+ * @param state The state of the current thread.
+ */
+static void _syscall_ipc_send(
+		uint64_t timeout,
+		bool short_message,
+		cpu_int_state_t *state) {
+	// Extract arguments (short messages are only sent by ipc_send_short, as
+	// the registers are returned on response)
 	uint32_t pid = (uint32_t) state->state.rdi;
-	uint16_t flags = (uint32_t) state->state.rbx;
+	uint16_t flags = (uint16_t) state->state.rbx & ~IPC_FLAG_SHORT;
 	uint32_t length = (uint32_t) state->state.rcx;
 
+	if (short_message)
+		flags |= IPC_FLAG_SHORT;
+
 	// Check if process exists
 	process_t *process_target = (pid == process_current->pid)
 			? process_current
@@ -38,32 +70,49 @@ void syscall_ipc_send(cpu_int_state_t *state) {
 	if (0 == process_target)
 		SYSCALL_RETURN_ERROR(1);
 
-	// Check handler
-	if (0 == process_target->message_handler)
-		SYSCALL_RETURN_ERROR(2);
-
 	// Check buffer size
-	if (length > thread_current->ipc_buffer_sz[IPC_BUFFER_SEND])
+	if (!_syscall_ipc_length_valid(flags, length))
 		SYSCALL_RETURN_ERROR(3);
 
-	// Spawn handler thread
-	thread_t *handler = thread_spawn(
-			process_target,
-			process_target->message_handler);
+	// Deliver to a waiting receiver or spawn a handler thread (both run
+	// frozen, as the handler is switched to directly)
+	thread_t *handler = ipc_receiver_take(process_target);
+	ipc_role_ctx_t *role_ctx;
 
-	// Set thread role
-	ipc_role_ctx_t *role_ctx =
-			(ipc_role_ctx_t *) heap_alloc(sizeof(ipc_role_ctx_t));
+	if (0 != handler) {
+		role_ctx = (ipc_role_ctx_t *) handler->role_ctx;
+
+		// Return value of ipc_reply_and_wait
+		handler->state->state.rax = 0;
+
+	} else {
+		// Check handler
+		if (0 == process_target->message_handler)
+			SYSCALL_RETURN_ERROR(2);
+
+		handler = thread_spawn(
+				process_target,
+				process_target->message_handler,
+				0);
 
+		if (UNLIKELY(0 == handler))
+			SYSCALL_RETURN_ERROR(5);
+
+		role_ctx = (ipc_role_ctx_t *) heap_alloc(sizeof(ipc_role_ctx_t));
+
+		handler->role = THREAD_ROLE_IPC_RECEIVER;
+		handler->role_ctx = role_ctx;
+	}
+
+	// Set thread role
 	role_ctx->flags = flags;
 	role_ctx->sender_process = process_current->pid;
 	role_ctx->sender_thread = thread_current->tid;
 
-	handler->role = THREAD_ROLE_IPC_RECEIVER;
-	handler->role_ctx = role_ctx;
-
-	// Move buffer to handler thread
-	if (length > 0)
+	// Copy registers or move buffer to handler thread
+	if (0 != (flags & IPC_FLAG_SHORT))
+		ipc_message_short(state, handler->state);
+	else if (length > 0)
 		ipc_buffer_move(
 				thread_current,
 				IPC_BUFFER_SEND,
@@ -78,61 +127,92 @@ void syscall_ipc_send(cpu_int_state_t *state) {
 			flags,
 			process_current->pid,
 			handler->tid,
-			&handler->state);
+			handler->state);
 
 	// Freeze the invoking thread, if a response is expected
-	if (0 == (flags & IPC_FLAG_IGNORE_RESPONSE))
+	if (0 == (flags & IPC_FLAG_IGNORE_RESPONSE)) {
+		thread_current->sleep_mode = THREAD_SLEEP_IPC;
+		thread_current->sleep_ctx = role_ctx;
 		thread_freeze(thread_current);
+		thread_timeout_set(thread_current, timeout);
+	}
+
+	// Error code on response (set on timeout otherwise)
+	state->state.rax = 0;
 
 	// Switch to handler thread
 	thread_switch(handler, state);
 }
 
-void syscall_ipc_respond(cpu_int_state_t *state) {
-	// Check thread role
-	if (THREAD_ROLE_IPC_RECEIVER != thread_current->role)
-		SYSCALL_RETURN_ERROR(1);
-
-	// Extract arguments
-	uint16_t flags = (uint16_t) state->state.rbx;
-	uint32_t length = (uint32_t) state->state.rcx;
+void syscall_ipc_send(cpu_int_state_t *state) {
+	_syscall_ipc_send(THREAD_TIMEOUT_NONE, false, state);
+}
 
-	// Check length
-	if (length > thread_current->ipc_buffer_sz[IPC_BUFFER_SEND])
-		SYSCALL_RETURN_ERROR(2);
+void syscall_ipc_send_timeout(cpu_int_state_t *state) {
+	_syscall_ipc_send(state->state.rdx, false, state);
+}
 
+/**
+ * Delivers the response to the message the current thread handles.
+ *
+ * Responses to short messages are short as well (see IPC_FLAG_SHORT).
+ *
+ * @param role_ctx The context of the message.
+ * @param flags The flags of the response.
+ * @param length The length of the response.
+ * @param state The state of the current thread.
+ * @return The thread to switch to or a null pointer, if the sender does not
+ *  wait for the response anymore.
+ */
+static thread_t *_syscall_ipc_reply(
+		ipc_role_ctx_t *role_ctx,
+		uint16_t flags,
+		uint32_t length,
+		cpu_int_state_t *state) {
 	// Extract info from role ctx
-	ipc_role_ctx_t *role_ctx = (ipc_role_ctx_t *) thread_current->role_ctx;
 	uint32_t sender_pid = role_ctx->sender_process;
 	uint32_t sender_tid = role_ctx->sender_thread;
 
 	// Sender process still exists?
 	process_t *sender_process = process_get(sender_pid);
 
-	if (0 == sender_process) {
-		thread_stop(process_current, thread_current);
-		thread_switch(scheduler_next(), state);
-		return;
-	}
+	if (0 == sender_process)
+		return 0;
 
 	// Sender thread still exists?
 	thread_t *sender_thread = thread_get(sender_process, sender_tid);
 
-	if (0 == sender_thread) {
-		thread_stop(process_current, thread_current);
-		thread_switch(scheduler_next(), state);
-		return;
-	}
+	if (0 == sender_thread)
+		return 0;
 
 	// Response ignored?
-	if (0 != (role_ctx->flags & IPC_FLAG_IGNORE_RESPONSE)) {
-		thread_stop(process_current, thread_current);
-		thread_switch(sender_thread, state);
-		return;
+	if (0 != (role_ctx->flags & IPC_FLAG_IGNORE_RESPONSE))
+		return sender_thread;
+
+	// Sender timed out meanwhile?
+	if (THREAD_SLEEP_IPC != sender_thread->sleep_mode ||
+			role_ctx != sender_thread->sleep_ctx)
+		return 0;
+
+	sender_thread->sleep_mode = 0;
+	sender_thread->sleep_ctx = 0;
+
+	// Page fault: Map the response's pages and let the sender retry, which
+	// is terminated if the fault has not been resolved
+	if (0 != (role_ctx->flags & IPC_FLAG_PAGE_FAULT)) {
+		if (!pager_resolve(role_ctx, length, sender_process)) {
+			process_terminate(sender_pid);
+			return 0;
+		}
+
+		thread_thaw(sender_thread, 0);
+		return sender_thread;
 	}
 
-	// Move buffer to sender thread (if length > 0)
-	if (length > 0)
+	// Copy registers or move buffer to sender thread (if length > 0)
+	if (0 != (flags & IPC_FLAG_SHORT))
+		ipc_message_short(state, sender_thread->state);
+	else if (length > 0)
 		ipc_buffer_move(
 				thread_current,
 				IPC_BUFFER_SEND,
@@ -147,14 +227,76 @@ void syscall_ipc_respond(cpu_int_state_t *state) {
 			flags,
 			process_current->pid,
 			sender_thread->tid,
-			&sender_thread->state);
+			sender_thread->state);
 
 	// Thaw thread
 	thread_thaw(sender_thread, 0);
+	return sender_thread;
+}
+
+void syscall_ipc_send_short(cpu_int_state_t *state) {
+	_syscall_ipc_send(THREAD_TIMEOUT_NONE, true, state);
+}
+
+void syscall_ipc_respond(cpu_int_state_t *state) {
+	// Check thread role
+	if (THREAD_ROLE_IPC_RECEIVER != thread_current->role)
+		SYSCALL_RETURN_ERROR(1);
+
+	// Extract arguments
+	ipc_role_ctx_t *role_ctx = (ipc_role_ctx_t *) thread_current->role_ctx;
+	uint16_t flags = ((uint16_t) state->state.rbx & ~IPC_FLAG_SHORT) |
+			(role_ctx->flags & IPC_FLAG_SHORT);
+	uint32_t length = (uint32_t) state->state.rcx;
+
+	// Check length
+	if (!_syscall_ipc_length_valid(flags, length))
+		SYSCALL_RETURN_ERROR(2);
+
+	// Respond
+	thread_t *next = _syscall_ipc_reply(role_ctx, flags, length, state);
 
 	// Stop current thread and switch to sender
 	thread_stop(process_current, thread_current);
-	thread_switch(sender_thread, state);
+	thread_switch((0 != next) ? next : scheduler_next(), state);
+}
+
+void syscall_ipc_reply_and_wait(cpu_int_state_t *state) {
+	// Extract arguments
+	uint16_t flags = (uint16_t) state->state.rbx & ~IPC_FLAG_SHORT;
+	uint32_t length = (uint32_t) state->state.rcx;
+
+	thread_t *next = 0;
+
+	if (THREAD_ROLE_IPC_RECEIVER == thread_current->role) {
+		ipc_role_ctx_t *role_ctx = (ipc_role_ctx_t *) thread_current->role_ctx;
+		flags |= (role_ctx->flags & IPC_FLAG_SHORT);
+
+		// Check length
+		if (!_syscall_ipc_length_valid(flags, length))
+			SYSCALL_RETURN_ERROR(2);
+
+		// Respond, keeping the role ctx for the next message
+		next = _syscall_ipc_reply(role_ctx, flags, length, state);
+
+	} else if (THREAD_ROLE_NORMAL == thread_current->role) {
+		// First wait: Nothing to respond to
+		thread_current->role_ctx = heap_alloc(sizeof(ipc_role_ctx_t));
+
+	} else {
+		SYSCALL_RETURN_ERROR(1);
+	}
+
+	// Wait for the next message (handler threads are frozen already)
+	if (0 == thread_current->frozen)
+		thread_freeze(thread_current);
+
+	ipc_receiver_wait(process_current, thread_current);
+
+	// Set when a message is delivered
+	state->state.rax = 0;
+
+	thread_switch((0 != next) ? next : scheduler_next(), state);
 }
 
 void syscall_ipc_buffer_size(cpu_int_state_t *state) {
@@ -163,7 +305,7 @@ void syscall_ipc_buffer_size(cpu_int_state_t *state) {
 	uint32_t size = (uint32_t) state->state.rcx;
 
 	// Check buffer
-	if (buffer > 2)
+	if (buffer > IPC_BUFFER_RECV)
 		SYSCALL_RETURN_ERROR(1);
 
 	// Check size
@@ -171,7 +313,7 @@ void syscall_ipc_buffer_size(cpu_int_state_t *state) {
 		SYSCALL_RETURN_ERROR(2);
 
 	// Resize buffer
-	ipc_buffer_resize(size, buffer, thread_current);
+	ipc_buffer_resize(size, buffer, thread_current, process_current);
 
 	// Return address
 	state->state.rbx = IPC_BUFFER_VADDR(buffer) +
@@ -185,7 +327,7 @@ void syscall_ipc_buffer_get(cpu_int_state_t *state) {
 	uint8_t buffer = state->state.rbx;
 
 	// Check buffer
-	if (buffer > 2)
+	if (buffer > IPC_BUFFER_RECV)
 		SYSCALL_RETURN_ERROR(1);
 
 	// Return address
@@ -204,3 +346,126 @@ void syscall_ipc_handler(cpu_int_state_t *state) {
 
 	SYSCALL_RETURN_SUCCESS;
 }
+
+//- System Calls - IPC Queues --------------------------------------------------
+
+/**
+ * Checks whether the given array of queue messages is accessible in the
+ * current address space.
+ *
+ * @param address The address of the array.
+ * @param count The number of messages.
+ * @param write Whether the array is written to.
+ * @return Whether the array is accessible.
+ */
+static bool _syscall_ipc_queue_region(uintptr_t address, uint32_t count, bool write) {
+	uintptr_t length = (uintptr_t) count * sizeof(ipc_queue_msg_t);
+
+	if (0 == count)
+		return true;
+
+	if (address >= MEMORY_USER_END || length > MEMORY_USER_END - address)
+		return false;
+
+	uintptr_t page;
+
+	for (page = address & ~0xFFF; page < address + length; page += 0x1000) {
+		if (write ? !memory_user_writeable(page) : !memory_user_accessible(page))
+			return false;
+	}
+
+	return true;
+}
+
+void syscall_ipc_queue_create(cpu_int_state_t *state) {
+	// Extract arguments
+	uint32_t slots = (uint32_t) state->state.rbx;
+
+	// Check size
+	if (0 == slots || slots > IPC_QUEUE_SLOTS_MAX)
+		SYSCALL_RETURN_ERROR(1);
+
+	ipc_queue_t *queue = ipc_queue_create(process_current, slots);
+
+	if (UNLIKELY(0 == queue))
+		SYSCALL_RETURN_ERROR(2);
+
+	state->state.rbx = queue->id;
+	SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_ipc_queue_send(cpu_int_state_t *state) {
+	// Extract arguments
+	uint32_t id = (uint32_t) state->state.rbx;
+	uintptr_t messages = state->state.rcx;
+	uint32_t count = (uint32_t) state->state.rdx;
+
+	// Check queue
+	ipc_queue_t *queue = ipc_queue_get(id);
+
+	if (0 == queue)
+		SYSCALL_RETURN_ERROR(1);
+
+	// Check messages (no more than the queue could take)
+	if (count > queue->capacity)
+		count = queue->capacity;
+
+	if (!_syscall_ipc_queue_region(messages, count, false))
+		SYSCALL_RETURN_ERROR(2);
+
+	// Append what fits
+	state->state.rbx = ipc_queue_push(
+			queue,
+			process_current->pid,
+			(ipc_queue_msg_t *) messages,
+			count);
+
+	SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_ipc_queue_receive(cpu_int_state_t *state) {
+	// Extract arguments
+	uint32_t id = (uint32_t) state->state.rbx;
+	uintptr_t messages = state->state.rcx;
+	uint32_t count = (uint32_t) state->state.rdx;
+	uint8_t flags = (uint8_t) state->state.rsi;
+
+	// Check queue
+	ipc_queue_t *queue = ipc_queue_get(id);
+
+	if (0 == queue || queue->owner != process_current->pid)
+		SYSCALL_RETURN_ERROR(1);
+
+	// Check messages
+	if (count > queue->capacity)
+		count = queue->capacity;
+
+	if (!_syscall_ipc_queue_region(messages, count, true))
+		SYSCALL_RETURN_ERROR(2);
+
+	// Wait until notified, if empty (returns zero messages, see
+	// ipc_queue_wait)
+	if (queue->head == queue->tail && count > 0 &&
+			0 != (flags & SYSCALL_IPC_QUEUE_WAIT)) {
+		ipc_queue_wait(queue, thread_current);
+		thread_switch(scheduler_next(), state);
+		return;
+	}
+
+	state->state.rbx = ipc_queue_pop(queue, (ipc_queue_msg_t *) messages, count);
+	SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_ipc_queue_destroy(cpu_int_state_t *state) {
+	// Extract arguments
+	uint32_t id = (uint32_t) state->state.rbx;
+
+	// Check queue
+	ipc_queue_t *queue = ipc_queue_get(id);
+
+	if (0 == queue || queue->owner != process_current->pid)
+		SYSCALL_RETURN_ERROR(1);
+
+	ipc_queue_destroy(process_current, queue);
+	SYSCALL_RETURN_SUCCESS;
+}
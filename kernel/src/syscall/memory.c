@@ -23,6 +23,8 @@
 #include <debug.h>
 #include <multitasking.h>
 #include <memory.h>
+#include <pager.h>
+#include <shm.h>
 
 //- System Calls - Memory ------------------------------------------------------
 
@@ -109,3 +111,62 @@ void syscall_memory_unmap(cpu_int_state_t *state) {
 
     SYSCALL_RETURN_SUCCESS;
 }
+
+void syscall_pager_register(cpu_int_state_t *state) {
+    // Extract parameters
+    uintptr_t start = state->state.rbx;
+    size_t length = state->state.rcx;
+    uint32_t pager = (uint32_t) state->state.rdx;
+
+    if (!pager_register(process_current, start, length, pager))
+        SYSCALL_RETURN_ERROR(1);
+
+    SYSCALL_RETURN_SUCCESS;
+}
+
+//- System Calls - Shared Memory -----------------------------------------------
+
+void syscall_shm_create(cpu_int_state_t *state) {
+    // Extract parameters
+    uintptr_t address = state->state.rbx;
+    size_t pages = state->state.rcx;
+
+    uint32_t id = shm_create(process_current, address, pages);
+
+    if (SHM_NONE == id)
+        SYSCALL_RETURN_ERROR(1);
+
+    state->state.rbx = id;
+    SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_shm_grant(cpu_int_state_t *state) {
+    // Extract parameters
+    uint32_t id = (uint32_t) state->state.rbx;
+    uint32_t pid = (uint32_t) state->state.rcx;
+    bool writeable = (0 != (state->state.rdx & SYSCALL_MEMORY_FLAG_WRITEABLE));
+
+    if (!shm_grant(process_current, id, pid, writeable))
+        SYSCALL_RETURN_ERROR(1);
+
+    SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_shm_map(cpu_int_state_t *state) {
+    // Extract parameters
+    uint32_t id = (uint32_t) state->state.rbx;
+    uintptr_t address = state->state.rcx;
+    bool writeable = (0 != (state->state.rdx & SYSCALL_MEMORY_FLAG_WRITEABLE));
+
+    if (!shm_map(process_current, id, address, writeable))
+        SYSCALL_RETURN_ERROR(1);
+
+    SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_shm_unmap(cpu_int_state_t *state) {
+    if (!shm_unmap(process_current, state->state.rbx))
+        SYSCALL_RETURN_ERROR(1);
+
+    SYSCALL_RETURN_SUCCESS;
+}
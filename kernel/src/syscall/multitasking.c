@@ -17,10 +17,15 @@
  */
 
 #include <api/types.h>
+#include <api/string.h>
 #include <syscall.h>
+#include <binary.h>
+#include <ipc.h>
 #include <debug.h>
 #include <multitasking.h>
 #include <memory.h>
+#include <irq.h>
+#include <kdata.h>
 
 //- System Calls - Multitasking - Common ---------------------------------------
 
@@ -71,27 +76,30 @@ static void _syscall_thread_create(
 		uintptr_t entry_point,
 		uintptr_t args,
 		uintptr_t ret,
+		uintptr_t stack_limit,
 		process_t *process,
 		cpu_int_state_t *state) {
 
     // Spawn new thread
-    thread_t *thread = thread_spawn(process, entry_point);
+    thread_t *thread = thread_spawn(process, entry_point, stack_limit);
 
-    // Write return address to thread's stack
+    if (UNLIKELY(0 == thread))
+        SYSCALL_RETURN_ERROR(3);
+
+    // Write return address to thread's stack (mapped by stack_create)
     if (process->addr_space != process_current->addr_space)
         memory_space_switch(process->addr_space);
 
-    stack_resize(&thread->stack, 0x1000, process);
     uintptr_t *ptr = (uintptr_t *) (thread->stack.address - sizeof(uintptr_t));
     *ptr = ret;
 
     if (process->addr_space != process_current->addr_space)
         memory_space_switch(process_current->addr_space);
 
-    thread->state.rsp -= 0x8;
+    thread->state->rsp -= 0x8;
 
     // Argument pointer in rdi register
-    thread->state.state.rdi = args;
+    thread->state->state.rdi = args;
 
     // Thread's id
     state->state.rbx = thread->tid;
@@ -102,6 +110,44 @@ static void _syscall_thread_create(
     SYSCALL_RETURN_SUCCESS;
 }
 
+static void _syscall_thread_join(uint64_t timeout, cpu_int_state_t *state) {
+    // Extract arguments
+    uint32_t awaited_thread_id = (uint32_t) state->state.rbx;
+
+    // Check if the thread is equal to the invoking
+    if (awaited_thread_id == thread_current->tid)
+        SYSCALL_RETURN_ERROR(1);
+
+    // Check if the thread exists
+    thread_t *awaited_thread = thread_get(process_current, awaited_thread_id);
+
+    if (0 == awaited_thread)
+        SYSCALL_RETURN_ERROR(2);
+
+    // Check if the thread is detached
+    if (0 != (awaited_thread->flags & THREAD_FLAG_DETACHED))
+        SYSCALL_RETURN_ERROR(3);
+
+    // Do not sleep when polling
+    if (0 == timeout && 0 == (awaited_thread->flags & THREAD_FLAG_TERMINATED))
+        SYSCALL_RETURN_ERROR(4);
+
+    // Sleep for join
+    if (!thread_join_sleep(thread_current, awaited_thread)) {
+    	// Thread already terminated, result therefore is already there
+    	state->state.rbx = (uintptr_t) awaited_thread->result_ptr;
+    	SYSCALL_RETURN_SUCCESS;
+
+    } else {
+        // Arm timeout (sets the error code when expired)
+        state->state.rax = 0;
+        thread_timeout_set(thread_current, timeout);
+
+    	// Switch thread
+		SYSCALL_SWITCH_THREAD;
+    }
+}
+
 //- System Calls - Multitasking - Public ---------------------------------------
 
 void syscall_process_id(cpu_int_state_t *state) {
@@ -135,32 +181,40 @@ void syscall_thread_cancel(cpu_int_state_t *state) {
 }
 
 void syscall_thread_join(cpu_int_state_t *state) {
+    _syscall_thread_join(THREAD_TIMEOUT_NONE, state);
+}
+
+void syscall_thread_join_timeout(cpu_int_state_t *state) {
+    _syscall_thread_join(state->state.rcx, state);
+}
+
+void syscall_thread_sleep(cpu_int_state_t *state) {
     // Extract arguments
-    uint32_t awaited_thread_id = (uint32_t) state->state.rbx;
+    uint64_t timeout = state->state.rbx;
 
-    // Check if the thread is equal to the invoking
-    if (awaited_thread_id == thread_current->tid)
-        SYSCALL_RETURN_ERROR(1);
+    state->state.rax = 0;
 
-    // Check if the thread exists
-    thread_t *awaited_thread = thread_get(process_current, awaited_thread_id);
+    // Only yield
+    if (0 == timeout) {
+        SYSCALL_SWITCH_THREAD;
+        return;
+    }
 
-    if (0 == awaited_thread)
-        SYSCALL_RETURN_ERROR(2);
+    // Sleep until the timeout expires
+    thread_current->sleep_mode = THREAD_SLEEP_TIMER;
+    thread_freeze(thread_current);
+    thread_timeout_set(thread_current, timeout);
 
-    // Check if the thread is detached
-    if (0 != (awaited_thread->flags & THREAD_FLAG_DETACHED))
-        SYSCALL_RETURN_ERROR(3);
+    SYSCALL_SWITCH_THREAD;
+}
 
-    // Sleep for join
-    if (!thread_join_sleep(thread_current, awaited_thread)) {
-    	// Thread already terminated, result therefore is already there
-    	state->state.rbx = (uintptr_t) awaited_thread->result_ptr;
+void syscall_clock_get(cpu_int_state_t *state) {
+    // Account elapsed time (only the bootstrap processor keeps the time)
+    if (0 == smp_cpu()->index)
+        irq_timer_update();
 
-    } else {
-    	// Switch thread
-		SYSCALL_SWITCH_THREAD;
-    }
+    state->state.rbx = kdata_time_ns();
+    SYSCALL_RETURN_SUCCESS;
 }
 
 void syscall_process_exit(cpu_int_state_t *state) {
@@ -176,9 +230,10 @@ void syscall_thread_spawn(cpu_int_state_t *state) {
 	uintptr_t entry_point = state->state.rdi;
 	uintptr_t args = state->state.rsi;
 	uintptr_t ret = state->state.rdx;
+	uintptr_t stack_limit = state->state.rcx;
 
 	// Call common implementation
-	_syscall_thread_create(entry_point, args, ret, process_current, state);
+	_syscall_thread_create(entry_point, args, ret, stack_limit, process_current, state);
 }
 
 //- System Calls - Multitasking - Only Root ------------------------------------
@@ -222,7 +277,7 @@ void syscall_thread_create(cpu_int_state_t *state) {
 		SYSCALL_RETURN_ERROR(2);
 
 	// Call common implementation
-	_syscall_thread_create(entry_point, args, ret, process, state);
+	_syscall_thread_create(entry_point, args, ret, 0, process, state);
 }
 
 void syscall_process_kill(cpu_int_state_t *state) {
@@ -260,8 +315,111 @@ void syscall_process_create(cpu_int_state_t *state) {
 	if (0 == parent_proc)
 		SYSCALL_RETURN_ERROR(2);
 
+	// Spawn new process (before creating its address space, as this may fail)
+	process_t *proc = process_spawn(0, parent_proc);
+
+	if (UNLIKELY(0 == proc))
+		SYSCALL_RETURN_ERROR(3);
+
+	proc->addr_space = memory_space_create();
+
+	// Return the new process's pid
+	state->state.rbx = proc->pid;
+
+	SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_process_spawn_image(cpu_int_state_t *state) {
+	// Check permissions
+	if (!SYSCALL_ROOT)
+		SYSCALL_RETURN_ERROR(1);
+
+	// Extract arguments
+	uint8_t source = (uint8_t) state->state.rbx;
+	size_t length = state->state.rcx;
+	uint32_t parent_pid = (uint32_t) state->state.rdx;
+
+	// Get parent process
+	process_t *parent_proc = process_get(parent_pid);
+
+	if (0 == parent_proc)
+		SYSCALL_RETURN_ERROR(2);
+
+	// Get image
+	void *image;
+	uintptr_t buffer_addr = 0;
+
+	if (SYSCALL_IMAGE_BUFFER == source) {
+		if (0 == length || length > thread_current->ipc_buffer_sz[IPC_BUFFER_SEND])
+			SYSCALL_RETURN_ERROR(3);
+
+		buffer_addr = IPC_BUFFER_VADDR(IPC_BUFFER_SEND) + IPC_BUFFER_SIZE * thread_current->tid;
+		image = (void *) buffer_addr;
+
+	} else if (SYSCALL_IMAGE_MODULE == source) {
+		boot_info_mod_t *mod = binary_module(length);
+
+		if (0 == mod)
+			SYSCALL_RETURN_ERROR(3);
+
+		image = (void *) mod->mapping;
+		length = mod->length;
+
+	} else {
+		SYSCALL_RETURN_ERROR(3);
+	}
+
+	// Check and load the image with a single switch to a new address space,
+	// before the process exists. The send buffer is not mapped there, so its
+	// page table is lent to the new address space meanwhile (modules are
+	// mapped in every address space). This also keeps other threads from
+	// changing the image after it has been checked.
+	uintptr_t addr_space = memory_space_create();
+	uint64_t buffer_pt = 0;
+
+	if (0 != buffer_addr)
+		buffer_pt = memory_struct_remove(buffer_addr, PAGE_STRUCT_PT);
+
+	uintptr_t old_space = memory_space_switch(addr_space);
+
+	if (0 != buffer_addr)
+		memory_struct_insert(buffer_addr, PAGE_STRUCT_PT, buffer_pt);
+
+	bool valid = binary_check_elf64(image, length);
+	uintptr_t entry_point = valid ? binary_load_elf64(image, PAGE_FLAG_USER) : 0;
+
+	if (0 != buffer_addr)
+		memory_struct_remove(buffer_addr, PAGE_STRUCT_PT);
+
+	memory_space_switch(old_space);
+
+	if (0 != buffer_addr)
+		memory_struct_insert(buffer_addr, PAGE_STRUCT_PT, buffer_pt);
+
+	if (!valid) {
+		memory_space_release(addr_space);
+		SYSCALL_RETURN_ERROR(4);
+	}
+
 	// Spawn new process
-	process_t *proc = process_spawn(memory_space_create(), parent_proc);
+	process_t *proc = process_spawn(0, parent_proc);
+
+	if (UNLIKELY(0 == proc)) {
+		memory_space_release(addr_space);
+		SYSCALL_RETURN_ERROR(5);
+	}
+
+	proc->addr_space = addr_space;
+
+	// Start main thread
+	thread_t *thread = thread_spawn(proc, entry_point, 0);
+
+	if (UNLIKELY(0 == thread)) {
+		process_terminate(proc->pid);
+		SYSCALL_RETURN_ERROR(5);
+	}
+
+	thread_thaw(thread, 0);
 
 	// Return the new process's pid
 	state->state.rbx = proc->pid;
@@ -37,8 +37,9 @@ void syscall_mutex_lock(cpu_int_state_t *state) {
 	_CHECK_ACCESSIBLE(mutex_vaddr);
 
 	// Not locked yet?
-	// Note that this is not multiprocessor and the kernel is not preemptible,
-	// therefore no atomic operations are required here.
+	// Note that mutex system calls of a process are serialized by the process
+	// lock and the kernel is not preemptible, therefore no atomic operations
+	// are required here.
 	uint8_t *mutex_ptr = (uint8_t *) mutex_vaddr;
 
 	if (0 == *mutex_ptr) {
@@ -0,0 +1,175 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <api/types.h>
+#include <api/string.h>
+#include <api/map.h>
+
+#include <syscall.h>
+#include <multitasking.h>
+#include <memory.h>
+
+//- Submission Ring - Internal -------------------------------------------------
+
+/**
+ * Processes the submissions from head to tail (validated by the caller) and
+ * posts their completions, stopping early when the completion queue is full.
+ *
+ * Must be called holding the current process's ring lock.
+ *
+ * @param ring The current process's ring.
+ * @param head The submission queue's head.
+ * @param tail The submission queue's tail.
+ * @param processed Set to the number of processed submissions.
+ * @return False, if the current process is terminated by another processor
+ *         meanwhile.
+ */
+static bool _syscall_ring_process(
+        syscall_ring_t *ring,
+        uint32_t head,
+        uint32_t tail,
+        uint32_t *processed) {
+    uint32_t cq_tail = ring->cq_tail;
+    bool terminated = false;
+
+    *processed = 0;
+
+    while (head != tail) {
+        // Completion queue full?
+        if (cq_tail - ring->cq_head >= SYSCALL_RING_ENTRIES)
+            break;
+
+        // Copy, as the process might change the submission meanwhile
+        syscall_ring_sqe_t sqe = ring->sq[head % SYSCALL_RING_ENTRIES];
+
+        cpu_int_state_t entry;
+        memset(&entry, 0, sizeof(cpu_int_state_t));
+
+        entry.state.rax = sqe.number;
+        entry.state.rbx = sqe.rbx;
+        entry.state.rcx = sqe.rcx;
+        entry.state.rdx = sqe.rdx;
+        entry.state.rsi = sqe.rsi;
+        entry.state.rdi = sqe.rdi;
+
+        if (sqe.number >= SYSCALL_COUNT || !syscall_batch[sqe.number]) {
+            entry.state.rax = SYSCALL_RING_INVALID;
+
+        } else if (UNLIKELY(!syscall_invoke(sqe.number, &entry))) {
+            terminated = true;
+            break;
+        }
+
+        // Post completion
+        syscall_ring_cqe_t *cqe = &ring->cq[cq_tail % SYSCALL_RING_ENTRIES];
+        cqe->user_data = sqe.user_data;
+        cqe->rax = entry.state.rax;
+        cqe->rbx = entry.state.rbx;
+
+        ++head;
+        ++cq_tail;
+        ++(*processed);
+    }
+
+    // Publish completions after their entries
+    __sync_synchronize();
+    ring->cq_tail = cq_tail;
+    ring->sq_head = head;
+
+    return !terminated;
+}
+
+//- Submission Ring - Polling --------------------------------------------------
+
+bool syscall_ring_poll(void) {
+    syscall_ring_t *ring = (syscall_ring_t *) process_current->ring;
+
+    if (0 == ring)
+        return true;
+
+    // Being processed on another processor? Left to it
+    if (!spinlock_try_acquire(&process_current->ring_lock))
+        return true;
+
+    uint32_t head = ring->sq_head;
+    uint32_t tail = ring->sq_tail;
+    uint32_t processed;
+    bool alive = true;
+
+    // Corrupt indices are reported by the next ring_enter
+    if (LIKELY(tail - head <= SYSCALL_RING_ENTRIES))
+        alive = _syscall_ring_process(ring, head, tail, &processed);
+
+    spinlock_release(&process_current->ring_lock);
+    return alive;
+}
+
+//- System Calls - Submission Ring ---------------------------------------------
+
+void syscall_ring_setup(cpu_int_state_t *state) {
+    // Already set up?
+    if (0 != process_current->ring) {
+        state->state.rbx = process_current->ring;
+        SYSCALL_RETURN_SUCCESS;
+    }
+
+    uintptr_t frame = frame_alloc();
+
+    // Map and clear (the process's space is the current one)
+    memory_map(MEMORY_RING_VADDR, frame, PAGE_FLAG_USER | PAGE_FLAG_WRITEABLE);
+    memset((void *) MEMORY_RING_VADDR, 0, PAGE_SIZE);
+
+    // Publish only once initialized, as ring_enter does not lock the process
+    process_current->ring = MEMORY_RING_VADDR;
+
+    state->state.rbx = MEMORY_RING_VADDR;
+    SYSCALL_RETURN_SUCCESS;
+}
+
+void syscall_ring_enter(cpu_int_state_t *state) {
+    syscall_ring_t *ring = (syscall_ring_t *) process_current->ring;
+
+    if (UNLIKELY(0 == ring))
+        SYSCALL_RETURN_ERROR(1);
+
+    spinlock_acquire(&process_current->ring_lock);
+
+    // Only process what has been submitted so far
+    uint32_t head = ring->sq_head;
+    uint32_t tail = ring->sq_tail;
+
+    if (UNLIKELY(tail - head > SYSCALL_RING_ENTRIES)) {
+        spinlock_release(&process_current->ring_lock);
+        SYSCALL_RETURN_ERROR(2);
+    }
+
+    uint32_t processed;
+    bool alive = _syscall_ring_process(ring, head, tail, &processed);
+
+    spinlock_release(&process_current->ring_lock);
+
+    // Process terminated by another processor meanwhile?
+    if (UNLIKELY(!alive)) {
+        SYSCALL_SWITCH_THREAD;
+        return;
+    }
+
+    state->state.rbx = processed;
+    SYSCALL_RETURN_SUCCESS;
+}
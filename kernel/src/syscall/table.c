@@ -0,0 +1,164 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Generated from syscalls.def by tools/syscalls.awk, do not edit
+// (regenerate using "make syscalls").
+
+#include <api/types.h>
+#include <syscall.h>
+
+//- System Call Table ----------------------------------------------------------
+
+syscall_handler_t syscall_handlers[SYSCALL_COUNT] = {
+    [SYSCALL_NR_PROCESS_ID] = &syscall_process_id,
+    [SYSCALL_NR_PROCESS_PARENT_ID] = &syscall_process_parent_id,
+    [SYSCALL_NR_PROCESS_EXIT] = &syscall_process_exit,
+    [SYSCALL_NR_THREAD_ID] = &syscall_thread_id,
+    [SYSCALL_NR_THREAD_SPAWN] = &syscall_thread_spawn,
+    [SYSCALL_NR_THREAD_JOIN] = &syscall_thread_join,
+    [SYSCALL_NR_THREAD_CANCEL] = &syscall_thread_cancel,
+    [SYSCALL_NR_THREAD_JOIN_TIMEOUT] = &syscall_thread_join_timeout,
+    [SYSCALL_NR_PROCESS_CREATE] = &syscall_process_create,
+    [SYSCALL_NR_PROCESS_KILL] = &syscall_process_kill,
+    [SYSCALL_NR_THREAD_CREATE] = &syscall_thread_create,
+    [SYSCALL_NR_THREAD_KILL] = &syscall_thread_kill,
+    [SYSCALL_NR_THREAD_SLEEP] = &syscall_thread_sleep,
+    [SYSCALL_NR_CLOCK_GET] = &syscall_clock_get,
+    [SYSCALL_NR_RING_SETUP] = &syscall_ring_setup,
+    [SYSCALL_NR_RING_ENTER] = &syscall_ring_enter,
+    [SYSCALL_NR_PROCESS_SPAWN_IMAGE] = &syscall_process_spawn_image,
+    [SYSCALL_NR_MUTEX_LOCK] = &syscall_mutex_lock,
+    [SYSCALL_NR_MUTEX_UNLOCK] = &syscall_mutex_unlock,
+    [SYSCALL_NR_MUTEX_TRYLOCK] = &syscall_mutex_trylock,
+    [SYSCALL_NR_IPC_SEND] = &syscall_ipc_send,
+    [SYSCALL_NR_IPC_RESPOND] = &syscall_ipc_respond,
+    [SYSCALL_NR_IPC_BUFFER_SIZE] = &syscall_ipc_buffer_size,
+    [SYSCALL_NR_IPC_BUFFER_GET] = &syscall_ipc_buffer_get,
+    [SYSCALL_NR_IPC_HANDLER] = &syscall_ipc_handler,
+    [SYSCALL_NR_IPC_SEND_TIMEOUT] = &syscall_ipc_send_timeout,
+    [SYSCALL_NR_IPC_REPLY_AND_WAIT] = &syscall_ipc_reply_and_wait,
+    [SYSCALL_NR_IPC_SEND_SHORT] = &syscall_ipc_send_short,
+    [SYSCALL_NR_IPC_QUEUE_CREATE] = &syscall_ipc_queue_create,
+    [SYSCALL_NR_IPC_QUEUE_SEND] = &syscall_ipc_queue_send,
+    [SYSCALL_NR_IPC_QUEUE_RECEIVE] = &syscall_ipc_queue_receive,
+    [SYSCALL_NR_IPC_QUEUE_DESTROY] = &syscall_ipc_queue_destroy,
+    [SYSCALL_NR_MEMORY_ALLOC] = &syscall_memory_alloc,
+    [SYSCALL_NR_MEMORY_FREE] = &syscall_memory_free,
+    [SYSCALL_NR_MEMORY_MAP] = &syscall_memory_map,
+    [SYSCALL_NR_MEMORY_UNMAP] = &syscall_memory_unmap,
+    [SYSCALL_NR_PAGER_REGISTER] = &syscall_pager_register,
+    [SYSCALL_NR_SHM_CREATE] = &syscall_shm_create,
+    [SYSCALL_NR_SHM_GRANT] = &syscall_shm_grant,
+    [SYSCALL_NR_SHM_MAP] = &syscall_shm_map,
+    [SYSCALL_NR_SHM_UNMAP] = &syscall_shm_unmap,
+    [SYSCALL_NR_DEBUG] = &syscall_debug,
+    [SYSCALL_NR_DEBUG_HEX] = &syscall_debug_hex,
+    [SYSCALL_NR_FUTEX_WAKE] = &syscall_futex_wake,
+    [SYSCALL_NR_FUTEX_WAIT] = &syscall_futex_wait,
+    [SYSCALL_NR_FUTEX_CMP_REQUEUE] = &syscall_futex_cmp_requeue,
+    [SYSCALL_NR_FUTEX_WAIT_TIMEOUT] = &syscall_futex_wait_timeout,
+    [SYSCALL_NR_FUTEX_LOCK_PI] = &syscall_futex_lock_pi,
+    [SYSCALL_NR_FUTEX_UNLOCK_PI] = &syscall_futex_unlock_pi,
+    [SYSCALL_NR_FUTEX_WAITV] = &syscall_futex_waitv,
+    [SYSCALL_NR_FUTEX_SWAP] = &syscall_futex_swap,
+};
+
+uint8_t syscall_locks[SYSCALL_COUNT] = {
+    [SYSCALL_NR_PROCESS_ID] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_PROCESS_PARENT_ID] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_PROCESS_EXIT] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_THREAD_ID] = SYSCALL_LOCK_NONE,
+    [SYSCALL_NR_THREAD_SPAWN] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_THREAD_JOIN] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_THREAD_CANCEL] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_THREAD_JOIN_TIMEOUT] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_PROCESS_CREATE] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_PROCESS_KILL] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_THREAD_CREATE] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_THREAD_KILL] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_THREAD_SLEEP] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_CLOCK_GET] = SYSCALL_LOCK_NONE,
+    [SYSCALL_NR_RING_SETUP] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_RING_ENTER] = SYSCALL_LOCK_NONE,
+    [SYSCALL_NR_PROCESS_SPAWN_IMAGE] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_MUTEX_LOCK] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_MUTEX_UNLOCK] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_MUTEX_TRYLOCK] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_IPC_SEND] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_RESPOND] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_BUFFER_SIZE] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_IPC_BUFFER_GET] = SYSCALL_LOCK_NONE,
+    [SYSCALL_NR_IPC_HANDLER] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_IPC_SEND_TIMEOUT] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_REPLY_AND_WAIT] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_SEND_SHORT] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_QUEUE_CREATE] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_QUEUE_SEND] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_QUEUE_RECEIVE] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_IPC_QUEUE_DESTROY] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_MEMORY_ALLOC] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_MEMORY_FREE] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_MEMORY_MAP] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_MEMORY_UNMAP] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_PAGER_REGISTER] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_SHM_CREATE] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_SHM_GRANT] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_SHM_MAP] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_SHM_UNMAP] = SYSCALL_LOCK_GLOBAL,
+    [SYSCALL_NR_DEBUG] = SYSCALL_LOCK_NONE,
+    [SYSCALL_NR_DEBUG_HEX] = SYSCALL_LOCK_NONE,
+    [SYSCALL_NR_FUTEX_WAKE] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_WAIT] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_CMP_REQUEUE] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_WAIT_TIMEOUT] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_LOCK_PI] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_UNLOCK_PI] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_WAITV] = SYSCALL_LOCK_PROCESS,
+    [SYSCALL_NR_FUTEX_SWAP] = SYSCALL_LOCK_PROCESS,
+};
+
+bool syscall_batch[SYSCALL_COUNT] = {
+    [SYSCALL_NR_PROCESS_ID] = true,
+    [SYSCALL_NR_PROCESS_PARENT_ID] = true,
+    [SYSCALL_NR_THREAD_ID] = true,
+    [SYSCALL_NR_THREAD_SPAWN] = true,
+    [SYSCALL_NR_PROCESS_CREATE] = true,
+    [SYSCALL_NR_CLOCK_GET] = true,
+    [SYSCALL_NR_MUTEX_UNLOCK] = true,
+    [SYSCALL_NR_MUTEX_TRYLOCK] = true,
+    [SYSCALL_NR_IPC_BUFFER_SIZE] = true,
+    [SYSCALL_NR_IPC_BUFFER_GET] = true,
+    [SYSCALL_NR_IPC_HANDLER] = true,
+    [SYSCALL_NR_IPC_QUEUE_CREATE] = true,
+    [SYSCALL_NR_IPC_QUEUE_SEND] = true,
+    [SYSCALL_NR_IPC_QUEUE_DESTROY] = true,
+    [SYSCALL_NR_MEMORY_ALLOC] = true,
+    [SYSCALL_NR_MEMORY_FREE] = true,
+    [SYSCALL_NR_MEMORY_MAP] = true,
+    [SYSCALL_NR_MEMORY_UNMAP] = true,
+    [SYSCALL_NR_PAGER_REGISTER] = true,
+    [SYSCALL_NR_SHM_CREATE] = true,
+    [SYSCALL_NR_SHM_GRANT] = true,
+    [SYSCALL_NR_SHM_MAP] = true,
+    [SYSCALL_NR_SHM_UNMAP] = true,
+    [SYSCALL_NR_DEBUG] = true,
+    [SYSCALL_NR_DEBUG_HEX] = true,
+    [SYSCALL_NR_FUTEX_WAKE] = true,
+    [SYSCALL_NR_FUTEX_CMP_REQUEUE] = true,
+    [SYSCALL_NR_FUTEX_UNLOCK_PI] = true,
+};
@@ -0,0 +1,40 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdint.h>
+
+//- API - Clock ----------------------------------------------------------------
+
+/**
+ * Returns the time elapsed since the system has been started.
+ *
+ * @return The time in nanoseconds.
+ */
+uint64_t clock_get(void);
+
+/**
+ * Returns the number of timer ticks the kernel has accounted since the system
+ * has been started.
+ *
+ * Does not enter the kernel, so the ticks elapsed since the kernel accounted
+ * them last (at the latest on the next timer event) are missing.
+ *
+ * @return The number of ticks.
+ */
+uint64_t clock_ticks(void);
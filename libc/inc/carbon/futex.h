@@ -27,9 +27,91 @@ typedef uint32_t futex_t;
 void futex_wake(futex_t *futex, size_t threads);
 bool futex_wait(futex_t *futex, futex_t value);
 
+// Results of futex_wait_timeout
+#define FUTEX_WAIT_MISMATCH 0
+#define FUTEX_WAIT_WOKEN    1
+#define FUTEX_WAIT_TIMEOUT  2
+
+// Timeout for waiting without a timeout
+#define FUTEX_TIMEOUT_NONE  ((uint64_t) -1)
+
+int futex_wait_timeout(futex_t *futex, futex_t value, uint64_t timeout);
+
 bool futex_cmp_requeue(
         futex_t *futex,
         futex_t value,
         size_t wakeup,
         futex_t *target,
         size_t transfer);
+
+/**
+ * Wakes a thread waiting on one futex and waits on another futex, switching
+ * directly to the thread woken, which runs on the rest of the calling
+ * thread's time slice.
+ *
+ * @param wake The futex to wake a thread on.
+ * @param wait The futex to wait on.
+ * @param value The value to compare the futex to wait on with.
+ * @param timeout The timeout in nanoseconds (or FUTEX_TIMEOUT_NONE).
+ * @return One of the FUTEX_WAIT_* results (no thread is woken on mismatch).
+ */
+int futex_swap(futex_t *wake, futex_t *wait, futex_t value, uint64_t timeout);
+
+//- API - Futex - Vectored Wait ------------------------------------------------
+
+// Maximum number of futexes to wait on using futex_waitv
+#define FUTEX_WAITV_MAX         64
+
+// Results of futex_waitv (besides the index of the futex)
+#define FUTEX_WAITV_MISMATCH    (-1)
+#define FUTEX_WAITV_TIMEOUT     (-2)
+#define FUTEX_WAITV_INVALID     (-3)
+
+typedef struct futex_waitv {
+    futex_t *futex;
+    futex_t value;
+    uint32_t reserved;
+} futex_waitv_t;
+
+/**
+ * Compares each futex of the given vector with its value and, when all of them
+ * are equal, waits until one of them is waked.
+ *
+ * @param waiters The futexes and values.
+ * @param count The number of futexes (at most FUTEX_WAITV_MAX).
+ * @param timeout The timeout in nanoseconds (or FUTEX_TIMEOUT_NONE).
+ * @return The index of the futex that has been waked or one of the
+ *  FUTEX_WAITV_* results.
+ */
+int futex_waitv(futex_waitv_t *waiters, size_t count, uint64_t timeout);
+
+//- API - Futex - Priority Inheritance -----------------------------------------
+
+// Bits of the value of a priority inheritance futex (zero if unlocked)
+#define FUTEX_PI_WAITERS    (1U << 31)  // Unlocking must use futex_unlock_pi
+#define FUTEX_PI_LOCKED     (1U << 30)
+#define FUTEX_PI_TID_MASK   0x3FFFFFFF  // Id of the owning thread
+
+/**
+ * Locks a priority inheritance futex after failing to change it from zero to
+ * FUTEX_PI_LOCKED | thread_id() atomically.
+ *
+ * Waits until the owner hands the futex over, letting the owner run on the
+ * calling thread's time slice meanwhile.
+ *
+ * @param futex The futex to lock.
+ * @return Zero if locked, non-zero if the futex is invalid or already owned by
+ *  the calling thread.
+ */
+int futex_lock_pi(futex_t *futex);
+
+/**
+ * Unlocks a priority inheritance futex owned by the calling thread after
+ * failing to change it to zero atomically, because FUTEX_PI_WAITERS is set.
+ *
+ * Hands the futex over to a waiting thread.
+ *
+ * @param futex The futex to unlock.
+ * @return Zero on success, non-zero if not owned by the calling thread.
+ */
+int futex_unlock_pi(futex_t *futex);
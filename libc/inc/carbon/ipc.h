@@ -19,6 +19,7 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <carbon/process.h>
 
 //- API - Inter-Process Communication ------------------------------------------
@@ -33,10 +34,21 @@
 // Message flags
 #define IPC_FLAG_RESPONSE        (1 << 0)
 #define IPC_FLAG_IGNORE_RESPONSE (1 << 1)
+#define IPC_FLAG_PAGE_FAULT      (1 << 2)  // Page fault forwarded to a pager (see pager.h)
+#define IPC_FLAG_SHORT           (1 << 3)  // Payload passed in registers (see ipc_send_short)
+
+// Maximum payload of short messages
+#define IPC_SHORT_WORDS 6
+#define IPC_SHORT_SIZE  (IPC_SHORT_WORDS * sizeof(uint64_t))
 
 // Type for handler callbacks
 typedef void (*ipc_handler_t)(void *, size_t, pid_t, pid_t);
 
+// Payload of a short message
+typedef struct ipc_short_t {
+	uint64_t words[IPC_SHORT_WORDS];
+} ipc_short_t;
+
 // Recommended form of request headers to avoid collisions.
 typedef struct ipc_request_header_t {
 	uint64_t api_low;
@@ -63,6 +75,35 @@ typedef struct ipc_response_header_t {
  */
 size_t ipc_send(size_t length, uint8_t flags, pid_t target);
 
+/**
+ * Like ipc_send, but stops waiting for the response after the given time.
+ *
+ * @param length The length of the message.
+ * @param flags Flags for sending the message.
+ * @param target The target process.
+ * @param timeout The timeout in nanoseconds.
+ * @return Size of the response message or (size_t) -1, if the message could
+ *  not be sent or the response did not arrive in time.
+ */
+size_t ipc_send_timeout(size_t length, uint8_t flags, pid_t target, uint64_t timeout);
+
+/**
+ * Sends a short message of up to IPC_SHORT_SIZE bytes to the given target
+ * process, which is passed in registers instead of IPC_BUFFER_SEND.
+ *
+ * The message is delivered with IPC_FLAG_SHORT and should be received using
+ * ipc_reply_and_wait_short. Unless IPC_FLAG_IGNORE_RESPONSE is set, the
+ * current thread blocks until the (short) response replaced the message.
+ *
+ * @param message The message, replaced by the response.
+ * @param length The length of the message.
+ * @param flags Flags for sending the message.
+ * @param target The target process.
+ * @return Size of the response message or (size_t) -1, if the message could
+ *  not be sent.
+ */
+size_t ipc_send_short(ipc_short_t *message, size_t length, uint8_t flags, pid_t target);
+
 /**
  * Responds to the message handled by the current message handler, sending the
  * contents of IPC_BUFFER_SEND.
@@ -74,9 +115,50 @@ size_t ipc_send(size_t length, uint8_t flags, pid_t target);
  */
 void ipc_respond(size_t length, uint8_t flags);
 
+/**
+ * Responds to the message handled by the current thread (like ipc_respond, if
+ * it handles one) and waits for the next message, which is written to
+ * IPC_BUFFER_RECV.
+ *
+ * Messages are delivered to waiting threads before new handler threads are
+ * spawned, so servers can handle messages in a loop on a fixed set of threads.
+ * Servers receiving short messages use ipc_reply_and_wait_short instead.
+ *
+ * @param length Length of the response.
+ * @param flags Flags for the response.
+ * @param sender Set to the id of the next message's sender.
+ * @return Length of the next message or (size_t) -1, if the response could
+ *  not be sent.
+ */
+size_t ipc_reply_and_wait(size_t length, uint8_t flags, pid_t *sender);
+
+/**
+ * Like ipc_reply_and_wait, but passes short responses and messages (see
+ * ipc_send_short) in the given message.
+ *
+ * @param message The response (if the handled message was short), replaced by
+ *  the next message (if it is short).
+ * @param length Length of the response.
+ * @param flags Flags for the response.
+ * @param sender Set to the id of the next message's sender.
+ * @param message_flags Set to the flags of the next message.
+ * @return Length of the next message or (size_t) -1, if the response could
+ *  not be sent.
+ */
+size_t ipc_reply_and_wait_short(
+		ipc_short_t *message,
+		size_t length,
+		uint8_t flags,
+		pid_t *sender,
+		uint8_t *message_flags);
+
 /**
  * Resizes one of the current thread's buffers and returns its address.
  *
+ * The kernel keeps the buffer's pages when it shrinks and recycles them for
+ * later messages, so the contents of a buffer beyond the size or the length
+ * of a received message are unspecified.
+ *
  * @param buffer The number of the buffer to resize.
  * @param size The new size of the buffer.
  * @return Pointer to beginning of the buffer.
@@ -97,3 +179,64 @@ void *ipc_buffer_get(uint8_t buffer);
  * @param handler Pointer to the new message handler, NULL for none.
  */
 void ipc_handler(ipc_handler_t handler);
+
+//- API - Inter-Process Communication - Queues ---------------------------------
+
+// Returned by ipc_queue_create if the queue could not be created
+#define IPC_QUEUE_NONE ((uint32_t) -1)
+
+// Maximum number of slots per queue
+#define IPC_QUEUE_SLOTS_MAX 64
+
+// Flags for ipc_queue_receive
+#define IPC_QUEUE_WAIT (1 << 0)
+
+// A message in a queue
+typedef struct ipc_queue_msg_t {
+	pid_t sender;           // Set by the kernel
+	uint32_t length;        // At most IPC_SHORT_SIZE
+	uint8_t payload[IPC_SHORT_SIZE];
+} __attribute__((packed)) ipc_queue_msg_t;
+
+/**
+ * Creates a bounded queue of messages, which any process may send to without
+ * blocking and the calling process receives from.
+ *
+ * @param slots The minimum number of messages the queue holds (at most
+ *  IPC_QUEUE_SLOTS_MAX).
+ * @return The id of the queue or IPC_QUEUE_NONE.
+ */
+uint32_t ipc_queue_create(size_t slots);
+
+/**
+ * Appends a batch of messages to a queue, as many as there are free slots.
+ *
+ * A receiver waiting for the queue is woken up, if it has been empty.
+ *
+ * @param queue The id of the queue.
+ * @param messages The messages.
+ * @param count The number of messages.
+ * @return The number of messages appended or (size_t) -1, if there is no such
+ *  queue.
+ */
+size_t ipc_queue_send(uint32_t queue, const ipc_queue_msg_t *messages, size_t count);
+
+/**
+ * Removes a batch of the oldest messages from a queue of the calling process.
+ *
+ * @param queue The id of the queue.
+ * @param messages The array to receive the messages in.
+ * @param count The maximum number of messages.
+ * @param flags IPC_QUEUE_WAIT to block while the queue is empty.
+ * @return The number of messages received or (size_t) -1, if there is no such
+ *  queue (or it has been destroyed while waiting).
+ */
+size_t ipc_queue_receive(uint32_t queue, ipc_queue_msg_t *messages, size_t count, uint8_t flags);
+
+/**
+ * Destroys a queue of the calling process, discarding its messages.
+ *
+ * @param queue The id of the queue.
+ * @return Whether the queue has been destroyed.
+ */
+bool ipc_queue_destroy(uint32_t queue);
@@ -0,0 +1,50 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <stdint.h>
+
+//- API - Kernel Data ----------------------------------------------------------
+
+// Read-only pages the kernel maps into every process (see the kernel's kdata.h)
+#define KDATA_VADDR          0xFFFFFD0000000000
+#define KDATA_TIME_VADDR     (KDATA_VADDR + 0x0000)
+#define KDATA_PROCESS_VADDR  (KDATA_VADDR + 0x1000)
+#define KDATA_THREADS_VADDR  (KDATA_VADDR + 0x2000)
+
+typedef struct kdata_time {
+    volatile uint64_t ticks;
+    uint64_t tick_ns;
+    uint64_t tsc_base;
+    uint64_t tsc_mult;      // 32.32 fixed point, zero if the TSC is unusable
+} __attribute__((packed)) kdata_time_t;
+
+typedef struct kdata_process {
+    uint32_t pid;
+    uint32_t parent_pid;
+} __attribute__((packed)) kdata_process_t;
+
+// The calling thread's slot is addressed using GS
+typedef struct kdata_thread {
+    uint32_t tid;
+    uint32_t pid;
+} __attribute__((packed)) kdata_thread_t;
+
+#define KDATA_TIME    ((const kdata_time_t *) KDATA_TIME_VADDR)
+#define KDATA_PROCESS ((const kdata_process_t *) KDATA_PROCESS_VADDR)
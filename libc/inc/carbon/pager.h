@@ -0,0 +1,65 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <carbon/process.h>
+
+//- API - External Pager -------------------------------------------------------
+
+// Flags of a mapping in a pager's response
+#define PAGER_MAP_WRITEABLE (1 << 0)
+
+// Bits of the page fault's error code (the access type)
+#define PAGER_FAULT_PRESENT (1 << 0)
+#define PAGER_FAULT_WRITE   (1 << 1)
+#define PAGER_FAULT_FETCH   (1 << 4)
+
+// Payload of a message with IPC_FLAG_PAGE_FAULT
+typedef struct pager_fault {
+	uint64_t address;
+	uint64_t error_code;
+	pid_t pid;
+	uint32_t tid;
+} __attribute__((packed)) pager_fault_t;
+
+// The response is an array of mappings from pages of shared memory regions
+// the pager maps (see shm.h) to unmapped pages in the faulting process's
+// regions served by the pager. Writeable mappings require a writeable region
+// mapping. The faulting thread retries its access if the faulting page has
+// been mapped (writeable for write faults) and its process is terminated
+// otherwise.
+typedef struct pager_map {
+	uint64_t source;
+	uint64_t target;
+	uint64_t flags;
+} __attribute__((packed)) pager_map_t;
+
+/**
+ * Forwards page faults in a region of the calling process to a pager process,
+ * which receives them as messages to its message handler.
+ *
+ * @param start The start of the region.
+ * @param length The length of the region.
+ * @param pager The id of the pager process (must not be the calling one).
+ * @return Whether the region has been registered.
+ */
+bool pager_register(uintptr_t start, size_t length, pid_t pager);
@@ -21,7 +21,7 @@
 
 //- API - Multitasking - Process -----------------------------------------------
 
-#define PROCESS_MAX 1024
+#define PROCESS_MAX 0x10000
 
 /**
  * Type for process ids.
@@ -58,3 +58,30 @@ void process_kill(pid_t pid);
  * <code>process_kill(PROCESS_SELF);</code>
  */
 void process_exit() __attribute__((noreturn));
+
+/**
+ * Creates a new process without threads.
+ *
+ * Only allowed for the root process.
+ *
+ * @param parent The id of the new process's parent.
+ * @return The id of the new process or -1 on failure.
+ */
+pid_t process_create(pid_t parent);
+
+// Sources of the image passed to process_spawn_image
+#define PROCESS_IMAGE_BUFFER 0  // The caller's send IPC buffer
+#define PROCESS_IMAGE_MODULE 1  // A boot module
+
+/**
+ * Creates a new process from an ELF64 image and starts its main thread.
+ *
+ * Only allowed for the root process.
+ *
+ * @param source The source of the image (see PROCESS_IMAGE_*).
+ * @param length The length of the image in the send IPC buffer or the index
+ *  of the boot module.
+ * @param parent The id of the new process's parent.
+ * @return The id of the new process or -1 on failure.
+ */
+pid_t process_spawn_image(uint8_t source, size_t length, pid_t parent);
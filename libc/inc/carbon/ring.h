@@ -0,0 +1,97 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//- API - Submission Ring ------------------------------------------------------
+
+// Layout of the ring page (see the kernel's syscall.h)
+#define RING_ENTRIES 32
+
+// Result of a submission that cannot be processed using the ring
+#define RING_INVALID ((uint64_t) -1)
+
+typedef struct ring_sqe {
+	uint64_t number;
+	uint64_t rbx;
+	uint64_t rcx;
+	uint64_t rdx;
+	uint64_t rsi;
+	uint64_t rdi;
+	uint64_t user_data;
+	uint64_t reserved;
+} __attribute__((packed)) ring_sqe_t;
+
+typedef struct ring_cqe {
+	uint64_t user_data;
+	uint64_t rax;
+	uint64_t rbx;
+	uint64_t reserved;
+} __attribute__((packed)) ring_cqe_t;
+
+typedef struct ring {
+	volatile uint32_t sq_head;
+	volatile uint32_t sq_tail;
+	volatile uint32_t cq_head;
+	volatile uint32_t cq_tail;
+	uint8_t reserved[48];
+
+	ring_sqe_t sq[RING_ENTRIES];
+	ring_cqe_t cq[RING_ENTRIES];
+} __attribute__((packed)) ring_t;
+
+/**
+ * Maps the calling process's submission ring (on the first call).
+ *
+ * @return The ring or a null pointer, if it could not be set up.
+ */
+ring_t *ring_setup(void);
+
+/**
+ * Lets the kernel process the submitted system calls.
+ *
+ * Only system calls that never block can be submitted (see syscalls.def),
+ * others complete with RING_INVALID.
+ *
+ * @return The number of processed submissions.
+ */
+uint32_t ring_enter(void);
+
+/**
+ * Queues a system call on the given ring.
+ *
+ * The submission is only processed on the next call of ring_enter.
+ *
+ * @param ring The ring.
+ * @param sqe The system call number, its arguments and the user data to pass
+ *  to its completion.
+ * @return Whether there was a free submission slot.
+ */
+bool ring_submit(ring_t *ring, const ring_sqe_t *sqe);
+
+/**
+ * Takes the next completion from the given ring.
+ *
+ * @param ring The ring.
+ * @param cqe Set to the completion.
+ * @return Whether there was a completion.
+ */
+bool ring_complete(ring_t *ring, ring_cqe_t *cqe);
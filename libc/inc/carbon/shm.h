@@ -0,0 +1,74 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <carbon/process.h>
+#include <carbon/memory.h>
+
+//- API - Shared Memory --------------------------------------------------------
+
+// Returned by shm_create if the region could not be created
+#define SHM_NONE ((uint32_t) -1)
+
+/**
+ * Creates a region of zeroed memory that can be shared with other processes
+ * and maps it writeable at the given address.
+ *
+ * The region is freed when the last process mapping it unmaps it (or
+ * terminates).
+ *
+ * @param address The page aligned address to map the region at (no page of
+ *  the range may be mapped).
+ * @param pages The number of pages of the region.
+ * @return The id of the region or SHM_NONE.
+ */
+uint32_t shm_create(uintptr_t address, size_t pages);
+
+/**
+ * Allows another process to map a region the calling process maps.
+ *
+ * @param id The id of the region.
+ * @param pid The process to grant the right to.
+ * @param flags MEMORY_FLAG_WRITEABLE to allow writeable mappings (requires a
+ *  writeable mapping of the calling process), zero for read-only ones.
+ * @return Whether the right has been granted.
+ */
+bool shm_grant(uint32_t id, pid_t pid, uint8_t flags);
+
+/**
+ * Maps a region the calling process has been granted at the given address.
+ *
+ * @param id The id of the region.
+ * @param address The page aligned address to map the region at (no page of
+ *  the range may be mapped).
+ * @param flags MEMORY_FLAG_WRITEABLE to map the region writeable.
+ * @return Whether the region has been mapped.
+ */
+bool shm_map(uint32_t id, uintptr_t address, uint8_t flags);
+
+/**
+ * Unmaps the region mapped at the given address.
+ *
+ * @param address The address the region is mapped at.
+ * @return Whether a region has been mapped at the address.
+ */
+bool shm_unmap(uintptr_t address);
@@ -0,0 +1,796 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Generated from syscalls.def by tools/syscalls.awk, do not edit
+// (regenerate using "make syscalls").
+
+#pragma once
+#include <stdint.h>
+
+//- API - System Calls ---------------------------------------------------------
+
+#define SYSCALL_NR_PROCESS_ID            0
+#define SYSCALL_NR_PROCESS_PARENT_ID     1
+#define SYSCALL_NR_PROCESS_EXIT          2
+#define SYSCALL_NR_THREAD_ID             3
+#define SYSCALL_NR_THREAD_SPAWN          4
+#define SYSCALL_NR_THREAD_JOIN           5
+#define SYSCALL_NR_THREAD_CANCEL         6
+#define SYSCALL_NR_THREAD_JOIN_TIMEOUT   7
+#define SYSCALL_NR_PROCESS_CREATE        8
+#define SYSCALL_NR_PROCESS_KILL          9
+#define SYSCALL_NR_THREAD_CREATE         10
+#define SYSCALL_NR_THREAD_KILL           11
+#define SYSCALL_NR_THREAD_SLEEP          12
+#define SYSCALL_NR_CLOCK_GET             13
+#define SYSCALL_NR_RING_SETUP            14
+#define SYSCALL_NR_RING_ENTER            15
+#define SYSCALL_NR_PROCESS_SPAWN_IMAGE   37
+#define SYSCALL_NR_MUTEX_LOCK            16
+#define SYSCALL_NR_MUTEX_UNLOCK          17
+#define SYSCALL_NR_MUTEX_TRYLOCK         18
+#define SYSCALL_NR_IPC_SEND              24
+#define SYSCALL_NR_IPC_RESPOND           25
+#define SYSCALL_NR_IPC_BUFFER_SIZE       26
+#define SYSCALL_NR_IPC_BUFFER_GET        27
+#define SYSCALL_NR_IPC_HANDLER           28
+#define SYSCALL_NR_IPC_SEND_TIMEOUT      29
+#define SYSCALL_NR_IPC_REPLY_AND_WAIT    30
+#define SYSCALL_NR_IPC_SEND_SHORT        31
+#define SYSCALL_NR_IPC_QUEUE_CREATE      19
+#define SYSCALL_NR_IPC_QUEUE_SEND        20
+#define SYSCALL_NR_IPC_QUEUE_RECEIVE     21
+#define SYSCALL_NR_IPC_QUEUE_DESTROY     22
+#define SYSCALL_NR_MEMORY_ALLOC          32
+#define SYSCALL_NR_MEMORY_FREE           33
+#define SYSCALL_NR_MEMORY_MAP            34
+#define SYSCALL_NR_MEMORY_UNMAP          35
+#define SYSCALL_NR_PAGER_REGISTER        36
+#define SYSCALL_NR_SHM_CREATE            38
+#define SYSCALL_NR_SHM_GRANT             39
+#define SYSCALL_NR_SHM_MAP               42
+#define SYSCALL_NR_SHM_UNMAP             43
+#define SYSCALL_NR_DEBUG                 40
+#define SYSCALL_NR_DEBUG_HEX             41
+#define SYSCALL_NR_FUTEX_WAKE            48
+#define SYSCALL_NR_FUTEX_WAIT            49
+#define SYSCALL_NR_FUTEX_CMP_REQUEUE     50
+#define SYSCALL_NR_FUTEX_WAIT_TIMEOUT    51
+#define SYSCALL_NR_FUTEX_LOCK_PI         52
+#define SYSCALL_NR_FUTEX_UNLOCK_PI       53
+#define SYSCALL_NR_FUTEX_WAITV           54
+#define SYSCALL_NR_FUTEX_SWAP            55
+
+// Size of the system call table (including unused numbers)
+#define SYSCALL_COUNT 56
+
+//- API - System Calls - Stubs -------------------------------------------------
+
+// Each stub returns RAX and stores the other registers the kernel returns
+// values in to the given pointers. SYSCALL clobbers RCX and R11, the kernel
+// preserves all other registers.
+
+static inline uint64_t __syscall_process_id(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_PROCESS_ID;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_process_parent_id(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_PROCESS_PARENT_ID;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline __attribute__((noreturn)) void __syscall_process_exit(void) {
+	uint64_t rax = SYSCALL_NR_PROCESS_EXIT;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		:
+		: "rcx", "r11", "memory");
+
+	__builtin_unreachable();
+}
+
+static inline uint64_t __syscall_thread_id(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_THREAD_ID;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_spawn(uint64_t rdi, uint64_t rsi, uint64_t rdx, uint64_t rcx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_THREAD_SPAWN;
+	uint64_t _rdi = rdi;
+	uint64_t _rsi = rsi;
+	uint64_t _rdx = rdx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		: "D" (_rdi), "S" (_rsi), "d" (_rdx), "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_join(uint64_t rbx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_THREAD_JOIN;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_cancel(uint64_t rbx, uint64_t rsi, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_THREAD_CANCEL;
+	uint64_t _rbx = rbx;
+	uint64_t _rsi = rsi;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "S" (_rsi), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_join_timeout(uint64_t rbx, uint64_t rcx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_THREAD_JOIN_TIMEOUT;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_process_create(uint64_t rcx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_PROCESS_CREATE;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_process_kill(uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_PROCESS_KILL;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_create(uint64_t rdi, uint64_t rsi, uint64_t rcx, uint64_t rdx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_THREAD_CREATE;
+	uint64_t _rdi = rdi;
+	uint64_t _rsi = rsi;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		: "D" (_rdi), "S" (_rsi), "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_kill(uint64_t rbx, uint64_t rcx, uint64_t rsi, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_THREAD_KILL;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rsi = rsi;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "r" (r10), "S" (_rsi), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_thread_sleep(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_THREAD_SLEEP;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_clock_get(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_CLOCK_GET;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ring_setup(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_RING_SETUP;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ring_enter(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_RING_ENTER;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_process_spawn_image(uint64_t rbx, uint64_t rcx, uint64_t rdx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_PROCESS_SPAWN_IMAGE;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		: "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_mutex_lock(uint64_t rsi) {
+	uint64_t rax = SYSCALL_NR_MUTEX_LOCK;
+	uint64_t _rsi = rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_mutex_unlock(uint64_t rsi) {
+	uint64_t rax = SYSCALL_NR_MUTEX_UNLOCK;
+	uint64_t _rsi = rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_mutex_trylock(uint64_t rsi, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_MUTEX_TRYLOCK;
+	uint64_t _rsi = rsi;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		: "S" (_rsi)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_send(uint64_t rdi, uint64_t rbx, uint64_t rcx, uint64_t *rbx_out, uint64_t *rdx_out, uint64_t *rsi_out, uint64_t *rdi_out) {
+	uint64_t rax = SYSCALL_NR_IPC_SEND;
+	uint64_t _rdi = rdi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx;
+	uint64_t _rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx), "=d" (_rdx), "=S" (_rsi), "+D" (_rdi)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	*rdx_out = _rdx;
+	*rsi_out = _rsi;
+	*rdi_out = _rdi;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_respond(uint64_t rbx, uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_IPC_RESPOND;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_buffer_size(uint64_t rbx, uint64_t rcx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_IPC_BUFFER_SIZE;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_buffer_get(uint64_t rbx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_IPC_BUFFER_GET;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_handler(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_IPC_HANDLER;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_send_timeout(uint64_t rdi, uint64_t rbx, uint64_t rcx, uint64_t rdx, uint64_t *rbx_out, uint64_t *rdx_out, uint64_t *rsi_out, uint64_t *rdi_out) {
+	uint64_t rax = SYSCALL_NR_IPC_SEND_TIMEOUT;
+	uint64_t _rdi = rdi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+	uint64_t _rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx), "+d" (_rdx), "=S" (_rsi), "+D" (_rdi)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	*rdx_out = _rdx;
+	*rsi_out = _rsi;
+	*rdi_out = _rdi;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_reply_and_wait(uint64_t rbx, uint64_t rcx, uint64_t r8, uint64_t r9, uint64_t r12, uint64_t r13, uint64_t r14, uint64_t r15, uint64_t *rbx_out, uint64_t *rdx_out, uint64_t *rsi_out, uint64_t *rdi_out, uint64_t *r8_out, uint64_t *r9_out, uint64_t *r12_out, uint64_t *r13_out, uint64_t *r14_out, uint64_t *r15_out) {
+	uint64_t rax = SYSCALL_NR_IPC_REPLY_AND_WAIT;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	register uint64_t _r8 __asm__ ("r8") = r8;
+	register uint64_t _r9 __asm__ ("r9") = r9;
+	register uint64_t _r12 __asm__ ("r12") = r12;
+	register uint64_t _r13 __asm__ ("r13") = r13;
+	register uint64_t _r14 __asm__ ("r14") = r14;
+	register uint64_t _r15 __asm__ ("r15") = r15;
+	uint64_t _rdx;
+	uint64_t _rsi;
+	uint64_t _rdi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx), "=d" (_rdx), "=S" (_rsi), "=D" (_rdi), "+r" (_r8), "+r" (_r9), "+r" (_r12), "+r" (_r13), "+r" (_r14), "+r" (_r15)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	*rdx_out = _rdx;
+	*rsi_out = _rsi;
+	*rdi_out = _rdi;
+	*r8_out = _r8;
+	*r9_out = _r9;
+	*r12_out = _r12;
+	*r13_out = _r13;
+	*r14_out = _r14;
+	*r15_out = _r15;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_send_short(uint64_t rdi, uint64_t rbx, uint64_t rcx, uint64_t r8, uint64_t r9, uint64_t r12, uint64_t r13, uint64_t r14, uint64_t r15, uint64_t *rbx_out, uint64_t *rdx_out, uint64_t *rsi_out, uint64_t *rdi_out, uint64_t *r8_out, uint64_t *r9_out, uint64_t *r12_out, uint64_t *r13_out, uint64_t *r14_out, uint64_t *r15_out) {
+	uint64_t rax = SYSCALL_NR_IPC_SEND_SHORT;
+	uint64_t _rdi = rdi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	register uint64_t _r8 __asm__ ("r8") = r8;
+	register uint64_t _r9 __asm__ ("r9") = r9;
+	register uint64_t _r12 __asm__ ("r12") = r12;
+	register uint64_t _r13 __asm__ ("r13") = r13;
+	register uint64_t _r14 __asm__ ("r14") = r14;
+	register uint64_t _r15 __asm__ ("r15") = r15;
+	uint64_t _rdx;
+	uint64_t _rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx), "=d" (_rdx), "=S" (_rsi), "+D" (_rdi), "+r" (_r8), "+r" (_r9), "+r" (_r12), "+r" (_r13), "+r" (_r14), "+r" (_r15)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	*rdx_out = _rdx;
+	*rsi_out = _rsi;
+	*rdi_out = _rdi;
+	*r8_out = _r8;
+	*r9_out = _r9;
+	*r12_out = _r12;
+	*r13_out = _r13;
+	*r14_out = _r14;
+	*r15_out = _r15;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_queue_create(uint64_t rbx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_IPC_QUEUE_CREATE;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_queue_send(uint64_t rbx, uint64_t rcx, uint64_t rdx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_IPC_QUEUE_SEND;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		: "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_queue_receive(uint64_t rbx, uint64_t rcx, uint64_t rdx, uint64_t rsi, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_IPC_QUEUE_RECEIVE;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+	uint64_t _rsi = rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		: "r" (r10), "d" (_rdx), "S" (_rsi)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_ipc_queue_destroy(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_IPC_QUEUE_DESTROY;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_memory_alloc(uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_MEMORY_ALLOC;
+	uint64_t _rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "=b" (_rbx)
+		:
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_memory_free(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_MEMORY_FREE;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_memory_map(uint64_t rdi, uint64_t rsi, uint64_t rbx, uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_MEMORY_MAP;
+	uint64_t _rdi = rdi;
+	uint64_t _rsi = rsi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "D" (_rdi), "S" (_rsi), "b" (_rbx), "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_memory_unmap(uint64_t rbx, uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_MEMORY_UNMAP;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_pager_register(uint64_t rbx, uint64_t rcx, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_PAGER_REGISTER;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_shm_create(uint64_t rbx, uint64_t rcx, uint64_t *rbx_out) {
+	uint64_t rax = SYSCALL_NR_SHM_CREATE;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax), "+b" (_rbx)
+		: "r" (r10)
+		: "rcx", "r11", "memory");
+
+	*rbx_out = _rbx;
+	return rax;
+}
+
+static inline uint64_t __syscall_shm_grant(uint64_t rbx, uint64_t rcx, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_SHM_GRANT;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_shm_map(uint64_t rbx, uint64_t rcx, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_SHM_MAP;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx), "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_shm_unmap(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_SHM_UNMAP;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_debug(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_DEBUG;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_debug_hex(uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_DEBUG_HEX;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_wake(uint64_t rsi, uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_FUTEX_WAKE;
+	uint64_t _rsi = rsi;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi), "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_wait(uint64_t rsi, uint64_t rbx) {
+	uint64_t rax = SYSCALL_NR_FUTEX_WAIT;
+	uint64_t _rsi = rsi;
+	uint64_t _rbx = rbx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi), "b" (_rbx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_cmp_requeue(uint64_t rsi, uint64_t rdi, uint64_t rbx, uint64_t rcx, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_FUTEX_CMP_REQUEUE;
+	uint64_t _rsi = rsi;
+	uint64_t _rdi = rdi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi), "D" (_rdi), "b" (_rbx), "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_wait_timeout(uint64_t rsi, uint64_t rbx, uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_FUTEX_WAIT_TIMEOUT;
+	uint64_t _rsi = rsi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi), "b" (_rbx), "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_lock_pi(uint64_t rsi) {
+	uint64_t rax = SYSCALL_NR_FUTEX_LOCK_PI;
+	uint64_t _rsi = rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_unlock_pi(uint64_t rsi) {
+	uint64_t rax = SYSCALL_NR_FUTEX_UNLOCK_PI;
+	uint64_t _rsi = rsi;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_waitv(uint64_t rsi, uint64_t rcx, uint64_t rdx) {
+	uint64_t rax = SYSCALL_NR_FUTEX_WAITV;
+	uint64_t _rsi = rsi;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+	uint64_t _rdx = rdx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi), "r" (r10), "d" (_rdx)
+		: "rcx", "r11", "memory");
+	return rax;
+}
+
+static inline uint64_t __syscall_futex_swap(uint64_t rsi, uint64_t rdi, uint64_t rbx, uint64_t rcx) {
+	uint64_t rax = SYSCALL_NR_FUTEX_SWAP;
+	uint64_t _rsi = rsi;
+	uint64_t _rdi = rdi;
+	uint64_t _rbx = rbx;
+	register uint64_t r10 __asm__ ("r10") = rcx;
+
+	__asm__ volatile ("syscall"
+		: "+a" (rax)
+		: "S" (_rsi), "D" (_rdi), "b" (_rbx), "r" (r10)
+		: "rcx", "r11", "memory");
+	return rax;
+}
@@ -23,11 +23,13 @@
 
 //- API - Multitasking - Thread ------------------------------------------------
 
-#define THREAD_MAX 1024
+#define THREAD_MAX 0x10000
 
 #define THREAD_CANCEL_REASON_EXPLICIT 0
 #define THREAD_CANCEL_REASON_RETURN   1
 
+#define THREAD_JOIN_TIMEOUT 4
+
 /**
  * Type for thread ids.
  */
@@ -49,6 +51,24 @@ tid_t thread_id(void);
  */
 void *thread_join(tid_t tid);
 
+/**
+ * Waits for a thread to complete, given its id, for at most the given time.
+ *
+ * @param tid The id of the thread to join with.
+ * @param timeout The timeout in nanoseconds.
+ * @param result Set to the thread's result on success.
+ * @return Zero on success, THREAD_JOIN_TIMEOUT if the thread did not
+ *  complete in time or another non-zero error code.
+ */
+int thread_join_timeout(tid_t tid, uint64_t timeout, void **result);
+
+/**
+ * Puts the current thread to sleep for the given duration.
+ *
+ * @param duration The duration in nanoseconds (zero to yield only).
+ */
+void thread_sleep(uint64_t duration);
+
 /**
  * Kills a thread, given its id and the id of the hosting process.
  *
@@ -102,12 +122,11 @@ tid_t thread_create(void *entry, void *args, void *ret, pid_t pid);
 /**
  * Spawns a new thread in the current process.
  *
- * Same as:
- * <code>thread_spawn_foreign(entry, args, PROCESS_SELF);</code>
- *
  * @param entry The thread's entry point.
  * @param args Pointer to the thread's arguments.
  * @param ret The address the thread should return to.
+ * @param stack_size The size the thread's stack may grow to (zero for the
+ *  maximum of about 2 MiB).
  * @return The id of the newly created thread.
  */
-tid_t thread_spawn(void *entry, void *args, void *ret);
+tid_t thread_spawn(void *entry, void *args, void *ret, size_t stack_size);
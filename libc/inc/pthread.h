@@ -34,7 +34,8 @@
 
 //- POSIX Limits ---------------------------------------------------------------
 
-#define PTHREAD_STACK_MIN   0x0
+#define PTHREAD_STACK_MIN   0x1000
+#define PTHREAD_STACK_DEFAULT (0x200000 - 0x1000)   // Maximum of the kernel
 #define PTHREAD_THREADS_MAX THREAD_MAX
 #define PTHREAD_KEYS_MX     64
 
@@ -72,11 +73,16 @@ typedef int pthread_key_t;
 #define PTHREAD_MUTEX_ERRORCHECK 2
 #define PTHREAD_MUTEX_DEFAULT    PTHREAD_MUTEX_NORMAL
 
+#define PTHREAD_PRIO_NONE        0
+#define PTHREAD_PRIO_INHERIT     1
+#define PTHREAD_PRIO_PROTECT     2
+
 //- Structures -----------------------------------------------------------------
 
 typedef struct pthread_attr {
     int detachstate;
     sched_param_t param;
+    size_t stacksize;
 } pthread_attr_t;
 
 typedef struct pthread_once {
@@ -85,13 +91,18 @@ typedef struct pthread_once {
 
 typedef struct pthread_mutexattr {
     int kind;
+    int protocol;
 } pthread_mutexattr_t;
 
 typedef struct pthread_mutex {
     mutex_t lock;
     mutex_t lock_struct;
 
+    // Lock of PTHREAD_PRIO_INHERIT mutexes (see futex_lock_pi)
+    futex_t lock_pi;
+
     int kind;
+    int protocol;
     pthread_t owner;
     long recursion;
 } pthread_mutex_t;
@@ -171,6 +182,8 @@ int pthread_mutexattr_init(pthread_mutexattr_t *attr);
 int pthread_mutexattr_destroy(pthread_mutexattr_t *attr);
 int pthread_mutexattr_gettype(pthread_mutexattr_t *attr, int *kind);
 int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int kind);
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol);
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol);
 
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
 int pthread_mutex_destroy(pthread_mutex_t *mutex);
@@ -179,6 +192,10 @@ int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *absti
 int pthread_mutex_trylock(pthread_mutex_t *mutex);
 int pthread_mutex_unlock(pthread_mutex_t *mutex);
 
+int __pthread_mutex_lock_pi(pthread_mutex_t *mutex);
+int __pthread_mutex_trylock_pi(pthread_mutex_t *mutex);
+int __pthread_mutex_unlock_pi(pthread_mutex_t *mutex);
+
 //- Condition Variable ---------------------------------------------------------
 
 int pthread_condattr_init(pthread_condattr_t *attr);
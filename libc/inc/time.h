@@ -0,0 +1,38 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIME_H_
+#define TIME_H_
+
+#include <sys/types.h>
+
+//- Time -----------------------------------------------------------------------
+
+// Both clocks count the time since the system has been started
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+struct timespec {
+    time_t tv_sec;
+    long tv_nsec;
+};
+
+int nanosleep(const struct timespec *rqtp, struct timespec *rmtp);
+int clock_gettime(clockid_t clock_id, struct timespec *tp);
+
+#endif /* TIME_H_ */
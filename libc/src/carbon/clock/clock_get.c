@@ -0,0 +1,45 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <carbon/clock.h>
+#include <carbon/kdata.h>
+#include <carbon/syscall.h>
+
+uint64_t clock_get(void) {
+	const kdata_time_t *time = KDATA_TIME;
+
+	// TSC does not run at a constant rate? Ask the kernel, which counts in
+	// whole timer ticks then
+	if (0 == time->tsc_mult) {
+		uint64_t ns;
+		__syscall_clock_get(&ns);
+
+		return ns;
+	}
+
+	uint32_t low, high;
+	asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+
+	uint64_t counts = (((uint64_t) high << 32) | low) - time->tsc_base;
+	return (uint64_t) (((unsigned __int128) counts * time->tsc_mult) >> 32);
+}
+
+uint64_t clock_ticks(void) {
+	return KDATA_TIME->ticks;
+}
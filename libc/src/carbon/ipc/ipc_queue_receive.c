@@ -0,0 +1,33 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <carbon/ipc.h>
+#include <carbon/syscall.h>
+
+size_t ipc_queue_receive(uint32_t queue, ipc_queue_msg_t *messages, size_t count, uint8_t flags) {
+	uint64_t received;
+
+	do {
+		if (0 != __syscall_ipc_queue_receive(queue, (uintptr_t) messages, count, flags, &received))
+			return (size_t) -1;
+
+		// Woken up when the queue became non-empty: Retry
+	} while (0 == received && 0 != count && 0 != (flags & IPC_QUEUE_WAIT));
+
+	return received;
+}
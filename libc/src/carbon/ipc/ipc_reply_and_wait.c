@@ -0,0 +1,36 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <carbon/ipc.h>
+#include <carbon/syscall.h>
+
+size_t ipc_reply_and_wait(size_t length, uint8_t flags, pid_t *sender) {
+	// The next message's header is returned like a handler's arguments
+	uint64_t rbx, rdx, rsi, rdi;
+	uint64_t payload[IPC_SHORT_WORDS];
+
+	if (0 != __syscall_ipc_reply_and_wait(
+			flags, length, 0, 0, 0, 0, 0, 0,
+			&rbx, &rdx, &rsi, &rdi,
+			&payload[0], &payload[1], &payload[2],
+			&payload[3], &payload[4], &payload[5]))
+		return (size_t) -1;
+
+	*sender = (pid_t) rdx;
+	return rsi;
+}
@@ -0,0 +1,42 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <carbon/ipc.h>
+#include <carbon/syscall.h>
+
+size_t ipc_reply_and_wait_short(
+		ipc_short_t *message,
+		size_t length,
+		uint8_t flags,
+		pid_t *sender,
+		uint8_t *message_flags) {
+	// The next message's header is returned like a handler's arguments, its
+	// payload replaces the response's, if short
+	uint64_t rbx, rdx, rsi, rdi;
+	uint64_t *w = message->words;
+
+	if (0 != __syscall_ipc_reply_and_wait(
+			flags, length, w[0], w[1], w[2], w[3], w[4], w[5],
+			&rbx, &rdx, &rsi, &rdi,
+			&w[0], &w[1], &w[2], &w[3], &w[4], &w[5]))
+		return (size_t) -1;
+
+	*sender = (pid_t) rdx;
+	*message_flags = (uint8_t) rbx;
+	return rsi;
+}
@@ -0,0 +1,31 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <carbon/ipc.h>
+#include <carbon/syscall.h>
+
+size_t ipc_send_timeout(size_t length, uint8_t flags, pid_t target, uint64_t timeout) {
+	// The response's header is returned like a message's
+	uint64_t rbx, rdx, rsi, rdi;
+
+	if (0 != __syscall_ipc_send_timeout(target, flags, length, timeout, &rbx, &rdx, &rsi, &rdi))
+		return (size_t) -1;
+
+	return rsi;
+}
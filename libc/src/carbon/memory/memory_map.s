@@ -1,36 +0,0 @@
-; Carbon Operating System
-; Copyright (C) 2011 Lukas Heidemann
-;
-; This program is free software: you can redistribute it and/or modify
-; it under the terms of the GNU General Public License as published by
-; the Free Software Foundation, either version 3 of the License, or
-; (at your option) any later version.
-;
-; This program is distributed in the hope that it will be useful,
-; but WITHOUT ANY WARRANTY; without even the implied warranty of
-; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-; GNU General Public License for more details.
-;
-; You should have received a copy of the GNU General Public License
-; along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-bits 64
-section .text
-
-global memory_map
-memory_map:
-	; System call number
-	mov rax, 34
-
-	; Parameters
-	; First two already in place
-	xchg r11, rdx
-	xchg r12, rcx
-
-	xchg rbx, r11
-	xchg rcx, r12
-
-	; Call kernel
-	int 0x80
-
-	ret
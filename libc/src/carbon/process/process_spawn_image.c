@@ -0,0 +1,31 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <carbon/process.h>
+#include <carbon/syscall.h>
+
+pid_t process_spawn_image(uint8_t source, size_t length, pid_t parent) {
+	uint64_t pid;
+
+	if (0 != __syscall_process_spawn_image(source, length, parent, &pid))
+		return (pid_t) -1;
+
+	return (pid_t) pid;
+}
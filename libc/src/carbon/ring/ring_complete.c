@@ -0,0 +1,37 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <carbon/ring.h>
+
+bool ring_complete(ring_t *ring, ring_cqe_t *cqe) {
+	uint32_t head = ring->cq_head;
+
+	// Empty?
+	if (head == ring->cq_tail)
+		return false;
+
+	*cqe = ring->cq[head % RING_ENTRIES];
+
+	// Release the entry after it has been read
+	__sync_synchronize();
+	ring->cq_head = head + 1;
+
+	return true;
+}
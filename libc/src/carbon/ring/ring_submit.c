@@ -0,0 +1,37 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <carbon/ring.h>
+
+bool ring_submit(ring_t *ring, const ring_sqe_t *sqe) {
+	uint32_t tail = ring->sq_tail;
+
+	// Full?
+	if (tail - ring->sq_head >= RING_ENTRIES)
+		return false;
+
+	ring->sq[tail % RING_ENTRIES] = *sqe;
+
+	// Publish the submission after its entry
+	__sync_synchronize();
+	ring->sq_tail = tail + 1;
+
+	return true;
+}
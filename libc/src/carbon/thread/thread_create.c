@@ -0,0 +1,28 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <carbon/thread.h>
+#include <carbon/syscall.h>
+
+tid_t thread_create(void *entry, void *args, void *ret, pid_t pid) {
+	uint64_t tid;
+	__syscall_thread_create((uintptr_t) entry, (uintptr_t) args, pid, (uintptr_t) ret, &tid);
+
+	return (tid_t) tid;
+}
@@ -24,6 +24,13 @@ int pthread_cond_broadcast(pthread_cond_t *cond) {
         return 0;
 
     __sync_fetch_and_add(&cond->seq, 1);
+
+    // Cannot requeue onto priority inheritance futexes: Wake all waiters
+    if (PTHREAD_PRIO_INHERIT == cond->mutex->protocol) {
+        futex_wake(&cond->seq, INT32_MAX);
+        return 0;
+    }
+
     while (!futex_cmp_requeue(
             &cond->seq,
             cond->seq,
@@ -0,0 +1,64 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <carbon/futex.h>
+#include <carbon/clock.h>
+#include <pthread.h>
+#include <errno.h>
+
+int pthread_cond_timedwait(
+        pthread_cond_t *cond,
+        pthread_mutex_t *mutex,
+        const struct timespec *abstime) {
+    // Backup sequence value
+    futex_t seq = cond->seq;
+
+    // Check arguments
+    if (PTHREAD_MUTEX_RECURSIVE == mutex->kind)
+        return EINVAL;
+
+    if (abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000L)
+        return EINVAL;
+
+    // Try to bind to mutex
+    if (cond->mutex != mutex) {
+        // Different mutex already set?
+        if (0 != cond->mutex)
+            return EINVAL;
+
+        // Try to set
+        if (!__sync_bool_compare_and_swap(&cond->mutex, 0, mutex))
+            return EINVAL;
+    }
+
+    // Convert to relative timeout
+    uint64_t deadline = abstime->tv_sec * 1000000000ULL + abstime->tv_nsec;
+    uint64_t now = clock_get();
+    uint64_t timeout = (deadline > now) ? deadline - now : 0;
+
+    // Unlock the mutex
+    pthread_mutex_unlock(mutex);
+
+    // Wait
+    int result = futex_wait_timeout(&cond->seq, seq, timeout);
+
+    // Try to acquire mutex
+    pthread_mutex_lock(mutex);
+
+    return (FUTEX_WAIT_TIMEOUT == result) ? ETIMEDOUT : 0;
+}
@@ -24,7 +24,9 @@ int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
 	mutex->lock_struct = 0;
 	mutex->recursion = 0;
 	mutex->owner = -1;
+	mutex->lock_pi = 0;
 	mutex->kind = (0 != attr) ? attr->kind : PTHREAD_MUTEX_DEFAULT;
+	mutex->protocol = (0 != attr) ? attr->protocol : PTHREAD_PRIO_NONE;
 
 	return 0;
 }
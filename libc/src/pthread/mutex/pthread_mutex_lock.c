@@ -22,6 +22,10 @@
 #include <errno.h>
 
 int pthread_mutex_lock(pthread_mutex_t *mutex) {
+	// Priority inheritance?
+	if (PTHREAD_PRIO_INHERIT == mutex->protocol)
+		return __pthread_mutex_lock_pi(mutex);
+
 	// Lock structure
 	mutex_lock(&mutex->lock_struct);
 
@@ -0,0 +1,92 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <carbon/thread.h>
+#include <carbon/futex.h>
+#include <pthread.h>
+#include <errno.h>
+
+//- Priority Inheritance Mutexes -----------------------------------------------
+
+/**
+ * Checks whether the given priority inheritance mutex is owned by the calling
+ * thread.
+ */
+static bool _pthread_mutex_owned_pi(pthread_mutex_t *mutex, futex_t self) {
+	return (mutex->lock_pi & ~FUTEX_PI_WAITERS) == self;
+}
+
+int __pthread_mutex_lock_pi(pthread_mutex_t *mutex) {
+	futex_t self = FUTEX_PI_LOCKED | (thread_id() & FUTEX_PI_TID_MASK);
+
+	// Uncontended?
+	if (!__sync_bool_compare_and_swap(&mutex->lock_pi, 0, self)) {
+		// Current thread holds lock?
+		if (_pthread_mutex_owned_pi(mutex, self)) {
+			if (PTHREAD_MUTEX_RECURSIVE != mutex->kind)
+				return EDEADLCK;
+
+			++mutex->recursion;
+			return 0;
+		}
+
+		// Wait for the owner to hand the lock over
+		if (0 != futex_lock_pi(&mutex->lock_pi))
+			return EINVAL;
+	}
+
+	// Set owner
+	mutex->owner = pthread_self();
+	return 0;
+}
+
+int __pthread_mutex_trylock_pi(pthread_mutex_t *mutex) {
+	futex_t self = FUTEX_PI_LOCKED | (thread_id() & FUTEX_PI_TID_MASK);
+
+	if (__sync_bool_compare_and_swap(&mutex->lock_pi, 0, self)) {
+		mutex->owner = pthread_self();
+		return true;
+	}
+
+	// Locked by current thread?
+	if (PTHREAD_MUTEX_RECURSIVE == mutex->kind && _pthread_mutex_owned_pi(mutex, self)) {
+		++mutex->recursion;
+		return true;
+	}
+
+	return false;
+}
+
+int __pthread_mutex_unlock_pi(pthread_mutex_t *mutex) {
+	futex_t self = FUTEX_PI_LOCKED | (thread_id() & FUTEX_PI_TID_MASK);
+
+	if (!_pthread_mutex_owned_pi(mutex, self))
+		return EPERM;
+
+	// Decrease recursion
+	if (0 != mutex->recursion) {
+		--mutex->recursion;
+		return 0;
+	}
+
+	// Waiters are handed the lock by the kernel
+	if (!__sync_bool_compare_and_swap(&mutex->lock_pi, self, 0))
+		futex_unlock_pi(&mutex->lock_pi);
+
+	return 0;
+}
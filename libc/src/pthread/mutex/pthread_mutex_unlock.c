@@ -21,6 +21,10 @@
 #include <errno.h>
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex) {
+	// Priority inheritance?
+	if (PTHREAD_PRIO_INHERIT == mutex->protocol)
+		return __pthread_mutex_unlock_pi(mutex);
+
 	// Lock structure
 	mutex_lock(&mutex->lock_struct);
 
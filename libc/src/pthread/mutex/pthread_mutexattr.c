@@ -21,6 +21,7 @@
 
 int pthread_mutexattr_init(pthread_mutexattr_t *attr) {
 	attr->kind = PTHREAD_MUTEX_DEFAULT;
+	attr->protocol = PTHREAD_PRIO_NONE;
 	return 0;
 }
 
@@ -46,3 +47,23 @@ int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int kind) {
 		return EINVAL;
 	}
 }
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol) {
+	*protocol = attr->protocol;
+	return 0;
+}
+
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol) {
+	switch (protocol) {
+	case PTHREAD_PRIO_NONE:
+	case PTHREAD_PRIO_INHERIT:
+		attr->protocol = protocol;
+		return 0;
+
+	case PTHREAD_PRIO_PROTECT:
+		return ENOSYS;
+
+	default:
+		return EINVAL;
+	}
+}
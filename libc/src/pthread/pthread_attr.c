@@ -38,11 +38,16 @@ int pthread_attr_setstackaddr(pthread_attr_t *attr, void *stackaddr) {
 }
 
 int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize) {
-	return ENOSYS;
+	*stacksize = attr->stacksize;
+	return 0;
 }
 
 int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize) {
-	return ENOSYS;
+	if (stacksize < PTHREAD_STACK_MIN || stacksize > PTHREAD_STACK_DEFAULT)
+		return EINVAL;
+
+	attr->stacksize = stacksize;
+	return 0;
 }
 
 int pthread_attr_getschedparam(const pthread_attr_t *attr, struct sched_param *param) {
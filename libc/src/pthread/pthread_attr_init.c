@@ -21,6 +21,7 @@
 int pthread_attr_init(pthread_attr_t *attr) {
 	attr->detachstate = PTHREAD_CREATE_JOINABLE;
 	attr->param.sched_priority = 0;
+	attr->stacksize = PTHREAD_STACK_DEFAULT;
 
 	return 0;
 }
@@ -29,7 +29,8 @@ int pthread_create(
 		void *(*start)(void *),
 		void *args) {
 	// Start new thread (TODO: Possible errors)
-	tid_t tid = thread_spawn((void *) start, args, (void *) __pthread_ret);
+	size_t stacksize = (0 != attr) ? attr->stacksize : PTHREAD_STACK_DEFAULT;
+	tid_t tid = thread_spawn((void *) start, args, (void *) __pthread_ret, stacksize);
 
 	// Return tid
 	*thread = (pthread_t) tid;
@@ -17,8 +17,21 @@
  */
 
 #include <pthread.h>
+#include <carbon/thread.h>
+
+// Number of attempts before yielding the processor
+#define PTHREAD_SPIN_COUNT 64
 
 int pthread_spin_lock(pthread_spinlock_t *lock) {
-    while (!pthread_spin_trylock(lock));
+    size_t attempts = 0;
+
+    while (!pthread_spin_trylock(lock)) {
+        // Let the holder run instead of burning the time slice
+        if (++attempts >= PTHREAD_SPIN_COUNT) {
+            thread_sleep(0);
+            attempts = 0;
+        }
+    }
+
     return 0;
 }
@@ -0,0 +1,37 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <carbon/clock.h>
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp) {
+    // Check clock
+    if (CLOCK_REALTIME != clock_id && CLOCK_MONOTONIC != clock_id) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Get time since startup
+    uint64_t time = clock_get();
+
+    tp->tv_sec = time / 1000000000ULL;
+    tp->tv_nsec = time % 1000000000ULL;
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+/**
+ * Carbon Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <carbon/thread.h>
+
+int nanosleep(const struct timespec *rqtp, struct timespec *rmtp) {
+    // Check
+    if (rqtp->tv_nsec < 0 || rqtp->tv_nsec >= 1000000000L) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Sleep (cannot be interrupted)
+    thread_sleep(rqtp->tv_sec * 1000000000ULL + rqtp->tv_nsec);
+
+    if (0 != rmtp) {
+        rmtp->tv_sec = 0;
+        rmtp->tv_nsec = 0;
+    }
+
+    return 0;
+}
@@ -38,9 +38,9 @@ gdt64:
   .KernelData:
     dd 0x0
     dd 0x209200
+  .UserData:                    ; Data before code, as required by SYSRET
+    dd 0x0
+    dd 0x20F200
   .UserCode:
     dd 0x0
     dd 0x20F800
-  .UserData:
-    dd 0x0
-    dd 0x20F200
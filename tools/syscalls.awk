@@ -0,0 +1,328 @@
+# Carbon Operating System
+# Copyright (C) 2011 Lukas Heidemann
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Generates the system call tables of the kernel and the inline system call
+# stubs of libc from syscalls.def.
+#
+# Usage:
+#  awk -v target=<target> -f tools/syscalls.awk syscalls.def
+#
+# Targets:
+#  * kernel-header  System call numbers (kernel/inc/syscall_table.h)
+#  * kernel-table   Handler, lock and batch tables (kernel/src/syscall/table.c)
+#  * libc-header    System call numbers and stubs (libc/inc/carbon/syscall.h)
+
+#- Parsing ---------------------------------------------------------------------
+
+function fail(message) {
+    printf("syscalls.def:%d: %s\n", NR, message) > "/dev/stderr"
+    failed = 1
+    exit 1
+}
+
+function valid_regs(list, allowed,    regs, n, i) {
+    if ("-" == list)
+        return 1
+
+    n = split(list, regs, ",")
+
+    for (i = 1; i <= n; ++i)
+        if (0 == index(allowed, " " regs[i] " "))
+            return 0
+
+    return 1
+}
+
+BEGIN {
+    count = 0
+    max = -1
+}
+
+/^[ \t]*(#|$)/ {
+    next
+}
+
+{
+    if (6 != NF)
+        fail("expected number, name, lock, inputs, outputs and batch")
+
+    if ($1 !~ /^[0-9]+$/ || $1 in used)
+        fail("invalid or duplicate number " $1)
+
+    if ($3 !~ /^(none|process|global)$/)
+        fail("invalid lock " $3)
+
+    if (!valid_regs($4, " rbx rcx rdx rsi rdi r8 r9 r12 r13 r14 r15 "))
+        fail("invalid inputs " $4)
+
+    if ("noreturn" != $5 && !valid_regs($5, " rbx rdx rsi rdi r8 r9 r12 r13 r14 r15 "))
+        fail("invalid outputs " $5)
+
+    if ($6 !~ /^(yes|no)$/)
+        fail("invalid batch " $6)
+
+    used[$1] = 1
+    number[count] = $1 + 0
+    name[count] = $2
+    lock[count] = $3
+    inputs[count] = $4
+    outputs[count] = $5
+    batch[count] = ("yes" == $6)
+    ++count
+
+    if ($1 + 0 > max)
+        max = $1 + 0
+}
+
+#- Output ----------------------------------------------------------------------
+
+function header() {
+    print "/**"
+    print " * Carbon Operating System"
+    print " * Copyright (C) 2011 Lukas Heidemann"
+    print " *"
+    print " * This program is free software: you can redistribute it and/or modify"
+    print " * it under the terms of the GNU General Public License as published by"
+    print " * the Free Software Foundation, either version 3 of the License, or"
+    print " * (at your option) any later version."
+    print " *"
+    print " * This program is distributed in the hope that it will be useful,"
+    print " * but WITHOUT ANY WARRANTY; without even the implied warranty of"
+    print " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the"
+    print " * GNU General Public License for more details."
+    print " *"
+    print " * You should have received a copy of the GNU General Public License"
+    print " * along with this program.  If not, see <http://www.gnu.org/licenses/>."
+    print " */"
+    print ""
+    print "// Generated from syscalls.def by tools/syscalls.awk, do not edit"
+    print "// (regenerate using \"make syscalls\")."
+    print ""
+}
+
+function section(title,    line) {
+    line = "//- " title " "
+
+    while (length(line) < 80)
+        line = line "-"
+
+    print line
+    print ""
+}
+
+function numbers(    i) {
+    for (i = 0; i < count; ++i)
+        printf("#define %-32s %d\n", "SYSCALL_NR_" toupper(name[i]), number[i])
+
+    print ""
+    print "// Size of the system call table (including unused numbers)"
+    printf("#define SYSCALL_COUNT %d\n", max + 1)
+}
+
+function kernel_header() {
+    print "#pragma once"
+    print ""
+    section("System Call Numbers")
+    numbers()
+}
+
+function kernel_table(    i) {
+    print "#include <api/types.h>"
+    print "#include <syscall.h>"
+    print ""
+    section("System Call Table")
+
+    print "syscall_handler_t syscall_handlers[SYSCALL_COUNT] = {"
+
+    for (i = 0; i < count; ++i)
+        printf("    [%s] = &syscall_%s,\n", "SYSCALL_NR_" toupper(name[i]), name[i])
+
+    print "};"
+    print ""
+    print "uint8_t syscall_locks[SYSCALL_COUNT] = {"
+
+    for (i = 0; i < count; ++i)
+        printf("    [%s] = SYSCALL_LOCK_%s,\n", "SYSCALL_NR_" toupper(name[i]), toupper(lock[i]))
+
+    print "};"
+    print ""
+    print "bool syscall_batch[SYSCALL_COUNT] = {"
+
+    for (i = 0; i < count; ++i)
+        if (batch[i])
+            printf("    [%s] = true,\n", "SYSCALL_NR_" toupper(name[i]))
+
+    print "};"
+}
+
+# Register variable the given register is passed in, if it has no constraint
+# (RCX is passed in R10)
+function pinned(reg) {
+    if ("rcx" == reg) return "r10"
+    if (reg ~ /^r[0-9]+$/) return reg
+    return ""
+}
+
+# Constraint for the given register
+function constraint(reg) {
+    if ("" != pinned(reg)) return "r"
+    if ("rbx" == reg) return "b"
+    if ("rdx" == reg) return "d"
+    if ("rsi" == reg) return "S"
+    return "D"
+}
+
+# Variable holding the given register's value
+function variable(reg) {
+    return ("rcx" == reg) ? "r10" : "_" reg
+}
+
+function libc_stub(i,    ins, outs, nin, nout, is_in, is_out, j, sep, params, ops) {
+    nin = ("-" == inputs[i]) ? 0 : split(inputs[i], ins, ",")
+    nout = ("-" == outputs[i] || "noreturn" == outputs[i]) ? 0 : split(outputs[i], outs, ",")
+
+    split("", is_in)
+    split("", is_out)
+
+    for (j = 1; j <= nin; ++j)
+        is_in[ins[j]] = 1
+
+    for (j = 1; j <= nout; ++j)
+        is_out[outs[j]] = 1
+
+    # Parameters: inputs, then pointers for outputs
+    params = ""
+    sep = ""
+
+    for (j = 1; j <= nin; ++j) {
+        params = params sep "uint64_t " ins[j]
+        sep = ", "
+    }
+
+    for (j = 1; j <= nout; ++j) {
+        params = params sep "uint64_t *" outs[j] "_out"
+        sep = ", "
+    }
+
+    if ("" == params)
+        params = "void"
+
+    if ("noreturn" == outputs[i])
+        printf("static inline __attribute__((noreturn)) void __syscall_%s(%s) {\n", name[i], params)
+    else
+        printf("static inline uint64_t __syscall_%s(%s) {\n", name[i], params)
+
+    printf("\tuint64_t rax = %s;\n", "SYSCALL_NR_" toupper(name[i]))
+
+    for (j = 1; j <= nin; ++j) {
+        if ("" != pinned(ins[j]))
+            printf("\tregister uint64_t %s __asm__ (\"%s\") = %s;\n", variable(ins[j]), pinned(ins[j]), ins[j])
+        else
+            printf("\tuint64_t %s = %s;\n", variable(ins[j]), ins[j])
+    }
+
+    for (j = 1; j <= nout; ++j) {
+        if (outs[j] in is_in)
+            continue
+
+        if ("" != pinned(outs[j]))
+            printf("\tregister uint64_t %s __asm__ (\"%s\");\n", variable(outs[j]), pinned(outs[j]))
+        else
+            printf("\tuint64_t %s;\n", variable(outs[j]))
+    }
+
+    print ""
+
+    # Outputs (RAX and the registers written by the kernel)
+    ops = "\"+a\" (rax)"
+
+    for (j = 1; j <= nout; ++j)
+        ops = ops ", \"" ((outs[j] in is_in) ? "+" : "=") constraint(outs[j]) "\" (" variable(outs[j]) ")"
+
+    printf("\t__asm__ volatile (\"syscall\"\n\t\t: %s\n", ops)
+
+    # Inputs only read by the kernel
+    ops = ""
+    sep = ""
+
+    for (j = 1; j <= nin; ++j) {
+        if (ins[j] in is_out)
+            continue
+
+        ops = ops sep "\"" constraint(ins[j]) "\" (" variable(ins[j]) ")"
+        sep = ", "
+    }
+
+    if ("" == ops)
+        print "\t\t:"
+    else
+        printf("\t\t: %s\n", ops)
+    print "\t\t: \"rcx\", \"r11\", \"memory\");"
+
+    if (nout > 0)
+        print ""
+
+    for (j = 1; j <= nout; ++j)
+        printf("\t*%s_out = %s;\n", outs[j], variable(outs[j]))
+
+    if ("noreturn" == outputs[i]) {
+        print ""
+        print "\t__builtin_unreachable();"
+    } else {
+        print "\treturn rax;"
+    }
+
+    print "}"
+}
+
+function libc_header(    i) {
+    print "#pragma once"
+    print "#include <stdint.h>"
+    print ""
+    section("API - System Calls")
+    numbers()
+    print ""
+    section("API - System Calls - Stubs")
+    print "// Each stub returns RAX and stores the other registers the kernel returns"
+    print "// values in to the given pointers. SYSCALL clobbers RCX and R11, the kernel"
+    print "// preserves all other registers."
+    print ""
+
+    for (i = 0; i < count; ++i) {
+        if (i > 0)
+            print ""
+
+        libc_stub(i)
+    }
+}
+
+END {
+    if (failed)
+        exit 1
+
+    header()
+
+    if ("kernel-header" == target)
+        kernel_header()
+    else if ("kernel-table" == target)
+        kernel_table()
+    else if ("libc-header" == target)
+        libc_header()
+    else {
+        print "Unknown target " target > "/dev/stderr"
+        exit 1
+    }
+}